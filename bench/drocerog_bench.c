@@ -0,0 +1,539 @@
+/* droceRoG - benchmark of parsing, replay and navigation without display
+ *
+ * Usage: drocerog_bench [-n steps] [-s seed] file.sgf|directory ...
+ *
+ * Every SGF file (directories are searched recursively) is read, parsed
+ * like in the viewer, post-processed, compacted and expanded again, and
+ * replayed with all variations on a board without display. Then it is
+ * opened like in the viewer for random page jumps and random variation
+ * hops. At last all files are parsed and replayed once more on bitboards
+ * by the worker pool of the position index. The latencies and allocations
+ * of each phase are printed at the end. "parse" is the lazy parse into
+ * the arena of the viewer and includes the post-processing, which is
+ * timed once more on its own. The maximum is the slowest operation, for
+ * the replays the slowest file, for "batch" the whole pool. Built with
+ * DROCEROG_PERF, the counters of the viewer are printed as well.
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <sgftree.h>
+
+#include "goboard.h"
+#include "gogame.h"
+#include "batchreplay.h"
+#include "perf.h"
+
+/******************************************************************************/
+
+#define ENC_SGFPROP(c1_, c2_) ((short)( c1_ | c2_ << 8 ))
+
+/* default number of page jumps and variation hops per file */
+#define BENCH_STEPS 200
+
+typedef enum {
+    PHASE_READ,             /* file into memory */
+    PHASE_PARSE,            /* lazily into the arena, like sgftree_readfile_flags() */
+    PHASE_POSTPROCESS,      /* variation links, draw levels, move numbers */
+    PHASE_COMPACT,          /* sgftree_compact() and sgftree_expand() */
+    PHASE_REPLAY,           /* all nodes of all variations, per node */
+    PHASE_OPEN,             /* gogame_new_from_file() */
+    PHASE_JUMP,             /* gogame_move_to_page(), per jump */
+    PHASE_HOP,              /* variation and event moves, per hop */
+    PHASE_BATCH,            /* batch_replay_files() of all files, per node */
+    NUM_PHASES
+} BenchPhase;
+
+typedef struct {
+    const char *name;
+    long count;             /* measured operations */
+    double total;           /* ms */
+    double max;             /* ms of the slowest operation */
+    long allocs;            /* malloc, calloc and realloc calls */
+    long alloc_bytes;
+} PhaseStats;
+
+typedef struct {
+    struct timespec start;
+    long allocs;
+    long alloc_bytes;
+} PhaseTimer;
+
+typedef struct {
+    char **paths;
+    int num;
+    int max;
+} FileList;
+
+/******************************************************************************/
+
+static PhaseStats stats[NUM_PHASES] = {
+    { "read", 0, 0, 0, 0, 0 },
+    { "parse", 0, 0, 0, 0, 0 },
+    { "postprocess", 0, 0, 0, 0, 0 },
+    { "compact", 0, 0, 0, 0, 0 },
+    { "replay", 0, 0, 0, 0, 0 },
+    { "open", 0, 0, 0, 0, 0 },
+    { "jump", 0, 0, 0, 0, 0 },
+    { "hop", 0, 0, 0, 0, 0 },
+    { "batch", 0, 0, 0, 0, 0 }
+};
+
+/* allocation counters, the target is linked with --wrap for these, the
+ * workers of the batch replay allocate at the same time */
+static long num_allocs = 0;
+static long num_alloc_bytes = 0;
+
+/* setup stones of the replayed node */
+static BoardSetupStone *setupStones = NULL;
+static int setupStones_max = 0;
+
+/******************************************************************************/
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void phase_begin(PhaseTimer *t);
+void phase_end(BenchPhase phase, const PhaseTimer *t);
+void collect_files(FileList *list, const char *path);
+char *read_file(const char *filename, size_t *len);
+void bench_file(const char *filename, int steps);
+int bench_batch(const FileList *files);
+void *bench_batchWork(void *data, const char *filename);
+void bench_batchMerge(void *data, int i, void *result);
+long replay_tree(SGFNode *root);
+void apply_node(SGFNode *nd, int size);
+int bench_collectSetup(SGFNode *nd, int size);
+void print_stats();
+
+/******************************************************************************/
+
+void *__wrap_malloc(size_t size)
+{/*{{{*/
+    __sync_fetch_and_add(&num_allocs, 1);
+    __sync_fetch_and_add(&num_alloc_bytes, size);
+    return __real_malloc(size);
+}/*}}}*/
+
+void *__wrap_calloc(size_t num, size_t size)
+{/*{{{*/
+    __sync_fetch_and_add(&num_allocs, 1);
+    __sync_fetch_and_add(&num_alloc_bytes, num * size);
+    return __real_calloc(num, size);
+}/*}}}*/
+
+void *__wrap_realloc(void *ptr, size_t size)
+{/*{{{*/
+    __sync_fetch_and_add(&num_allocs, 1);
+    __sync_fetch_and_add(&num_alloc_bytes, size);
+    return __real_realloc(ptr, size);
+}/*}}}*/
+
+int main(int argc, char *argv[])
+{
+    FileList files = { NULL, 0, 0 };
+    int i, workers, steps = BENCH_STEPS;
+    unsigned int seed = 1;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = (unsigned int) atoi(argv[++i]);
+        else
+            collect_files(&files, argv[i]);
+    }
+
+    if (files.num == 0) {
+        fprintf(stderr, "Usage: %s [-n steps] [-s seed] file.sgf|directory ...\n", argv[0]);
+        return 1;
+    }
+
+    srand(seed);
+    for (i=0; i<files.num; i++)
+        bench_file(files.paths[i], steps);
+    workers = bench_batch(&files);
+
+    printf("%d files, %d steps per file, %d replay workers\n", files.num, steps, workers);
+    print_stats();
+#ifdef DROCEROG_PERF
+    {
+        char report[2048];
+
+        perf_report(report, sizeof(report));
+        printf("\n%s", report);
+    }
+#endif
+
+    for (i=0; i<files.num; i++)
+        free(files.paths[i]);
+    free(files.paths);
+    free(setupStones);
+
+    return 0;
+}
+
+void phase_begin(PhaseTimer *t)
+{/*{{{*/
+    t->allocs = num_allocs;
+    t->alloc_bytes = num_alloc_bytes;
+    clock_gettime(CLOCK_MONOTONIC, &t->start);
+}/*}}}*/
+
+void phase_end(BenchPhase phase, const PhaseTimer *t)
+{/*{{{*/
+    struct timespec end;
+    double ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms = (end.tv_sec - t->start.tv_sec) * 1e3 + (end.tv_nsec - t->start.tv_nsec) / 1e6;
+
+    stats[phase].count += 1;
+    stats[phase].total += ms;
+    if (ms > stats[phase].max)
+        stats[phase].max = ms;
+    stats[phase].allocs += num_allocs - t->allocs;
+    stats[phase].alloc_bytes += num_alloc_bytes - t->alloc_bytes;
+}/*}}}*/
+
+void collect_files(FileList *list, const char *path)
+{/*{{{*/
+    struct stat st;
+    struct dirent *ent;
+    DIR *dir;
+    char fullpath[1024];
+    size_t len;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Cannot access %s\n", path);
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        dir = opendir(path);
+        if (dir == NULL)
+            return;
+        while ((ent = readdir(dir)) != NULL) {
+            if (ent->d_name[0] == '.')
+                continue;
+            snprintf(fullpath, sizeof(fullpath), "%s/%s", path, ent->d_name);
+            if (stat(fullpath, &st) != 0)
+                continue;
+            len = strlen(ent->d_name);
+            if (S_ISDIR(st.st_mode) || (len > 4 && strcasecmp(ent->d_name + len - 4, ".sgf") == 0))
+                collect_files(list, fullpath);
+        }
+        closedir(dir);
+        return;
+    }
+
+    if (list->num == list->max) {
+        list->max = list->max ? 2 * list->max : 64;
+        list->paths = (char **) realloc(list->paths, sizeof(char *) * list->max);
+    }
+    list->paths[list->num++] = strdup(path);
+}/*}}}*/
+
+char *read_file(const char *filename, size_t *len)
+{/*{{{*/
+    FILE *file;
+    char *buf;
+    long size;
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    buf = (char *) malloc(size + 1);
+    if (buf == NULL || fread(buf, 1, size, file) != (size_t) size) {
+        free(buf);
+        fclose(file);
+        return NULL;
+    }
+    buf[size] = '\0';
+    fclose(file);
+
+    *len = (size_t) size;
+    return buf;
+}/*}}}*/
+
+void bench_file(const char *filename, int steps)
+{/*{{{*/
+    PhaseTimer t;
+    SGFTree tree;
+    SGFNode *root, *nd;
+    SGFArena arena;
+    char *buf;
+    size_t len;
+    long nodes;
+    int i, lastMove;
+
+    phase_begin(&t);
+    buf = read_file(filename, &len);
+    phase_end(PHASE_READ, &t);
+    if (buf == NULL) {
+        fprintf(stderr, "Cannot read %s\n", filename);
+        return;
+    }
+
+    /* the tree takes the input for its placeholders, like the viewer's */
+    sgftree_clear(&tree);
+    phase_begin(&t);
+    tree.root = readsgf_from_memory_arena(buf, len, &tree.arena, SGF_READ_LAZY);
+    phase_end(PHASE_PARSE, &t);
+    if (tree.root == NULL) {
+        sgfArenaFree(&tree.arena);
+        free(buf);
+        fprintf(stderr, "Cannot parse %s\n", filename);
+        return;
+    }
+    tree.input = buf;
+    tree.input_len = len;
+
+    phase_begin(&t);
+    sgfBuildVarInfo(tree.root);
+    phase_end(PHASE_POSTPROCESS, &t);
+
+    /* a prefetched tree waits compact and is expanded when it is opened */
+    phase_begin(&t);
+    sgftree_compact(&tree);
+    sgftree_expand(&tree);
+    phase_end(PHASE_COMPACT, &t);
+
+    /* the replay needs all variations, they are parsed at once like by
+     * the position index; replay time is counted per node */
+    sgfArenaInit(&arena);
+    root = readsgf_from_memory_arena(tree.input, tree.input_len, &arena, 0);
+    sgftree_free(&tree);
+    if (root == NULL) {
+        sgfArenaFree(&arena);
+        return;
+    }
+    phase_begin(&t);
+    nodes = replay_tree(root);
+    phase_end(PHASE_REPLAY, &t);
+    stats[PHASE_REPLAY].count += nodes - 1;
+
+    for (nd=root; nd->child; nd=nd->child) {}
+    lastMove = nd->move_num;
+    sgfArenaFree(&arena);
+
+    /* navigation like in the viewer */
+    phase_begin(&t);
+    i = gogame_new_from_file(filename);
+    phase_end(PHASE_OPEN, &t);
+    if (i != 0)
+        return;
+
+    for (i=0; i<steps; i++) {
+        phase_begin(&t);
+        gogame_move_to_page(rand() % (lastMove + 1));
+        phase_end(PHASE_JUMP, &t);
+    }
+
+    for (i=0; i<steps; i++) {
+        phase_begin(&t);
+        switch (rand() % 6) {
+            case 0: gogame_moveVar_down(); break;
+            case 1: gogame_moveVar_up(); break;
+            case 2: gogame_move_to_nextEvt(); break;
+            case 3: gogame_move_to_prevEvt(); break;
+            case 4: gogame_move_forward(); break;
+            case 5: gogame_move_back(); break;
+        }
+        phase_end(PHASE_HOP, &t);
+    }
+
+    gogame_cleanup();
+}/*}}}*/
+
+int bench_batch(const FileList *files)
+{/*{{{*/
+    PhaseTimer t;
+    long nodes = 0;
+    int workers;
+
+    /* the whole pool is one operation, its time is counted per node */
+    phase_begin(&t);
+    workers = batch_replay_files((const char **) files->paths, files->num,
+                                 bench_batchWork, bench_batchMerge, &nodes);
+    phase_end(PHASE_BATCH, &t);
+    stats[PHASE_BATCH].count += nodes - 1;
+
+    return workers;
+}/*}}}*/
+
+void *bench_batchWork(void *data, const char *filename)
+{/*{{{*/
+    SGFTree tree;
+    long nodes;
+
+    (void) data;
+
+    /* read like by the position index */
+    sgftree_clear(&tree);
+    if (!sgftree_readfile(&tree, filename))
+        return NULL;
+
+    nodes = batch_replay_tree(tree.root, NULL, NULL);
+    sgftree_free(&tree);
+
+    return (void *) nodes;
+}/*}}}*/
+
+void bench_batchMerge(void *data, int i, void *result)
+{/*{{{*/
+    (void) i;
+
+    *(long *) data += (long) result;
+}/*}}}*/
+
+long replay_tree(SGFNode *root)
+{/*{{{*/
+    SGFNode *nd;
+    long nodes = 1;
+    int size;
+
+    if (!sgfGetIntProperty(root, "SZ", &size) || size <= 0 || size > 52)
+        size = 19;
+    board_core_new(size);
+
+    /* depth first walk through all variations */
+    nd = root;
+    apply_node(nd, size);
+    for (;;) {
+        if (nd->child) {
+            nd = nd->child;
+            apply_node(nd, size);
+            nodes += 1;
+            continue;
+        }
+
+        while (nd != root && nd->next == NULL) {
+            board_undo();
+            nd = nd->parent;
+        }
+        if (nd == root)
+            break;
+        board_undo();
+        nd = nd->next;
+        apply_node(nd, size);
+        nodes += 1;
+    }
+
+    board_core_cleanup();
+
+    return nodes;
+}/*}}}*/
+
+void apply_node(SGFNode *nd, int size)
+{/*{{{*/
+    SGFProperty *prop;
+    int k, r, c, num;
+
+    board_beginNode();
+
+    num = bench_collectSetup(nd, size);
+    if (num > 0)
+        board_setupStones(setupStones, num);
+
+    for (prop = nd->props; prop; prop = prop->next) {
+        for (k=0; k<sgfNumPoints(prop); k++) {
+            r = get_pointX(prop, k, size);
+            c = get_pointY(prop, k, size);
+            if (r < 0 || c < 0)
+                continue;
+
+            switch (prop->name) {
+                case ENC_SGFPROP('B', ' '):
+                    board_placeStone(r, c, BOARD_BLACK, 1);
+                    break;
+                case ENC_SGFPROP('W', ' '):
+                    board_placeStone(r, c, BOARD_WHITE, 1);
+                    break;
+                case ENC_SGFPROP('S', 'Q'):
+                    board_placeMarker(r, c, MARK_SQUARE);
+                    break;
+                case ENC_SGFPROP('C', 'R'):
+                    board_placeMarker(r, c, MARK_CIRC);
+                    break;
+                case ENC_SGFPROP('T', 'R'):
+                    board_placeMarker(r, c, MARK_TRIANGLE);
+                    break;
+            }
+        }
+    }
+}/*}}}*/
+
+int bench_collectSetup(SGFNode *nd, int size)
+{/*{{{*/
+    SGFProperty *prop;
+    BoardSetupStone *stones;
+    BoardSetupType type;
+    int k, r, c, num;
+
+    num = 0;
+    for (prop = nd->props; prop; prop = prop->next) {
+        if (prop->name == ENC_SGFPROP('A', 'B') || prop->name == ENC_SGFPROP('A', 'W')
+            || prop->name == ENC_SGFPROP('A', 'E'))
+            num += sgfNumPoints(prop);
+    }
+    if (num > setupStones_max) {
+        stones = (BoardSetupStone *) realloc(setupStones, sizeof(BoardSetupStone) * num);
+        if (stones == NULL)
+            return 0;
+        setupStones = stones;
+        setupStones_max = num;
+    }
+
+    num = 0;
+    for (prop = nd->props; prop; prop = prop->next) {
+        switch (prop->name) {
+            case ENC_SGFPROP('A', 'B'): type = SETUP_BLACK; break;
+            case ENC_SGFPROP('A', 'W'): type = SETUP_WHITE; break;
+            case ENC_SGFPROP('A', 'E'): type = SETUP_EMPTY; break;
+            default: continue;
+        }
+        for (k=0; k<sgfNumPoints(prop); k++) {
+            r = get_pointX(prop, k, size);
+            c = get_pointY(prop, k, size);
+            if (r < 0 || c < 0)
+                continue;
+            setupStones[num].r = r;
+            setupStones[num].c = c;
+            setupStones[num].type = type;
+            num += 1;
+        }
+    }
+
+    return num;
+}/*}}}*/
+
+void print_stats()
+{/*{{{*/
+    PhaseStats *s;
+    int i;
+
+    printf("%-12s %9s %11s %10s %10s %10s %10s\n",
+           "phase", "ops", "total ms", "mean us", "max ms", "allocs", "KiB");
+    for (i=0; i<NUM_PHASES; i++) {
+        s = &stats[i];
+        printf("%-12s %9ld %11.2f %10.2f %10.3f %10ld %10.1f\n",
+               s->name, s->count, s->total,
+               s->count > 0 ? s->total * 1e3 / s->count : 0.0,
+               s->max, s->allocs, s->alloc_bytes / 1024.0);
+    }
+}/*}}}*/
@@ -0,0 +1,70 @@
+/* droceRoG - declarations of the inkview functions for the benchmark
+ *
+ * The part of inkview.h used by the game logic the benchmark is built
+ * from, so that it builds without the SDK. The functions are those of
+ * nodisplay.c. The game logic takes the header of the SDK instead if it
+ * is installed.
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef INKVIEW_H
+#define INKVIEW_H
+
+#include <dirent.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* never dereferenced by the game logic */
+typedef struct ifont_s ifont;
+typedef struct ibitmap_s ibitmap;
+
+typedef void (*iv_timerproc)(void);
+
+#define WHITE 0xffffff
+#define BLACK 0x000000
+
+#define ALIGN_LEFT 1
+#define VALIGN_TOP 16
+
+#define CONFIGPATH "./config"
+
+int ScreenWidth();
+int ScreenHeight();
+
+ifont *OpenFont(const char *name, int size, int aa);
+void CloseFont(ifont *font);
+void SetFont(ifont *font, int color);
+
+void DrawString(int x, int y, const char *s);
+char *DrawTextRect(int x, int y, int w, int h, const char *s, int flags);
+int CharWidth(unsigned short c);
+int TextRectHeight(int width, const char *s, int flags);
+
+void DrawLine(int x1, int y1, int x2, int y2, int color);
+void FillArea(int x, int y, int w, int h, int color);
+void DrawBitmap(int x, int y, const ibitmap *b);
+ibitmap *BitmapFromScreen(int x, int y, int w, int h);
+
+void ClearScreen();
+void FullUpdate();
+void PartialUpdate(int x, int y, int w, int h);
+void PartialUpdateBW(int x, int y, int w, int h);
+void DynamicUpdate(int x, int y, int w, int h);
+
+void SetWeakTimer(const char *name, iv_timerproc tproc, int ms);
+void ClearTimer(iv_timerproc tproc);
+
+DIR *iv_opendir(const char *dirname);
+struct dirent *iv_readdir(DIR *dir);
+int iv_closedir(DIR *dir);
+int iv_strcmp(const char *s1, const char *s2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INKVIEW_H */
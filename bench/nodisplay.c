@@ -0,0 +1,90 @@
+/* droceRoG - display functions for the benchmark
+ *
+ * The benchmark links the game logic without libinkview. The inkview
+ * functions used by gogame.c and goboard.c do nothing here, those of the
+ * position index read the directories of the host. They are
+ * declared by inkview.h next to this file, which is included by name so
+ * that it is never the header of the SDK.
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "inkview.h"
+
+/******************************************************************************/
+
+/* screen of the reference device */
+#define NODISPLAY_WIDTH 600
+#define NODISPLAY_HEIGHT 800
+
+/* any non-NULL font, it is never dereferenced */
+static int dummy_font;
+
+/******************************************************************************/
+
+int ScreenWidth() { return NODISPLAY_WIDTH; }
+int ScreenHeight() { return NODISPLAY_HEIGHT; }
+
+ifont *OpenFont(const char *name, int size, int aa)
+{/*{{{*/
+    (void) name; (void) size; (void) aa;
+    return (ifont *) &dummy_font;
+}/*}}}*/
+
+void CloseFont(ifont *font) { (void) font; }
+void SetFont(ifont *font, int color) { (void) font; (void) color; }
+
+void DrawString(int x, int y, const char *s) { (void) x; (void) y; (void) s; }
+
+char *DrawTextRect(int x, int y, int w, int h, const char *s, int flags)
+{/*{{{*/
+    (void) x; (void) y; (void) w; (void) h; (void) s; (void) flags;
+    return NULL;
+}/*}}}*/
+
+/* a fixed width font of the size of the comments */
+int CharWidth(unsigned short c) { (void) c; return 8; }
+
+int TextRectHeight(int width, const char *s, int flags)
+{/*{{{*/
+    (void) width; (void) s; (void) flags;
+    return 18;
+}/*}}}*/
+
+void DrawLine(int x1, int y1, int x2, int y2, int color)
+{/*{{{*/
+    (void) x1; (void) y1; (void) x2; (void) y2; (void) color;
+}/*}}}*/
+
+void FillArea(int x, int y, int w, int h, int color)
+{/*{{{*/
+    (void) x; (void) y; (void) w; (void) h; (void) color;
+}/*}}}*/
+
+void DrawBitmap(int x, int y, const ibitmap *b) { (void) x; (void) y; (void) b; }
+
+/* no tiles are cached, each field is drawn again */
+ibitmap *BitmapFromScreen(int x, int y, int w, int h)
+{/*{{{*/
+    (void) x; (void) y; (void) w; (void) h;
+    return NULL;
+}/*}}}*/
+
+void ClearScreen() {}
+void FullUpdate() {}
+void PartialUpdate(int x, int y, int w, int h) { (void) x; (void) y; (void) w; (void) h; }
+void PartialUpdateBW(int x, int y, int w, int h) { (void) x; (void) y; (void) w; (void) h; }
+void DynamicUpdate(int x, int y, int w, int h) { (void) x; (void) y; (void) w; (void) h; }
+
+/* the tree cache is not written by the benchmark */
+void SetWeakTimer(const char *name, iv_timerproc tproc, int ms) { (void) name; (void) tproc; (void) ms; }
+void ClearTimer(iv_timerproc tproc) { (void) tproc; }
+
+/* the position index is not updated by the benchmark, but it is linked */
+DIR *iv_opendir(const char *dirname) { return opendir(dirname); }
+struct dirent *iv_readdir(DIR *dir) { return readdir(dir); }
+int iv_closedir(DIR *dir) { return closedir(dir); }
+int iv_strcmp(const char *s1, const char *s2) { return strcmp(s1, s2); }
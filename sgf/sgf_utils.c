@@ -66,6 +66,46 @@ get_moveY(SGFProperty *property, int boardsize)
 }
 
 
+/*
+ * droceRoG: Return the integer X and Y of point k of a packed point
+ * list. Point 0 of other properties is their move.
+ */
+
+int
+get_pointX(SGFProperty *property, int k, int boardsize)
+{
+  const char *v = property->value + 2 * k;
+  int i;
+
+  assert(k >= 0 && k < sgfNumPoints(property));
+  if (v[0] == '\0' || v[1] == '\0')
+    return -1;
+
+  i = toupper((int) v[1]) - 'A';
+  if (i >= boardsize)
+    return -1;
+
+  return i;
+}
+
+int
+get_pointY(SGFProperty *property, int k, int boardsize)
+{
+  const char *v = property->value + 2 * k;
+  int j;
+
+  assert(k >= 0 && k < sgfNumPoints(property));
+  if (v[0] == '\0' || v[1] == '\0')
+    return -1;
+
+  j = toupper((int) v[0]) - 'A';
+  if (j >= boardsize)
+    return -1;
+
+  return j;
+}
+
+
 /* Fills (*i, *j) from the property value, in GNU Go co-ords.
  * Note that GNU Go uses different conventions from sgf for
  * co-ordinates been called. 
@@ -153,34 +193,9 @@ show_sgf_tree(SGFNode *node)
 int
 is_markup_node(SGFNode *node)
 {
-  SGFProperty *sgf_prop;
-  
-  /* If the node has no properties, there's nothing to do.
-     This should have been checked by the caller, but it can't hurt. */
-  if (!node->props)
-    return 0;
-
-  sgf_prop = node->props;
-  while (sgf_prop) {
-    switch (sgf_prop->name) {
-    case SGFCR: 
-    case SGFSQ: /* Square */
-    case SGFTR: /* Triangle */
-    case SGFMA: /* Mark */
-    case SGFBM: /* bad move */
-    case SGFDO: /* doubtful move */
-    case SGFIT: /* interesting move */
-    case SGFTE: /* good move */
-      return 1;
-      break;
-    default:
-      break;
-    }
-    sgf_prop = sgf_prop->next;
-  }
-
-  /* No markup property found. */
-  return 0;
+  /* droceRoG: the markup properties are flagged while parsing, the move
+   * annotations count as well */
+  return sgfHasProps(node, SGF_PROP_MARKUP | SGF_PROP_ANNOT);
 }
 
 
@@ -191,27 +206,8 @@ is_markup_node(SGFNode *node)
 int
 is_move_node(SGFNode *node)
 {
-  SGFProperty *sgf_prop;
-  
-  /* If the node has no properties, there's nothing to do.
-     This should have been checked by the caller, but it can't hurt. */
-  if (!node->props)
-    return 0;
-
-  sgf_prop = node->props;
-  while (sgf_prop) {
-    switch (sgf_prop->name) {
-    case SGFB: 
-    case SGFW: 
-      return 1;
-      break;
-    default:
-      break;
-    }
-    sgf_prop = sgf_prop->next;
-  }
-
-  return 0;
+  /* droceRoG: the move properties are flagged while parsing */
+  return sgfHasProps(node, SGF_PROP_MOVE);
 }
 
 
@@ -222,28 +218,13 @@ is_move_node(SGFNode *node)
 int
 is_pass_node(SGFNode *node, int boardsize)
 {
-  SGFProperty *sgf_prop;
   int i, j;
   
-  /* If the node has no properties, there's nothing to do.
-     This should have been checked by the caller, but it can't hurt. */
-  if (!node->props)
+  /* droceRoG: the first move property is stored in the node */
+  if (node->move == NULL)
     return 0;
 
-  sgf_prop = node->props;
-  while (sgf_prop) {
-    switch (sgf_prop->name) {
-    case SGFB: 
-    case SGFW: 
-      return !get_moveXY(sgf_prop, &i, &j, boardsize);
-      break;
-    default:
-      break;
-    }
-    sgf_prop = sgf_prop->next;
-  }
-
-  return 0;
+  return !get_moveXY(node->move, &i, &j, boardsize);
 }
 
 
@@ -254,29 +235,11 @@ is_pass_node(SGFNode *node, int boardsize)
 int
 find_move(SGFNode *node)
 {
-  SGFProperty *sgf_prop;
-  
-  /* If the node has no properties, there's nothing to do.
-     This should have been checked by the caller, but it can't hurt. */
-  if (!node->props)
-    return 0;
-
-  sgf_prop = node->props;
-  while (sgf_prop) {
-    switch (sgf_prop->name) {
-    case SGFB: 
-      return STONE_BLACK;
-      break;
-    case SGFW: 
-      return STONE_WHITE;
-      break;
-    default:
-      break;
-    }
-    sgf_prop = sgf_prop->next;
-  }
+  /* droceRoG: the first move property is stored in the node */
+  if (node->move == NULL)
+    return EMPTY;
 
-  return EMPTY;
+  return node->move->name == SGFB ? STONE_BLACK : STONE_WHITE;
 }
 
 
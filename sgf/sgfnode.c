@@ -46,6 +46,10 @@
 # endif
 #endif
 
+#ifdef DROCEROG_PERF
+#include <time.h>
+#endif
+
 #include "sgftree.h"
 // #include "gg_utils.h"
 
@@ -94,6 +98,82 @@ xrealloc(void *pt, unsigned int size)
 }
 
 
+/*
+ * droceRoG: Arena allocator. Memory is handed out from blocks of
+ * SGF_ARENA_BLOCK bytes, larger requests get a block of their own.
+ * Like xalloc, the returned memory is initialized with zeros.
+ */
+
+#define SGF_ARENA_BLOCK 32768
+#define SGF_ARENA_ALIGN(n_) (((n_) + 7) & ~7u)
+#define SGF_ARENA_HEADER SGF_ARENA_ALIGN(sizeof(SGFArenaBlock))
+
+void
+sgfArenaInit(SGFArena *arena)
+{
+  arena->blocks = NULL;
+}
+
+void *
+sgfArenaAlloc(SGFArena *arena, unsigned int size)
+{
+  SGFArenaBlock *block = arena->blocks;
+  char *pt;
+
+  size = SGF_ARENA_ALIGN(size);
+
+  if (block == NULL || block->used + size > block->size) {
+    if (size > SGF_ARENA_BLOCK / 4) {
+      /* own block, keep filling the current one */
+      block = malloc(SGF_ARENA_HEADER + size);
+      if (!block) {
+        fprintf(stderr, "sgfArenaAlloc: Out of memory!\n");
+        exit(EXIT_FAILURE);
+      }
+      block->size = size;
+      block->used = 0;
+      if (arena->blocks) {
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+      }
+      else {
+        block->next = NULL;
+        arena->blocks = block;
+      }
+    }
+    else {
+      block = malloc(SGF_ARENA_HEADER + SGF_ARENA_BLOCK);
+      if (!block) {
+        fprintf(stderr, "sgfArenaAlloc: Out of memory!\n");
+        exit(EXIT_FAILURE);
+      }
+      block->size = SGF_ARENA_BLOCK;
+      block->used = 0;
+      block->next = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  pt = (char *) block + SGF_ARENA_HEADER + block->used;
+  block->used += size;
+
+  memset(pt, 0, (unsigned long) size);
+  return pt;
+}
+
+void
+sgfArenaFree(SGFArena *arena)
+{
+  SGFArenaBlock *block;
+
+  while (arena->blocks) {
+    block = arena->blocks;
+    arena->blocks = block->next;
+    free(block);
+  }
+}
+
+
 /* ================================================================ */
 /*                           SGF Nodes                              */
 /* ================================================================ */
@@ -103,11 +183,9 @@ xrealloc(void *pt, unsigned int size)
  * Allocate memory for a new SGF node.
  */
 
-SGFNode *
-sgfNewNode()
+static void
+init_node(SGFNode *newnode)
 {
-  SGFNode *newnode;
-  newnode = xalloc(sizeof(SGFNode));
   newnode->next = NULL;
   newnode->props = NULL;
   newnode->parent = NULL;
@@ -116,22 +194,41 @@ sgfNewNode()
   newnode->nextVar = NULL;
   newnode->draw_lvl = -1;
   newnode->move_num = 0;
+  newnode->snapshot = NULL;
+  newnode->lazy_offset = -1;
+  newnode->prop_mask = 0;
+  newnode->move = NULL;
+  newnode->comment = NULL;
+  newnode->nextEvt = NULL;
+  newnode->prevEvt = NULL;
+}
+
+SGFNode *
+sgfNewNode()
+{
+  SGFNode *newnode;
+  newnode = xalloc(sizeof(SGFNode));
+  init_node(newnode);
   return newnode;
 }
 
 /*
- * Recursively free an sgf node
+ * Recursively free an sgf node. The main line is walked iteratively,
+ * only variations recurse.
  */
 
 void
 sgfFreeNode(SGFNode *node)
 {
-  if (node == NULL)
-    return;
-  sgfFreeNode(node->next);
-  sgfFreeNode(node->child);
-  sgfFreeProperty(node->props);
-  free(node);
+  SGFNode *child;
+
+  while (node != NULL) {
+    sgfFreeNode(node->next);
+    child = node->child;
+    sgfFreeProperty(node->props);
+    free(node);
+    node = child;
+  }
 }
 
 
@@ -368,19 +465,62 @@ sgfRoot(SGFNode *node)
 /* ================================================================ */
 
 
+/*
+ * droceRoG: While reading a file, nodes and properties are allocated
+ * from the arena of the parser if it is set.
+ */
+
+static void *
+parse_alloc(SGFArena *arena, unsigned int size)
+{
+  if (arena)
+    return sgfArenaAlloc(arena, size);
+  return xalloc(size);
+}
+
+static SGFNode *
+parse_new_node(SGFArena *arena)
+{
+  SGFNode *newnode;
+  newnode = parse_alloc(arena, sizeof(SGFNode));
+  init_node(newnode);
+  return newnode;
+}
+
+
+static SGFProperty *do_sgf_attach_property(short sgf_name, char *value,
+					   SGFNode *node, SGFProperty *last,
+					   SGFArena *arena);
+
 /*
  * Make an SGF property.
  */
 static SGFProperty *
 do_sgf_make_property(short sgf_name,  const char *value,
-		     SGFNode *node, SGFProperty *last)
+		     SGFNode *node, SGFProperty *last, SGFArena *arena)
+{
+  char *copy;
+
+  copy = parse_alloc(arena, strlen(value) + 1);
+  strcpy(copy, value);
+
+  return do_sgf_attach_property(sgf_name, copy, node, last, arena);
+}
+
+
+/*
+ * Attach an already allocated value as new property.
+ */
+static SGFProperty *
+do_sgf_attach_property(short sgf_name, char *value,
+		       SGFNode *node, SGFProperty *last, SGFArena *arena)
 {
   SGFProperty *prop;
 
-  prop = (SGFProperty *) xalloc(sizeof(SGFProperty));
+  prop = (SGFProperty *) parse_alloc(arena, sizeof(SGFProperty));
   prop->name = sgf_name;
-  prop->value = xalloc(strlen(value) + 1);
-  strcpy(prop->value, value);
+  prop->points = 0;
+  prop->value = value;
   prop->next = NULL;
 
   if (last == NULL)
@@ -388,16 +528,65 @@ do_sgf_make_property(short sgf_name,  const char *value,
   else
     last->next = prop;
 
+  /* droceRoG: remember the property for fast lookups */
+  switch (sgf_name) {
+  case SGFB:
+    node->prop_mask |= SGF_PROP_B;
+    if (node->move == NULL)
+      node->move = prop;
+    break;
+  case SGFW:
+    node->prop_mask |= SGF_PROP_W;
+    if (node->move == NULL)
+      node->move = prop;
+    break;
+  case SGFC:
+    node->prop_mask |= SGF_PROP_C;
+    if (node->comment == NULL)
+      node->comment = prop;
+    break;
+  case SGFAB:
+    node->prop_mask |= SGF_PROP_AB;
+    break;
+  case SGFAW:
+    node->prop_mask |= SGF_PROP_AW;
+    break;
+  case SGFAE:
+    node->prop_mask |= SGF_PROP_AE;
+    break;
+  case SGFCR:
+  case SGFSQ:
+  case SGFTR:
+  case SGFMA:
+    node->prop_mask |= SGF_PROP_MARKUP;
+    break;
+  case SGFBM:
+  case SGFDO:
+  case SGFIT:
+  case SGFTE:
+    node->prop_mask |= SGF_PROP_ANNOT;
+    break;
+  default:
+    break;
+  }
+
   return prop;
 }
 
 
-/* Make an SGF property.  In case of a property with a range it
- * expands it and makes several properties instead.
- */
-SGFProperty *
-sgfMkProperty(const char *name, const  char *value,
-	      SGFNode *node, SGFProperty *last)
+/* droceRoG: encoded name of a property */
+static short
+sgf_prop_name(const char *name)
+{
+  if (strlen(name) == 1)
+    return name[0] | (short) (' ' << 8);
+  return name[0] | name[1] << 8;
+}
+
+
+/* droceRoG: the point list properties, their values may be ranges */
+static int
+sgf_allows_ranges(short sgf_name)
 {
   static const short properties_allowing_ranges[12] = {
     /* Board setup properties. */
@@ -414,19 +603,27 @@ sgfMkProperty(const char *name, const  char *value,
   };
 
   int k;
-  short sgf_name;
-
-  if (strlen(name) == 1)
-    sgf_name = name[0] | (short) (' ' << 8);
-  else
-    sgf_name = name[0] | name[1] << 8;
 
   for (k = 0; k < 12; k++) {
     if (properties_allowing_ranges[k] == sgf_name)
-      break;
+      return 1;
   }
+  return 0;
+}
+
+
+/* Make an SGF property.  In case of a property with a range it
+ * expands it and makes several properties instead. If owned is set,
+ * value has been allocated by parse_alloc and is used directly instead
+ * of being copied.
+ */
+static SGFProperty *
+make_property(const char *name, char *value, int owned,
+	      SGFNode *node, SGFProperty *last, SGFArena *arena)
+{
+  short sgf_name = sgf_prop_name(name);
 
-  if (k < 12
+  if (sgf_allows_ranges(sgf_name)
       && strlen(value) == 5
       && value[2] == ':') {
     char x1 = value[0];
@@ -438,31 +635,46 @@ sgfMkProperty(const char *name, const  char *value,
     if (x1 <= x2 && y1 <= y2) {
       for (new_value[0] = x1; new_value[0] <= x2; new_value[0]++) {
 	for (new_value[1] = y1; new_value[1] <= y2; new_value[1]++)
-	  last = do_sgf_make_property(sgf_name, new_value, node, last);
+	  last = do_sgf_make_property(sgf_name, new_value, node, last, arena);
       }
 
+      if (owned && !arena)
+	free(value);
       return last;
     }
   }
 
   /* Not a range property. */
-  return do_sgf_make_property(sgf_name, value, node, last);
+  if (owned)
+    return do_sgf_attach_property(sgf_name, value, node, last, arena);
+  return do_sgf_make_property(sgf_name, value, node, last, arena);
+}
+
+
+SGFProperty *
+sgfMkProperty(const char *name, const  char *value,
+	      SGFNode *node, SGFProperty *last)
+{
+  return make_property(name, (char *) value, 0, node, last, NULL);
 }
 
 
 /*
- * Recursively free an SGF property.
+ * Free a list of SGF properties.
  *
  */
 
 void
 sgfFreeProperty(SGFProperty *prop)
 {
-  if (prop == NULL)
-    return;
-  sgfFreeProperty(prop->next);
-  free(prop->value);
-  free(prop);
+  SGFProperty *next;
+
+  while (prop != NULL) {
+    next = prop->next;
+    free(prop->value);
+    free(prop);
+    prop = next;
+  }
 }
 
 
@@ -863,7 +1075,6 @@ sgf_write_header(SGFNode *root, int overwrite, int seed, float komi,
 /* ================================================================ */
 
 
-#define MAX_FILE_BUFFER 200000 /* buffer for reading SGF file. */
 
 /*
  * SGF grammar:
@@ -885,31 +1096,61 @@ sgf_write_header(SGFNode *root, int overwrite, int seed, float komi,
  *   2) The only recursion is on gametree.
  *   3) Tokens are only one character
  * 
- * We will use a global state to keep track of the remaining input
- * and a global char variable, `lookahead' to hold the next token.  
+ * We will use a parser state to keep track of the remaining input
+ * and a char variable, `lookahead' to hold the next token.  
  * The function `nexttoken' skips whitespace and fills lookahead with 
  * the new token.
+ *
+ * droceRoG: The whole input is held in memory, ptr points to the next
+ * character and end behind the last one. All state lives in an
+ * SGFParser, so several files can be parsed at the same time. Errors
+ * do not terminate the program: the first one is recorded in the
+ * parser, and the parsing functions return 0.
  */
 
 
-static void parse_error(const char *msg, int arg);
-static void nexttoken(void);
-static void match(int expected);
-
+typedef struct {
+  const char *begin;    /* input buffer */
+  const char *ptr;      /* next character */
+  const char *end;      /* behind the last character */
+  int lookahead;
+  SGFArena *arena;      /* NULL: nodes and properties are allocated separately */
+  int lazy;             /* SGF_READ_LAZY: skip all but the first variation */
+  const char *err;      /* first error, NULL if none */
+  int errarg;
+  int errpos;           /* input offset of the error */
+  char *points;         /* points of the current point list */
+  size_t points_max;
+} SGFParser;
 
-static FILE *sgffile;
 
+static void
+parser_init(SGFParser *p, const char *buf, size_t len, SGFArena *arena)
+{
+  p->begin = buf;
+  p->ptr = buf;
+  p->end = buf + len;
+  p->lookahead = EOF;
+  p->arena = arena;
+  p->lazy = 0;
+  p->err = NULL;
+  p->errarg = 0;
+  p->errpos = 0;
+  p->points = NULL;
+  p->points_max = 0;
+}
 
-#define sgf_getch() (getc(sgffile))
 
+static void
+parser_free(SGFParser *p)
+{
+  free(p->points);
+  p->points = NULL;
+  p->points_max = 0;
+}
 
-static char *sgferr;
-#ifdef TEST_SGFPARSER
-static int sgferrarg;
-#endif
-static int sgferrpos;
 
-static int lookahead;
+#define sgf_getch(p) ((p)->ptr < (p)->end ? (int) (unsigned char) *(p)->ptr++ : EOF)
 
 
 /* ---------------------------------------------------------------- */
@@ -917,31 +1158,35 @@ static int lookahead;
 /* ---------------------------------------------------------------- */
 
 
-static void
-parse_error(const char *msg, int arg)
+static int
+parse_error(SGFParser *p, const char *msg, int arg)
 {
-  fprintf(stderr, msg, arg);
-  fprintf(stderr, "\n");
-  exit(EXIT_FAILURE);
+  if (!p->err) {
+    p->err = msg;
+    p->errarg = arg;
+    p->errpos = p->ptr - p->begin;
+  }
+  return 0;
 }
 
 
 static void
-nexttoken()
+nexttoken(SGFParser *p)
 {
   do
-    lookahead = sgf_getch();
-  while (isspace(lookahead));
+    p->lookahead = sgf_getch(p);
+  while (isspace(p->lookahead));
 }
 
 
-static void
-match(int expected)
+static int
+match(SGFParser *p, int expected)
 {
-  if (lookahead != expected)
-    parse_error("expected: %c", expected);
-  else
-    nexttoken();
+  if (p->lookahead != expected)
+    return parse_error(p, "expected: %c", expected);
+
+  nexttoken(p);
+  return 1;
 }
 
 /* ---------------------------------------------------------------- */
@@ -949,51 +1194,74 @@ match(int expected)
 /* ---------------------------------------------------------------- */
 
 
-static void
-propident(char *buffer, int size)
+static int
+propident(SGFParser *p, char *buffer, int size)
 {
-  if (lookahead == EOF || !isupper(lookahead)) 
-    parse_error("Expected an upper case letter.", 0);
+  if (p->lookahead == EOF || !isupper(p->lookahead)) 
+    return parse_error(p, "Expected an upper case letter.", 0);
   
-  while (lookahead != EOF && isalpha(lookahead)) {
-    if (isupper(lookahead) && size > 1) {
-      *buffer++ = lookahead;
+  while (p->lookahead != EOF && isalpha(p->lookahead)) {
+    if (isupper(p->lookahead) && size > 1) {
+      *buffer++ = p->lookahead;
       size--;
     }
-    nexttoken();
+    nexttoken(p);
   }
   *buffer = '\0';
+  return 1;
 }
 
 
-static void
-propvalue(char *buffer, int size)
+/*
+ * droceRoG: Length of the raw value text behind the opening bracket up
+ * to the closing one, an upper bound for the length of the value.
+ */
+
+static size_t
+propvalue_bound(SGFParser *p)
+{
+  const char *raw;
+  const char *q;
+
+  raw = (p->lookahead == EOF) ? p->end : p->ptr - 1;
+  for (q = raw; q < p->end && *q != ']'; q++)
+    if (*q == '\\' && q + 1 < p->end)
+      q++;
+  return q - raw;
+}
+
+
+/*
+ * droceRoG: Decode the value behind the opening bracket into buffer of
+ * propvalue_bound() + 1 bytes. Returns the end of the value, NULL on a
+ * parse error.
+ */
+
+static char *
+propvalue_decode(SGFParser *p, char *buffer)
 {
-  char *p = buffer;
+  char *v = buffer;
 
-  match('[');
-  while (lookahead != ']' && lookahead != EOF) {
-    if (lookahead == '\\') {
-      lookahead = sgf_getch();
+  while (p->lookahead != ']' && p->lookahead != EOF) {
+    if (p->lookahead == '\\') {
+      p->lookahead = sgf_getch(p);
       /* Follow the FF4 definition of backslash */
-      if (lookahead == '\r') {
-	lookahead = sgf_getch();
-	if (lookahead == '\n') 
-	  lookahead = sgf_getch();
+      if (p->lookahead == '\r') {
+	p->lookahead = sgf_getch(p);
+	if (p->lookahead == '\n') 
+	  p->lookahead = sgf_getch(p);
       }
-      else if (lookahead == '\n') {
-	lookahead = sgf_getch();
-	if (lookahead == '\r') 
-	  lookahead = sgf_getch();
+      else if (p->lookahead == '\n') {
+	p->lookahead = sgf_getch(p);
+	if (p->lookahead == '\r') 
+	  p->lookahead = sgf_getch(p);
       }
     }
-    if (size > 1) {
-      *p++ = lookahead;
-      size--;
-    }
-    lookahead = sgf_getch();
+    *v++ = p->lookahead;
+    p->lookahead = sgf_getch(p);
   }
-  match(']');
+  if (!match(p, ']'))
+    return NULL;
   
   /* Remove trailing whitespace. The double cast below is needed
    * because "char" may be represented as a signed char, in which case
@@ -1001,171 +1269,449 @@ propvalue(char *buffer, int size)
    * cast to int would cause a negative value to be passed to isspace,
    * possibly causing an assertion failure.
    */
-  --p;
-  while (p > buffer && isspace((int) (unsigned char) *p))
-    --p;
-  *++p = '\0';
+  --v;
+  while (v > buffer && isspace((int) (unsigned char) *v))
+    --v;
+  *++v = '\0';
+
+  return v;
 }
 
 
-static SGFProperty *
-property(SGFNode *n, SGFProperty *last)
+/*
+ * droceRoG: The value is copied directly into its final memory.
+ * Returns NULL on a parse error.
+ */
+
+static char *
+propvalue(SGFParser *p)
+{
+  char *buffer;
+
+  if (!match(p, '['))
+    return NULL;
+
+  buffer = parse_alloc(p->arena, propvalue_bound(p) + 1);
+  if (!propvalue_decode(p, buffer)) {
+    if (!p->arena)
+      free(buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+
+/* droceRoG: room for len more bytes behind the used ones of the points */
+static void
+points_reserve(SGFParser *p, size_t used, size_t len)
+{
+  if (used + len <= p->points_max)
+    return;
+  while (p->points_max < used + len)
+    p->points_max = p->points_max ? 2 * p->points_max : 256;
+  p->points = xrealloc(p->points, p->points_max);
+}
+
+
+/* droceRoG: a range of SGF coordinates, i.e. letters */
+static int
+is_point_range(const char *v, size_t len)
+{
+  return len == 5 && v[2] == ':'
+    && isalpha((int) (unsigned char) v[0]) && isalpha((int) (unsigned char) v[1])
+    && isalpha((int) (unsigned char) v[3]) && isalpha((int) (unsigned char) v[4])
+    && v[0] <= v[3] && v[1] <= v[4];
+}
+
+
+/* droceRoG: maximal number of points in one property */
+#define MAX_PACKED_POINTS 60000
+
+
+/*
+ * droceRoG: The values of a point list and all points of its ranges go
+ * into one property, see sgfNumPoints(). Values which are no point, e.g.
+ * an empty one, are kept as properties of their own.
+ */
+
+static int
+pointlist_property(SGFParser *p, short sgf_name, SGFNode *n,
+		   SGFProperty **last)
+{
+  size_t len = 0;
+  char *v, *e;
+  char range[5];
+  char x, y;
+
+  do {
+    if (!match(p, '['))
+      return 0;
+    points_reserve(p, len, propvalue_bound(p) + 1);
+    v = p->points + len;
+    e = propvalue_decode(p, v);
+    if (!e)
+      return 0;
+
+    if (e - v == 2)
+      len += 2;
+    else if (is_point_range(v, e - v)) {
+      memcpy(range, v, 5);
+      points_reserve(p, len, 2 * (range[3] - range[0] + 1) * (range[4] - range[1] + 1) + 1);
+      for (x = range[0]; x <= range[3]; x++)
+	for (y = range[1]; y <= range[4]; y++) {
+	  p->points[len++] = x;
+	  p->points[len++] = y;
+	}
+    }
+    else
+      *last = do_sgf_make_property(sgf_name, v, n, *last, p->arena);
+
+    /* start another property before the count overflows */
+    if (len >= 2 * MAX_PACKED_POINTS || (len > 0 && p->lookahead != '[')) {
+      p->points[len] = '\0';
+      *last = do_sgf_make_property(sgf_name, p->points, n, *last, p->arena);
+      (*last)->points = len / 2;
+      len = 0;
+    }
+  } while (p->lookahead == '[');
+
+  return 1;
+}
+
+
+static int
+property(SGFParser *p, SGFNode *n, SGFProperty **last)
 {
   char name[3];
-  char buffer[4000];
+  char *value;
 
-  propident(name, sizeof(name));
+  if (!propident(p, name, sizeof(name)))
+    return 0;
+  if (sgf_allows_ranges(sgf_prop_name(name)))
+    return pointlist_property(p, sgf_prop_name(name), n, last);
   do {
-    propvalue(buffer, sizeof(buffer));
-    last = sgfMkProperty(name, buffer, n, last);
-  } while (lookahead == '[');
-  return last;
+    value = propvalue(p);
+    if (!value)
+      return 0;
+    *last = make_property(name, value, 1, n, *last, p->arena);
+  } while (p->lookahead == '[');
+  return 1;
 }
 
 
-static void
-node(SGFNode *n)
+static int
+node(SGFParser *p, SGFNode *n)
 {
   SGFProperty *last = NULL;
-  match(';');
-  while (lookahead != EOF && isupper(lookahead))
-    last = property(n, last);
+  if (!match(p, ';'))
+    return 0;
+  while (p->lookahead != EOF && isupper(p->lookahead))
+    if (!property(p, n, &last))
+      return 0;
+  return 1;
 }
 
 
-static SGFNode *
-sequence(SGFNode *n)
+static int
+sequence(SGFParser *p, SGFNode *n, SGFNode **last)
 {
-  node(n);
-  while (lookahead == ';') {
-    SGFNode *new = sgfNewNode();
+  *last = n;
+  if (!node(p, n))
+    return 0;
+  while (p->lookahead == ';') {
+    SGFNode *new = parse_new_node(p->arena);
     new->parent = n;
     n->child = new;
     n = new;
-    node(n);
+    *last = n;
+    if (!node(p, n))
+      return 0;
   }
-  return n;
+  return 1;
 }
 
 
-static void
-gametree(SGFNode **p, SGFNode *parent, int mode) 
+/*
+ * Skip everything up to the first node of a game tree. The opening
+ * parenthesis is required for STRICT_SGF.
+ */
+
+static int
+gametree_begin(SGFParser *p, int mode)
 {
   if (mode == STRICT_SGF)
-    match('(');
-  else
-    for (;;) {
-      if (lookahead == EOF) {
-	parse_error("Empty file?", 0);
+    return match(p, '(');
+
+  for (;;) {
+    if (p->lookahead == EOF)
+      return parse_error(p, "Empty file?", 0);
+    if (p->lookahead == '(') {
+      while (p->lookahead == '(')
+	nexttoken(p);
+      if (p->lookahead == ';')
 	break;
-      }
-      if (lookahead == '(') {
-	while (lookahead == '(')
-	  nexttoken();
-	if (lookahead == ';')
-	  break;
-      }
-      nexttoken();
-    }
-
-  /* The head is parsed */
-  {
-    SGFNode *head = sgfNewNode();
-    SGFNode *last;
-
-    head->parent = parent;
-    *p = head;
-
-    last = sequence(head);
-    p = &last->child;
-    while (lookahead == '(') {
-      gametree(p, last, STRICT_SGF);
-      p = &((*p)->next);
     }
-    if (mode == STRICT_SGF)
-      match(')');
+    nexttoken(p);
   }
+  return 1;
 }
 
 
 /*
- * Fuseki readers
- * Reads an SGF file for extract_fuseki in a compact way
+ * droceRoG: Skip a game tree without building nodes. The lookahead is
+ * its opening parenthesis.
  */
 
-static void
-gametreefuseki(SGFNode **p, SGFNode *parent, int mode, 
-	       int moves_per_game, int i)
-{
-  if (mode == STRICT_SGF)
-    match('(');
-  else
-    for (;;) {
-      if (lookahead == EOF) {
-	parse_error("Empty file?", 0);
+static int
+skip_gametree(SGFParser *p)
+{
+  int depth = 0;
+  int c;
+
+  while (p->lookahead != EOF) {
+    if (p->lookahead == '[') {
+      /* property values may contain parentheses */
+      do {
+	c = sgf_getch(p);
+	if (c == '\\')
+	  c = sgf_getch(p) == EOF ? EOF : 0;
+      } while (c != ']' && c != EOF);
+      if (c == EOF)
 	break;
-      }
-      if (lookahead == '(') {
-	while (lookahead == '(')
-	  nexttoken();
-	if (lookahead == ';')
-	  break;
-      }
-      nexttoken();
     }
-  
-  /* The head is parsed */
-  {
-
-    SGFNode *head = sgfNewNode();
-    SGFNode *last;
-    head->parent = parent;
-    *p = head;
-    
-    last = sequence(head);
-    p = &last->child;
-    while (lookahead == '(') {
-      if (last->props 
-	  && (last->props->name == SGFB || last->props->name == SGFW))
-	i++;
-      /* break after number_of_moves moves in SGF file */
-      if (i >= moves_per_game) { 
-	last->child = NULL;
-	last->next = NULL;
-	break;
-      }
-      else {
-	gametreefuseki(p, last, mode, moves_per_game, i);
-	p = &((*p)->next);
+    else if (p->lookahead == '(')
+      depth++;
+    else if (p->lookahead == ')') {
+      depth--;
+      if (depth == 0) {
+	nexttoken(p);
+	return 1;
       }
     }
-    if (mode == STRICT_SGF)
-      match(')');
+    nexttoken(p);
   }
-}
 
-SGFNode *
-readsgffilefuseki(const char *filename, int moves_per_game)
-{
-  SGFNode *root;
-  int tmpi = 0;
+  return parse_error(p, "expected: %c", ')');
+}
 
-  if (strcmp(filename, "-") == 0)
-    sgffile = stdin;
-  else
-    sgffile = fopen(filename, "r");
 
-  if (!sgffile)
-    return NULL;
+static int gametree(SGFParser *p, SGFNode **head_ptr, SGFNode *parent,
+		    int mode);
 
 
-  nexttoken();
-  gametreefuseki(&root, NULL, LAX_SGF, moves_per_game, 0);
+/*
+ * The nodes of a game tree after its opening parenthesis. The first
+ * node goes into head.
+ */
+
+static int
+gametree_body(SGFParser *p, SGFNode *head, int mode)
+{
+  SGFNode *last;
+  SGFNode **head_ptr;
+
+  if (!sequence(p, head, &last))
+    return 0;
+  head_ptr = &last->child;
+  while (p->lookahead == '(') {
+    if (p->lazy && last->child) {
+      /* droceRoG: further variations are parsed on demand */
+      SGFNode *stub = parse_new_node(p->arena);
+      stub->parent = last;
+      stub->lazy_offset = p->ptr - 1 - p->begin;
+      *head_ptr = stub;
+      if (!skip_gametree(p))
+	return 0;
+    }
+    else if (!gametree(p, head_ptr, last, STRICT_SGF))
+      return 0;
+    head_ptr = &((*head_ptr)->next);
+  }
+  if (mode == STRICT_SGF)
+    return match(p, ')');
+  return 1;
+}
+
+
+static int
+gametree(SGFParser *p, SGFNode **head_ptr, SGFNode *parent, int mode) 
+{
+  SGFNode *head;
+
+  if (!gametree_begin(p, mode))
+    return 0;
+
+  /* The head is parsed */
+  head = parse_new_node(p->arena);
+  head->parent = parent;
+  *head_ptr = head;
+
+  return gametree_body(p, head, mode);
+}
+
+
+/*
+ * droceRoG: Read the whole file into one buffer (a single read instead
+ * of one getc per character). Filename "-" means stdin. The buffer has
+ * to be released by free().
+ */
+
+static char *
+read_input(const char *filename, size_t *len)
+{
+  FILE *file;
+  char *buf;
+  size_t size, n;
+  long pos;
+
+  if (strcmp(filename, "-") == 0)
+    file = stdin;
+  else
+    file = fopen(filename, "rb");
+
+  if (!file)
+    return NULL;
+
+  /* the size of regular files is known in advance, one spare byte
+   * lets the read loop see the end of file without growing the buffer */
+  size = 0;
+  if (file != stdin && fseek(file, 0, SEEK_END) == 0) {
+    pos = ftell(file);
+    if (pos > 0)
+      size = (size_t) pos + 1;
+    rewind(file);
+  }
+  if (size == 0)
+    size = 65536;
+
+  buf = xalloc(size);
+  *len = 0;
+  while ((n = fread(buf + *len, 1, size - *len, file)) > 0) {
+    *len += n;
+    if (*len == size) {
+      size *= 2;
+      buf = xrealloc(buf, size);
+    }
+  }
+
+  if (file != stdin)
+    fclose(file);
+
+  return buf;
+}
+
+/*
+ * droceRoG: Read length bytes from offset of filename, e.g. one game of
+ * a collection. Fewer bytes are returned at the end of the file.
+ */
+
+static char *
+read_input_range(const char *filename, long offset, long length, size_t *len)
+{
+  FILE *file;
+  char *buf;
+
+  if (offset < 0 || length <= 0)
+    return NULL;
+
+  file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  if (fseek(file, offset, SEEK_SET) != 0) {
+    fclose(file);
+    return NULL;
+  }
+
+  buf = xalloc(length + 1);
+  *len = fread(buf, 1, length, file);
+  fclose(file);
+
+  return buf;
+}
+
+#ifdef DROCEROG_PERF
+__thread long sgf_perf_varinfo_calls = 0;
+__thread double sgf_perf_varinfo_ms = 0;
+__thread double sgf_perf_varinfo_max = 0;
+#endif
+
+static SGFNode *readsgf_buffer(const char *buf, size_t len, SGFArena *arena,
+			       int flags);
+static void build_varinfo(SGFNode *root);
+static void reset_varinfo(SGFNode *node);
+static void build_evtlinks(SGFNode *node);
+
+
+/*
+ * Fuseki readers
+ * Reads an SGF file for extract_fuseki in a compact way
+ */
+
+static int
+gametreefuseki(SGFParser *p, SGFNode **head_ptr, SGFNode *parent, int mode, 
+	       int moves_per_game, int i)
+{
+  if (!gametree_begin(p, mode))
+    return 0;
+  
+  /* The head is parsed */
+  {
+
+    SGFNode *head = parse_new_node(p->arena);
+    SGFNode *last;
+    head->parent = parent;
+    *head_ptr = head;
+    
+    if (!sequence(p, head, &last))
+      return 0;
+    head_ptr = &last->child;
+    while (p->lookahead == '(') {
+      if (last->props 
+	  && (last->props->name == SGFB || last->props->name == SGFW))
+	i++;
+      /* break after number_of_moves moves in SGF file */
+      if (i >= moves_per_game) { 
+	last->child = NULL;
+	last->next = NULL;
+	break;
+      }
+      else {
+	if (!gametreefuseki(p, head_ptr, last, mode, moves_per_game, i))
+	  return 0;
+	head_ptr = &((*head_ptr)->next);
+      }
+    }
+    if (mode == STRICT_SGF)
+      return match(p, ')');
+  }
+  return 1;
+}
+
+SGFNode *
+readsgffilefuseki(const char *filename, int moves_per_game)
+{
+  SGFParser parser;
+  SGFNode *root = NULL;
+  int tmpi = 0;
+  char *buf;
+  size_t len;
+
+  buf = read_input(filename, &len);
+  if (!buf)
+    return NULL;
 
-  fclose(sgffile);
+  parser_init(&parser, buf, len, NULL);
+  nexttoken(&parser);
+  gametreefuseki(&parser, &root, NULL, LAX_SGF, moves_per_game, 0);
+  parser_free(&parser);
 
-  if (sgferr) {
-    fprintf(stderr, "Parse error: %s at position %d\n", sgferr, sgferrpos);
+  free(buf);
+
+  if (parser.err) {
+    fprintf(stderr, "Parse error: ");
+    fprintf(stderr, parser.err, parser.errarg);
+    fprintf(stderr, " at position %d\n", parser.errpos);
     sgfFreeNode(root);
     return NULL;
   }
@@ -1202,28 +1748,279 @@ readsgffilefuseki(const char *filename, int moves_per_game)
 
 SGFNode *
 readsgffile(const char *filename)
+{
+    return readsgffile_arena(filename, NULL, 0, NULL, NULL);
+}
+
+/*
+ * droceRoG: Same as readsgffile, but nodes, properties and values are
+ * allocated from arena. If arena is NULL, they are allocated
+ * separately and the tree has to be freed by sgfFreeNode(). With
+ * SGF_READ_LAZY, the input is kept for sgfMaterialize() and returned
+ * in *input.
+ */
+
+SGFNode *
+readsgffile_arena(const char *filename, SGFArena *arena, int flags,
+		  char **input, size_t *input_len)
 {
     SGFNode *root;
-    int tmpi = 0;
+    char *buf;
+    size_t len;
 
-    if (strcmp(filename, "-") == 0)
-        sgffile = stdin;
-    else
-        sgffile = fopen(filename, "r");
+    assert(!(flags & SGF_READ_LAZY) || (input && input_len));
 
-    if (!sgffile)
+    buf = read_input(filename, &len);
+    if (!buf)
         return NULL;
 
+    root = readsgf_buffer(buf, len, arena, flags);
+    if (root && (flags & SGF_READ_LAZY)) {
+        *input = buf;
+        *input_len = len;
+    } else
+        free(buf);
+
+    return root;
+}
+
+/*
+ * droceRoG: Same as readsgffile_arena, but only the game tree in length
+ * bytes from offset is read. Offsets of placeholders refer to *input,
+ * i.e. to these bytes.
+ */
+
+SGFNode *
+readsgffile_range(const char *filename, long offset, long length,
+		  SGFArena *arena, int flags, char **input, size_t *input_len)
+{
+    SGFNode *root;
+    char *buf;
+    size_t len;
+
+    assert(!(flags & SGF_READ_LAZY) || (input && input_len));
+
+    buf = read_input_range(filename, offset, length, &len);
+    if (!buf)
+        return NULL;
+
+    root = readsgf_buffer(buf, len, arena, flags);
+    if (root && (flags & SGF_READ_LAZY)) {
+        *input = buf;
+        *input_len = len;
+    } else
+        free(buf);
+
+    return root;
+}
+
+/*
+ * droceRoG: Parse the variation behind a placeholder node into the node
+ * itself. Forks inside it get placeholders again.
+ */
+
+int
+sgfMaterialize(SGFNode *node, const char *input, size_t input_len,
+	       SGFArena *arena)
+{
+    SGFParser parser;
+    int ok;
+
+    if (!sgfIsLazy(node))
+        return 1;
+    assert((size_t) node->lazy_offset < input_len);
+
+    parser_init(&parser, input, input_len, arena);
+    parser.ptr = input + node->lazy_offset;
+    parser.lazy = 1;
+    node->lazy_offset = -1;
+
+    nexttoken(&parser);
+    ok = gametree_begin(&parser, STRICT_SGF)
+         && gametree_body(&parser, node, STRICT_SGF);
+    parser_free(&parser);
+    if (!ok) {
+        fprintf(stderr, "Parse error: ");
+        fprintf(stderr, parser.err, parser.errarg);
+        fprintf(stderr, " at position %d\n", parser.errpos);
+    }
+
+    /* the new nodes change links and draw levels of the others */
+    build_varinfo(sgfRoot(node));
+
+    return ok;
+}
 
-    nexttoken();
-    gametree(&root, NULL, LAX_SGF);
+/*
+ * droceRoG: Read an SGF tree from len bytes at buf. The tree has to be
+ * freed by sgfFreeNode().
+ */
+
+SGFNode *
+readsgf_from_memory(const char *buf, size_t len)
+{
+    return readsgf_buffer(buf, len, NULL, 0);
+}
+
+/*
+ * droceRoG: Same as readsgffile_arena(), but from len bytes at buf. With
+ * SGF_READ_LAZY, buf has to stay until the placeholders are parsed.
+ */
+
+SGFNode *
+readsgf_from_memory_arena(const char *buf, size_t len, SGFArena *arena,
+			  int flags)
+{
+    return readsgf_buffer(buf, len, arena, flags);
+}
+
+/*
+ * droceRoG: Scan a collection for its top level game trees. Property
+ * values are skipped as in skip_gametree(), the root node of each tree
+ * is searched for the game info. Nothing is allocated but *games.
+ */
+
+static void
+scan_copy_value(char *dst, int size, const char *v, const char *end)
+{
+  int n = 0;
+
+  for (; v < end && *v != ']'; v++) {
+    if (*v == '\\' && v + 1 < end)
+      v++;
+    /* line breaks and tabs are shown as blanks */
+    if (n < size - 1)
+      dst[n++] = ((unsigned char) *v < ' ') ? ' ' : *v;
+  }
+  while (n > 0 && dst[n - 1] == ' ')
+    n--;
+  dst[n] = '\0';
+}
+
+int
+sgfScanCollection(const char *buf, size_t len, SGFGameInfo **games)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    SGFGameInfo *g = NULL;
+    SGFGameInfo *ev_of = NULL;  /* game whose name is still the event */
+    char name[3];
+    int num = 0, max = 0;
+    int depth = 0;
+    int in_root = 0;            /* before the second node of a game */
+    int num_nodes = 0;
+    int n = 0, in_name = 0;
+
+    *games = NULL;
+
+    for (; p < end; p++) {
+        if (*p == '[') {
+            name[n] = '\0';
+            in_name = 0;
+            if (in_root && g) {
+                if (strcmp(name, "PB") == 0 && !g->pb[0])
+                    scan_copy_value(g->pb, sizeof(g->pb), p + 1, end);
+                else if (strcmp(name, "PW") == 0 && !g->pw[0])
+                    scan_copy_value(g->pw, sizeof(g->pw), p + 1, end);
+                else if (strcmp(name, "DT") == 0 && !g->dt[0])
+                    scan_copy_value(g->dt, sizeof(g->dt), p + 1, end);
+                else if (strcmp(name, "RE") == 0 && !g->re[0])
+                    scan_copy_value(g->re, sizeof(g->re), p + 1, end);
+                else if (strcmp(name, "GN") == 0 && (!g->gn[0] || ev_of == g)) {
+                    scan_copy_value(g->gn, sizeof(g->gn), p + 1, end);
+                    ev_of = NULL;
+                }
+                else if (strcmp(name, "EV") == 0 && !g->gn[0]) {
+                    scan_copy_value(g->gn, sizeof(g->gn), p + 1, end);
+                    ev_of = g;
+                }
+            }
+
+            /* skip the value, it may contain parentheses */
+            for (p++; p < end && *p != ']'; p++)
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+            if (p == end)
+                break;
+            continue;
+        }
+
+        if (isalpha((int) (unsigned char) *p)) {
+            /* property name, lower case letters are ignored as in the parser */
+            if (!in_name) {
+                n = 0;
+                in_name = 1;
+            }
+            if (isupper((int) (unsigned char) *p) && n < 2)
+                name[n++] = *p;
+            continue;
+        }
+        if (isspace((int) (unsigned char) *p))
+            continue;
+        in_name = 0;
+
+        if (*p == '(') {
+            if (depth == 0) {
+                if (num == max) {
+                    max = max ? 2 * max : 16;
+                    *games = xrealloc(*games, max * sizeof(SGFGameInfo));
+                }
+                g = *games + num++;
+                memset(g, 0, sizeof(SGFGameInfo));
+                g->offset = p - buf;
+                g->length = end - p;
+                in_root = 1;
+                num_nodes = 0;
+            }
+            else if (num_nodes > 0)
+                in_root = 0;
+            depth++;
+        }
+        else if (*p == ')' && depth > 0) {
+            depth--;
+            in_root = 0;
+            if (depth == 0) {
+                g->length = p + 1 - buf - g->offset;
+                /* text without a node is no game */
+                if (num_nodes == 0)
+                    num--;
+            }
+        }
+        else if (*p == ';' && depth > 0) {
+            if (++num_nodes > 1)
+                in_root = 0;
+        }
+    }
+
+    if (depth > 0 && num_nodes == 0)
+        num--;
+    if (num == 0) {
+        free(*games);
+        *games = NULL;
+    }
+
+    return num;
+}
 
-    if (sgffile != stdin)
-        fclose(sgffile);
+static SGFNode *
+readsgf_buffer(const char *buf, size_t len, SGFArena *arena, int flags)
+{
+    SGFParser parser;
+    SGFNode *root = NULL;
+    int tmpi = 0;
 
-    if (sgferr) {
-        fprintf(stderr, "Parse error: %s at position %d\n", sgferr, sgferrpos);
-        sgfFreeNode(root);
+    parser_init(&parser, buf, len, arena);
+    parser.lazy = flags & SGF_READ_LAZY;
+    nexttoken(&parser);
+    gametree(&parser, &root, NULL, LAX_SGF);
+    parser_free(&parser);
+
+    if (parser.err) {
+        fprintf(stderr, "Parse error: ");
+        fprintf(stderr, parser.err, parser.errarg);
+        fprintf(stderr, " at position %d\n", parser.errpos);
+        if (!arena)
+            sgfFreeNode(root);
         return NULL;
     }
 
@@ -1244,12 +2041,35 @@ readsgffile(const char *filename)
     else if ((tmpi < 3 || tmpi > 4) && VERBOSE_WARNINGS)
         fprintf(stderr, "Unsupported SGF spec version: %d\n", tmpi);
 
-    /* droceRoG: build up variation links with sweep line method */
+    build_varinfo(root);
+
+    return root;
+}
+
+/*
+ * droceRoG: Variation links, draw levels and move numbers of all nodes.
+ * They are computed again after a placeholder has been parsed.
+ */
+
+static void
+build_varinfo(SGFNode *root)
+{
+    int num_depths = 0;
+#ifdef DROCEROG_PERF
+    struct timespec perf_t0, perf_t1;
+    double perf_ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &perf_t0);
+#endif
+
+    reset_varinfo(root);
+
+    /* droceRoG: build up variation links with sweep line method, the
+     * number of lists is the depth of the tree */
     {
         SGFNode *lst = root;
         SGFNode *cur_i = NULL;
         SGFNode *cur_end = NULL;
-        // SGFNode *var = NULL;
 
         /* initialise lst by its next pointers from root SGFNode */
         /* Assuming there is only one variation at the beginning! */
@@ -1257,6 +2077,8 @@ readsgffile(const char *filename)
 
         /* while lst has elements */
         while (lst) {
+            num_depths++;
+
             /* next move for each element (and deleting) */
             cur_i = lst;
             lst = NULL; /* save beginning of list */
@@ -1286,36 +2108,44 @@ readsgffile(const char *filename)
             }
         }
     }
-    // fprintf(stderr, "END while(lst)\n");
 
-    /* droceRoG: determine draw level */
+    /* droceRoG: determine draw level. Instead of scanning the sweep line
+     * at each depth, the highest level used so far is kept per depth
+     * (skyline), so each node is visited a constant number of times. */
     {
         SGFNode *curMove = NULL;
         SGFNode *curVar = NULL;
-        SGFNode *i = NULL, *j = NULL;
-        int lvl = 0;
+        SGFNode *i = NULL;
+        int *top;
+        int lvl, depth, d;
+
+        top = (int *) malloc(sizeof(int) * num_depths);
+        if (top == NULL) {
+            fprintf(stderr, "Out of memory in build_varinfo\n");
+            return;
+        }
+        for (d=0; d<num_depths; d++)
+            top[d] = -1;
 
         /* main variation has level of zero */
-        for (curMove=root; curMove; curMove=curMove->child) 
+        depth = 0;
+        for (curMove=root; curMove; curMove=curMove->child) {
             curMove->draw_lvl = 0;
+            top[depth++] = 0;
+        }
 
         /* get last element */
         for (curMove=root; curMove->child; curMove=curMove->child) {}
+        depth -= 1;
 
         /* go back in time */
-        for (; curMove; curMove=curMove->parent) {
-            curVar = curMove->next;
-            while (curVar) {
+        for (; curMove; curMove=curMove->parent, depth--) {
+            for (curVar=curMove->next; curVar; curVar=curVar->next) {
+                /* lowest level free at all depths so far */
                 lvl = 0;
-                for (i=curVar; i; i=i->child) {
-                    for (j=i; j; j=j->prevVar) {
-                        if (lvl <= j->draw_lvl+1) 
-                            lvl = j->draw_lvl+1;
-                    }
-                    for (j=i; j; j=j->nextVar) {
-                        if (lvl <= j->draw_lvl+1) 
-                            lvl = j->draw_lvl+1;
-                    }
+                for (i=curVar, d=depth; i; i=i->child, d++) {
+                    if (lvl <= top[d]+1) 
+                        lvl = top[d]+1;
 
                     i->draw_lvl = lvl;
                 }
@@ -1330,10 +2160,14 @@ readsgffile(const char *filename)
                         i->draw_lvl = i->parent->draw_lvl + 1;
                 }
 
-                curVar = curVar->next;
+                for (i=curVar, d=depth; i; i=i->child, d++) {
+                    if (top[d] < i->draw_lvl)
+                        top[d] = i->draw_lvl;
+                }
             }
         }
 
+        free(top);
     }
 
     /* determine move number */
@@ -1351,7 +2185,87 @@ readsgffile(const char *filename)
         }
     }
 
-    return root;
+    /* droceRoG: links to the next and previous comment, fork or end */
+    build_evtlinks(root);
+
+#ifdef DROCEROG_PERF
+    clock_gettime(CLOCK_MONOTONIC, &perf_t1);
+    perf_ms = (perf_t1.tv_sec - perf_t0.tv_sec) * 1e3
+              + (perf_t1.tv_nsec - perf_t0.tv_nsec) / 1e6;
+    sgf_perf_varinfo_calls += 1;
+    sgf_perf_varinfo_ms += perf_ms;
+    if (perf_ms > sgf_perf_varinfo_max)
+        sgf_perf_varinfo_max = perf_ms;
+#endif
+}
+
+/*
+ * droceRoG: Same for callers outside the reader, e.g. to time the
+ * post-processing separately.
+ */
+
+void
+sgfBuildVarInfo(SGFNode *root)
+{
+    build_varinfo(root);
+}
+
+/*
+ * droceRoG: Set nextEvt and prevEvt of the line beginning at node and of
+ * its variations. nextEvt is the first node following the children which
+ * has a comment, a sibling or no child, prevEvt the first parent with a
+ * comment, a fork or no parent. The links point to the node itself at
+ * the end and at the root.
+ */
+
+static void
+build_evtlinks(SGFNode *node)
+{
+    SGFNode *nd, *last = NULL, *step;
+
+    /* down the line: prevEvt depends on the parent */
+    for (nd = node; nd; nd = nd->child) {
+        step = nd->parent;
+        if (step == NULL)
+            nd->prevEvt = nd;
+        else if (step->parent == NULL || step->next || step->parent->child->next
+                 || sgfHasProps(step, SGF_PROP_C))
+            nd->prevEvt = step;
+        else
+            nd->prevEvt = step->prevEvt;
+
+        build_evtlinks(nd->next);
+        last = nd;
+    }
+
+    /* up the line: nextEvt depends on the first child */
+    for (nd = last; nd; nd = nd->parent) {
+        step = nd->child;
+        if (step == NULL)
+            nd->nextEvt = nd;
+        else if (step->child == NULL || step->next || sgfHasProps(step, SGF_PROP_C))
+            nd->nextEvt = step;
+        else
+            nd->nextEvt = step->nextEvt;
+
+        if (nd == node)
+            break;
+    }
+}
+
+static void
+reset_varinfo(SGFNode *node)
+{
+    while (node) {
+        reset_varinfo(node->next);
+        node->prevVar = NULL;
+        node->nextVar = NULL;
+        node->draw_lvl = -1;
+        node->move_num = 0;
+        node->nextEvt = NULL;
+        node->prevEvt = NULL;
+        node = node->child;
+    }
 }
 
 
@@ -1425,24 +2339,33 @@ static void
 sgf_print_property(FILE *file, SGFNode *node, short name, int is_comment)
 {
   int n = 0;
+  int k;
   SGFProperty *prop;
 
   for (prop = node->props; prop; prop = prop->next) {
     if (prop->name == name) {
       prop->name |= 0x20;  /* Indicate already printed. */
-      if (n == 0) {
-	sgf_print_name(file, name);
-	sgf_putc('[', file);
-      }
-      else if (is_comment)
-	sgf_putc('\n', file);
-      else {
-	sgf_putc(']', file);
-	sgf_putc('[', file);
+      /* droceRoG: each point of a point list is a value of its own */
+      for (k = 0; k < sgfNumPoints(prop); k++) {
+	if (n == 0) {
+	  sgf_print_name(file, name);
+	  sgf_putc('[', file);
+	}
+	else if (is_comment)
+	  sgf_putc('\n', file);
+	else {
+	  sgf_putc(']', file);
+	  sgf_putc('[', file);
+	}
+
+	if (prop->points > 0) {
+	  sgf_putc(prop->value[2 * k], file);
+	  sgf_putc(prop->value[2 * k + 1], file);
+	}
+	else
+	  sgf_puts(prop->value, file);
+	n++;
       }
-      
-      sgf_puts(prop->value, file);
-      n++;
     }
   }
 
@@ -1644,27 +2567,546 @@ writesgf(SGFNode *root, const char *filename)
 }
 
 
+/* ================================================================ */
+/*                     droceRoG: Binary tree cache                  */
+/* ================================================================ */
+
+/*
+ * A parsed tree with variation links, draw levels and move numbers is
+ * stored as a flat node table with index based links, a property table
+ * and a string pool. The first pool string is the name of the source
+ * file, which is checked with its mtime and size when loading.
+ */
+
+#define SGFBIN_MAGIC "DRSGFB04"
+
+typedef struct {
+  char magic[8];
+  long mtime;
+  long size;
+  int num_nodes;
+  int num_props;
+  int pool_size;
+} SGFBinHeader;
+
+typedef struct {
+  int parent, child, next, prevVar, nextVar;  /* -1: none */
+  int nextEvt, prevEvt;
+  int draw_lvl;
+  int move_num;
+  int props;                                  /* first property */
+  int num_props;
+  unsigned int prop_mask;
+} SGFBinNode;
+
+typedef struct {
+  short name;
+  unsigned short points;                      /* packed point list */
+  int value;                                  /* offset in the pool */
+} SGFBinProp;
+
+static int
+sgfbin_ptr_cmp(const void *a, const void *b)
+{
+  SGFNode *na = *(SGFNode * const *) a;
+  SGFNode *nb = *(SGFNode * const *) b;
+
+  return na < nb ? -1 : na > nb;
+}
+
+/* Collect the nodes in preorder. Returns 0 for an unparsed variation. */
+static int
+sgfbin_collect(SGFNode *node, SGFNode **nodes, int *num)
+{
+  for (; node; node = node->child) {
+    if (sgfIsLazy(node))
+      return 0;
+    if (nodes)
+      nodes[*num] = node;
+    (*num)++;
+    if (!sgfbin_collect(node->next, nodes, num))
+      return 0;
+  }
+
+  return 1;
+}
+
+/* Index of node in the sorted table, -1 for NULL. */
+static int
+sgfbin_index(SGFNode *node, SGFNode **sorted, int *ids, int num)
+{
+  SGFNode **pt;
+
+  if (node == NULL)
+    return -1;
+  pt = bsearch(&node, sorted, num, sizeof(SGFNode *), sgfbin_ptr_cmp);
+  assert(pt != NULL);
+  return ids[pt - sorted];
+}
+
+/*
+ * Write the tree of root to filename. source, mtime and size identify
+ * the SGF file. Trees with unparsed variations are not written.
+ * Returns 1 on success.
+ */
+
+int
+writesgfbin(SGFNode *root, const char *filename, const char *source,
+	    long mtime, long size)
+{
+  FILE *outfile;
+  SGFBinHeader header;
+  SGFBinNode bn;
+  SGFBinProp bp;
+  SGFNode **nodes, **sorted;
+  SGFProperty *prop;
+  int *ids;
+  int i, k, num = 0, ok;
+
+  if (!sgfbin_collect(root, NULL, &num))
+    return 0;
+
+  nodes = malloc(sizeof(SGFNode *) * num);
+  sorted = malloc(sizeof(SGFNode *) * num);
+  ids = malloc(sizeof(int) * num);
+  if (!nodes || !sorted || !ids) {
+    free(nodes);
+    free(sorted);
+    free(ids);
+    return 0;
+  }
+  num = 0;
+  sgfbin_collect(root, nodes, &num);
+
+  /* pointer to index lookup for the variation links */
+  memcpy(sorted, nodes, sizeof(SGFNode *) * num);
+  qsort(sorted, num, sizeof(SGFNode *), sgfbin_ptr_cmp);
+  for (i = 0; i < num; i++) {
+    SGFNode **pt = bsearch(&nodes[i], sorted, num, sizeof(SGFNode *),
+			   sgfbin_ptr_cmp);
+    ids[pt - sorted] = i;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SGFBIN_MAGIC, 8);
+  header.mtime = mtime;
+  header.size = size;
+  header.num_nodes = num;
+  header.pool_size = strlen(source) + 1;
+  for (i = 0; i < num; i++)
+    for (prop = nodes[i]->props; prop; prop = prop->next) {
+      header.num_props++;
+      header.pool_size += strlen(prop->value) + 1;
+    }
+
+  outfile = fopen(filename, "wb");
+  if (!outfile) {
+    fprintf(stderr, "Can not open %s\n", filename);
+    free(nodes);
+    free(sorted);
+    free(ids);
+    return 0;
+  }
+
+  ok = fwrite(&header, sizeof(header), 1, outfile) == 1;
+
+  k = 0;
+  for (i = 0; ok && i < num; i++) {
+    memset(&bn, 0, sizeof(bn));
+    bn.parent = sgfbin_index(nodes[i]->parent, sorted, ids, num);
+    bn.child = sgfbin_index(nodes[i]->child, sorted, ids, num);
+    bn.next = sgfbin_index(nodes[i]->next, sorted, ids, num);
+    bn.prevVar = sgfbin_index(nodes[i]->prevVar, sorted, ids, num);
+    bn.nextVar = sgfbin_index(nodes[i]->nextVar, sorted, ids, num);
+    bn.nextEvt = sgfbin_index(nodes[i]->nextEvt, sorted, ids, num);
+    bn.prevEvt = sgfbin_index(nodes[i]->prevEvt, sorted, ids, num);
+    bn.draw_lvl = nodes[i]->draw_lvl;
+    bn.move_num = nodes[i]->move_num;
+    bn.props = k;
+    for (prop = nodes[i]->props; prop; prop = prop->next)
+      k++;
+    bn.num_props = k - bn.props;
+    bn.prop_mask = nodes[i]->prop_mask;
+    ok = fwrite(&bn, sizeof(bn), 1, outfile) == 1;
+  }
+
+  k = strlen(source) + 1;
+  for (i = 0; ok && i < num; i++)
+    for (prop = nodes[i]->props; ok && prop; prop = prop->next) {
+      memset(&bp, 0, sizeof(bp));
+      bp.name = prop->name;
+      bp.points = prop->points;
+      bp.value = k;
+      k += strlen(prop->value) + 1;
+      ok = fwrite(&bp, sizeof(bp), 1, outfile) == 1;
+    }
+
+  ok = ok && fwrite(source, strlen(source) + 1, 1, outfile) == 1;
+  for (i = 0; ok && i < num; i++)
+    for (prop = nodes[i]->props; ok && prop; prop = prop->next)
+      ok = fwrite(prop->value, strlen(prop->value) + 1, 1, outfile) == 1;
+
+  if (fclose(outfile) != 0)
+    ok = 0;
+
+  free(nodes);
+  free(sorted);
+  free(ids);
+
+  return ok;
+}
+
+/*
+ * Load a tree written by writesgfbin() with a single read into arena.
+ * Property values point into the string pool. Returns NULL if the file
+ * cannot be read or belongs to another version of source.
+ */
+
+SGFNode *
+readsgfbin(const char *filename, const char *source, long mtime, long size,
+	   SGFArena *arena)
+{
+  FILE *infile;
+  SGFBinHeader *header;
+  SGFBinNode *bn;
+  SGFBinProp *bp;
+  SGFNode *nodes;
+  SGFProperty *props;
+  char *buf, *pool;
+  long len;
+  int i, k, n;
+
+  infile = fopen(filename, "rb");
+  if (!infile)
+    return NULL;
+
+  len = -1;
+  if (fseek(infile, 0, SEEK_END) == 0) {
+    len = ftell(infile);
+    rewind(infile);
+  }
+  if (len < (long) sizeof(SGFBinHeader)) {
+    fclose(infile);
+    return NULL;
+  }
+  buf = sgfArenaAlloc(arena, len);
+  if (fread(buf, len, 1, infile) != 1) {
+    fclose(infile);
+    return NULL;
+  }
+  fclose(infile);
+
+  /* check version, source and consistency of the tables */
+  header = (SGFBinHeader *) buf;
+  if (memcmp(header->magic, SGFBIN_MAGIC, 8) != 0
+      || header->mtime != mtime || header->size != size
+      || header->num_nodes <= 0 || header->num_props < 0 || header->pool_size <= 0
+      || len != (long) (sizeof(SGFBinHeader)
+			+ (long) header->num_nodes * sizeof(SGFBinNode)
+			+ (long) header->num_props * sizeof(SGFBinProp)
+			+ header->pool_size))
+    return NULL;
+
+  n = header->num_nodes;
+  bn = (SGFBinNode *) (buf + sizeof(SGFBinHeader));
+  bp = (SGFBinProp *) (bn + n);
+  pool = (char *) (bp + header->num_props);
+  if (pool[header->pool_size - 1] != '\0' || strcmp(pool, source) != 0)
+    return NULL;
+
+  for (i = 0; i < n; i++) {
+    if (bn[i].parent < -1 || bn[i].parent >= n
+	|| bn[i].child < -1 || bn[i].child >= n
+	|| bn[i].next < -1 || bn[i].next >= n
+	|| bn[i].prevVar < -1 || bn[i].prevVar >= n
+	|| bn[i].nextVar < -1 || bn[i].nextVar >= n
+	|| bn[i].nextEvt < -1 || bn[i].nextEvt >= n
+	|| bn[i].prevEvt < -1 || bn[i].prevEvt >= n
+	|| bn[i].props < 0 || bn[i].num_props < 0
+	|| bn[i].num_props > header->num_props - bn[i].props)
+      return NULL;
+  }
+  for (k = 0; k < header->num_props; k++)
+    if (bp[k].value < 0 || bp[k].value >= header->pool_size
+	|| (bp[k].points > 0 && strlen(pool + bp[k].value) < 2 * (size_t) bp[k].points))
+      return NULL;
+
+  /* one table for all nodes and one for all properties */
+  nodes = sgfArenaAlloc(arena, sizeof(SGFNode) * n);
+  props = sgfArenaAlloc(arena, sizeof(SGFProperty) * (header->num_props + 1));
+
+#define SGFBIN_NODE(i_) ((i_) < 0 ? NULL : &nodes[i_])
+  for (i = 0; i < n; i++) {
+    init_node(&nodes[i]);
+    nodes[i].parent = SGFBIN_NODE(bn[i].parent);
+    nodes[i].child = SGFBIN_NODE(bn[i].child);
+    nodes[i].next = SGFBIN_NODE(bn[i].next);
+    nodes[i].prevVar = SGFBIN_NODE(bn[i].prevVar);
+    nodes[i].nextVar = SGFBIN_NODE(bn[i].nextVar);
+    nodes[i].nextEvt = SGFBIN_NODE(bn[i].nextEvt);
+    nodes[i].prevEvt = SGFBIN_NODE(bn[i].prevEvt);
+    nodes[i].draw_lvl = bn[i].draw_lvl;
+    nodes[i].move_num = bn[i].move_num;
+    nodes[i].prop_mask = bn[i].prop_mask;
+
+    for (k = bn[i].props; k < bn[i].props + bn[i].num_props; k++) {
+      props[k].name = bp[k].name;
+      props[k].points = bp[k].points;
+      props[k].value = pool + bp[k].value;
+      props[k].next = k + 1 < bn[i].props + bn[i].num_props ? &props[k + 1] : NULL;
+
+      if ((props[k].name == SGFB || props[k].name == SGFW) && nodes[i].move == NULL)
+	nodes[i].move = &props[k];
+      if (props[k].name == SGFC && nodes[i].comment == NULL)
+	nodes[i].comment = &props[k];
+    }
+    if (bn[i].num_props > 0)
+      nodes[i].props = &props[bn[i].props];
+  }
+#undef SGFBIN_NODE
+
+  return &nodes[0];
+}
+
+
+/*
+ * droceRoG: Compact trees. The arrays of a compact tree are one block,
+ * the 32-bit arrays first, so each array is aligned.
+ */
+
+/* slot of a node in the hash table of sgfCompactNew() */
+#define SGFCOMPACT_HASH(node_, mask_) \
+  ((unsigned int) (((size_t) (node_) >> 4) * 2654435761u) & (mask_))
+
+/* Collect the nodes in preorder like sgfbin_collect(), placeholders of
+ * unparsed variations included. */
+static void
+sgfcompact_collect(SGFNode *node, SGFNode **nodes, unsigned int *num)
+{
+  for (; node; node = node->child) {
+    if (nodes)
+      nodes[*num] = node;
+    (*num)++;
+    sgfcompact_collect(node->next, nodes, num);
+  }
+}
+
+/* Index of node in the preorder, found in a hash table of size mask + 1
+ * with open addressing. */
+static unsigned int
+sgfcompact_index(SGFNode *node, SGFNode **keys, unsigned int *ids,
+		 unsigned int mask)
+{
+  unsigned int h;
+
+  if (node == NULL)
+    return SGF_COMPACT_NONE;
+  h = SGFCOMPACT_HASH(node, mask);
+  while (keys[h] != node) {
+    if (keys[h] == NULL)
+      return SGF_COMPACT_NONE;
+    h = (h + 1) & mask;
+  }
+  return ids[h];
+}
+
+/*
+ * Copy the tree of root in preorder. Links become indices, the values
+ * of all properties are copied to one pool.
+ */
+
+SGFCompact *
+sgfCompactNew(SGFNode *root)
+{
+  SGFCompact *c;
+  SGFNode **nodes, **keys;
+  SGFProperty *prop;
+  unsigned int *ids;
+  unsigned int i, k, p, h, mask, num = 0, num_props = 0, pool_size = 0;
+  size_t len;
+  char *mem;
+
+  sgfcompact_collect(root, NULL, &num);
+  if (num == 0)
+    return NULL;
+
+  /* the table has at least twice as many entries as there are nodes */
+  for (mask = 1; mask < 2 * num; mask = 2 * mask + 1) {}
+  nodes = malloc(sizeof(SGFNode *) * num);
+  keys = calloc(mask + 1, sizeof(SGFNode *));
+  ids = malloc(sizeof(unsigned int) * (mask + 1));
+  c = malloc(sizeof(SGFCompact));
+  if (!nodes || !keys || !ids || !c)
+    goto fail;
+  num = 0;
+  sgfcompact_collect(root, nodes, &num);
+
+  /* the 16-bit fields must hold the values */
+  for (i = 0; i < num; i++) {
+    if (nodes[i]->draw_lvl < -1 || nodes[i]->draw_lvl > 32767
+	|| nodes[i]->move_num < 0 || nodes[i]->move_num > 65535)
+      goto fail;
+    for (prop = nodes[i]->props; prop; prop = prop->next) {
+      num_props++;
+      pool_size += strlen(prop->value) + 1;
+    }
+  }
+
+  for (i = 0; i < num; i++) {
+    h = SGFCOMPACT_HASH(nodes[i], mask);
+    while (keys[h] != NULL)
+      h = (h + 1) & mask;
+    keys[h] = nodes[i];
+    ids[h] = i;
+  }
+
+  len = sizeof(unsigned int) * (8 * num + 1 + num_props) + sizeof(int) * num
+	+ sizeof(short) * (2 * num + 2 * num_props) + num + pool_size;
+  mem = malloc(len);
+  if (!mem)
+    goto fail;
+
+  c->num_nodes = num;
+  c->num_props = num_props;
+  c->pool_size = pool_size;
+#define SGFCOMPACT_ARRAY(field_, n_) \
+  (c->field_ = (void *) mem, mem += sizeof(*c->field_) * (n_))
+  SGFCOMPACT_ARRAY(parent, num);
+  SGFCOMPACT_ARRAY(child, num);
+  SGFCOMPACT_ARRAY(next, num);
+  SGFCOMPACT_ARRAY(prevVar, num);
+  SGFCOMPACT_ARRAY(nextVar, num);
+  SGFCOMPACT_ARRAY(nextEvt, num);
+  SGFCOMPACT_ARRAY(prevEvt, num);
+  SGFCOMPACT_ARRAY(props, num + 1);
+  SGFCOMPACT_ARRAY(prop_value, num_props);
+  SGFCOMPACT_ARRAY(lazy_offset, num);
+  SGFCOMPACT_ARRAY(draw_lvl, num);
+  SGFCOMPACT_ARRAY(move_num, num);
+  SGFCOMPACT_ARRAY(prop_name, num_props);
+  SGFCOMPACT_ARRAY(prop_points, num_props);
+  SGFCOMPACT_ARRAY(prop_mask, num);
+  SGFCOMPACT_ARRAY(pool, pool_size);
+#undef SGFCOMPACT_ARRAY
+
+  p = 0;
+  k = 0;
+  for (i = 0; i < num; i++) {
+    c->parent[i] = sgfcompact_index(nodes[i]->parent, keys, ids, mask);
+    c->child[i] = sgfcompact_index(nodes[i]->child, keys, ids, mask);
+    c->next[i] = sgfcompact_index(nodes[i]->next, keys, ids, mask);
+    c->prevVar[i] = sgfcompact_index(nodes[i]->prevVar, keys, ids, mask);
+    c->nextVar[i] = sgfcompact_index(nodes[i]->nextVar, keys, ids, mask);
+    c->nextEvt[i] = sgfcompact_index(nodes[i]->nextEvt, keys, ids, mask);
+    c->prevEvt[i] = sgfcompact_index(nodes[i]->prevEvt, keys, ids, mask);
+    c->lazy_offset[i] = nodes[i]->lazy_offset;
+    c->draw_lvl[i] = (short) nodes[i]->draw_lvl;
+    c->move_num[i] = (unsigned short) nodes[i]->move_num;
+    c->prop_mask[i] = (unsigned char) nodes[i]->prop_mask;
+
+    c->props[i] = k;
+    for (prop = nodes[i]->props; prop; prop = prop->next, k++) {
+      c->prop_name[k] = prop->name;
+      c->prop_points[k] = prop->points;
+      c->prop_value[k] = p;
+      len = strlen(prop->value) + 1;
+      memcpy(c->pool + p, prop->value, len);
+      p += len;
+    }
+  }
+  c->props[num] = k;
+
+  free(nodes);
+  free(keys);
+  free(ids);
+  return c;
+
+ fail:
+  free(nodes);
+  free(keys);
+  free(ids);
+  free(c);
+  return NULL;
+}
+
+/*
+ * Make the nodes of c again, all in one table like readsgfbin(). The pool
+ * is copied to arena, so the view does not depend on c.
+ */
+
+SGFNode *
+sgfCompactView(const SGFCompact *c, SGFArena *arena)
+{
+  SGFNode *nodes;
+  SGFProperty *props;
+  char *pool;
+  unsigned int i, k;
+
+  nodes = sgfArenaAlloc(arena, sizeof(SGFNode) * c->num_nodes);
+  props = sgfArenaAlloc(arena, sizeof(SGFProperty) * (c->num_props + 1));
+  pool = sgfArenaAlloc(arena, c->pool_size + 1);
+  memcpy(pool, c->pool, c->pool_size);
+
+#define SGFCOMPACT_NODE(i_) ((i_) == SGF_COMPACT_NONE ? NULL : &nodes[i_])
+  for (i = 0; i < c->num_nodes; i++) {
+    init_node(&nodes[i]);
+    nodes[i].parent = SGFCOMPACT_NODE(c->parent[i]);
+    nodes[i].child = SGFCOMPACT_NODE(c->child[i]);
+    nodes[i].next = SGFCOMPACT_NODE(c->next[i]);
+    nodes[i].prevVar = SGFCOMPACT_NODE(c->prevVar[i]);
+    nodes[i].nextVar = SGFCOMPACT_NODE(c->nextVar[i]);
+    nodes[i].nextEvt = SGFCOMPACT_NODE(c->nextEvt[i]);
+    nodes[i].prevEvt = SGFCOMPACT_NODE(c->prevEvt[i]);
+    nodes[i].lazy_offset = c->lazy_offset[i];
+    nodes[i].draw_lvl = c->draw_lvl[i];
+    nodes[i].move_num = c->move_num[i];
+    nodes[i].prop_mask = c->prop_mask[i];
+
+    for (k = c->props[i]; k < c->props[i + 1]; k++) {
+      props[k].name = c->prop_name[k];
+      props[k].points = c->prop_points[k];
+      props[k].value = pool + c->prop_value[k];
+      props[k].next = k + 1 < c->props[i + 1] ? &props[k + 1] : NULL;
+
+      if ((props[k].name == SGFB || props[k].name == SGFW) && nodes[i].move == NULL)
+	nodes[i].move = &props[k];
+      if (props[k].name == SGFC && nodes[i].comment == NULL)
+	nodes[i].comment = &props[k];
+    }
+    if (c->props[i + 1] > c->props[i])
+      nodes[i].props = &props[c->props[i]];
+  }
+#undef SGFCOMPACT_NODE
+
+  return &nodes[0];
+}
+
+void
+sgfCompactFree(SGFCompact *c)
+{
+  if (c == NULL)
+    return;
+
+  /* the arrays start with parent */
+  free(c->parent);
+  free(c);
+}
+
+
 #ifdef TEST_SGFPARSER
 int
 main()
 {
-  static char buffer[25000];
-  static char output[25000];
   SGFNode *game;
 
-  sgffile = stdin;
+  /* parse errors are reported by the reader */
+  game = readsgffile("-");
+  if (!game)
+    return EXIT_FAILURE;
 
-  nexttoken();
-  gametree(&game, LAX_SGF);
-  if (sgferr) {
-    fprintf(stderr, "Parse error:");
-    fprintf(stderr, sgferr, sgferrarg);
-    fprintf(stderr, " at position %d\n", sgferrpos);
-  }
-  else {
-    unparse_game(stdin, game, 1);
-    write(1, output, outputp - output);
-  }
+  writesgf(game, "-");
+  sgfFreeNode(game);
+  return EXIT_SUCCESS;
 }
 #endif
 
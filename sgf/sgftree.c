@@ -22,6 +22,7 @@
 \* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "sgftree.h"
 
@@ -30,21 +31,196 @@ sgftree_clear(SGFTree *tree)
 {
   tree->root = NULL;
   tree->lastnode = NULL;
+  sgfArenaInit(&tree->arena);
+  tree->input = NULL;
+  tree->input_len = 0;
+  tree->compact = NULL;
 }
 
+
+/*
+ * Release all nodes of the tree. A tree read from a file is dropped
+ * with its arena in one go.
+ */
+
+void
+sgftree_free(SGFTree *tree)
+{
+  if (tree->arena.blocks)
+    sgfArenaFree(&tree->arena);
+  else
+    sgfFreeNode(tree->root);
+  free(tree->input);
+  sgfCompactFree(tree->compact);
+
+  sgftree_clear(tree);
+}
+
+
 int
 sgftree_readfile(SGFTree *tree, const char *infilename)
 {
-  SGFNode *savetree = tree->root;
+  return sgftree_readfile_flags(tree, infilename, 0);
+}
+
 
-  tree->root = readsgffile(infilename);
-  if (tree->root == NULL) {
-    tree->root = savetree;
+int
+sgftree_readfile_flags(SGFTree *tree, const char *infilename, int flags)
+{
+  SGFArena arena;
+  SGFNode *root;
+  char *input = NULL;
+  size_t input_len = 0;
+
+  sgfArenaInit(&arena);
+  root = readsgffile_arena(infilename, &arena, flags, &input, &input_len);
+  if (root == NULL) {
+    sgfArenaFree(&arena);
     return 0;
   }
   
-  sgfFreeNode(savetree);
+  sgftree_free(tree);
+  tree->root = root;
+  tree->arena = arena;
+  tree->input = input;
+  tree->input_len = input_len;
+  return 1;
+}
+
+
+/*
+ * droceRoG: Read one game tree of a collection, found by
+ * sgfScanCollection(). Placeholders refer to the game's bytes only.
+ */
+
+int
+sgftree_readfile_range(SGFTree *tree, const char *infilename,
+		       long offset, long length, int flags)
+{
+  SGFArena arena;
+  SGFNode *root;
+  char *input = NULL;
+  size_t input_len = 0;
+
+  sgfArenaInit(&arena);
+  root = readsgffile_range(infilename, offset, length, &arena, flags,
+			   &input, &input_len);
+  if (root == NULL) {
+    sgfArenaFree(&arena);
+    return 0;
+  }
+
+  sgftree_free(tree);
+  tree->root = root;
+  tree->arena = arena;
+  tree->input = input;
+  tree->input_len = input_len;
+  return 1;
+}
+
+
+/*
+ * droceRoG: Parse a placeholder of a lazily read tree. Nothing is done
+ * for other nodes.
+ */
+
+int
+sgftree_materialize(SGFTree *tree, SGFNode *node)
+{
+  if (!sgfIsLazy(node))
+    return 1;
+
+  assert(tree->input != NULL);
+  return sgfMaterialize(node, tree->input, tree->input_len, &tree->arena);
+}
+
+
+/*
+ * droceRoG: Load a tree from the binary cache filename, see readsgfbin().
+ */
+
+int
+sgftree_readbin(SGFTree *tree, const char *filename, const char *source,
+		long mtime, long size)
+{
+  SGFArena arena;
+  SGFNode *root;
+
+  sgfArenaInit(&arena);
+  root = readsgfbin(filename, source, mtime, size, &arena);
+  if (root == NULL) {
+    sgfArenaFree(&arena);
+    return 0;
+  }
+
+  sgftree_free(tree);
+  tree->root = root;
+  tree->arena = arena;
+  return 1;
+}
+
+
+/*
+ * droceRoG: Write the tree to the binary cache filename. Unparsed
+ * variations of a lazily read tree are taken from a complete parse of
+ * its input, the tree itself is not changed.
+ */
+
+int
+sgftree_writebin(SGFTree *tree, const char *filename, const char *source,
+		 long mtime, long size)
+{
+  SGFNode *root;
+  int ok;
+
+  if (tree->input == NULL)
+    return writesgfbin(tree->root, filename, source, mtime, size);
+
+  root = readsgf_from_memory(tree->input, tree->input_len);
+  if (root == NULL)
+    return 0;
+  ok = writesgfbin(root, filename, source, mtime, size);
+  sgfFreeNode(root);
+
+  return ok;
+}
+
+
+/*
+ * droceRoG: Keep the tree as a compact copy. Only trees read into the
+ * arena are compacted, other trees are released node by node.
+ */
+
+int
+sgftree_compact(SGFTree *tree)
+{
+  SGFCompact *compact;
+
+  if (tree->compact || tree->root == NULL || tree->arena.blocks == NULL)
+    return 0;
+
+  compact = sgfCompactNew(tree->root);
+  if (compact == NULL)
+    return 0;
+
+  sgfArenaFree(&tree->arena);
+  tree->root = NULL;
   tree->lastnode = NULL;
+  tree->compact = compact;
+  return 1;
+}
+
+
+int
+sgftree_expand(SGFTree *tree)
+{
+  if (tree->compact == NULL)
+    return 0;
+
+  sgfArenaInit(&tree->arena);
+  tree->root = sgfCompactView(tree->compact, &tree->arena);
+  sgfCompactFree(tree->compact);
+  tree->compact = NULL;
   return 1;
 }
 
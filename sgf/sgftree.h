@@ -49,6 +49,25 @@
 
 void *xalloc(unsigned int);
 
+/*
+ * droceRoG: Arena allocator. Nodes, properties and values of a parsed
+ * game are carved from large blocks and released all at once.
+ */
+
+typedef struct SGFArenaBlock_t {
+  struct SGFArenaBlock_t *next;
+  unsigned int size;
+  unsigned int used;
+} SGFArenaBlock;
+
+typedef struct SGFArena_t {
+  SGFArenaBlock *blocks;
+} SGFArena;
+
+void sgfArenaInit(SGFArena *arena);
+void *sgfArenaAlloc(SGFArena *arena, unsigned int size);
+void sgfArenaFree(SGFArena *arena);
+
 /*
  * A property of an SGF node.  An SGF node is described by a linked
  * list of these.
@@ -57,9 +76,17 @@ void *xalloc(unsigned int);
 typedef struct SGFProperty_t {
   struct SGFProperty_t *next;
   short name;
+  unsigned short points;        /* droceRoG: see sgfNumPoints()   */
   char *value;
 } SGFProperty;
 
+/* droceRoG: The reader packs all points of a point list like AB[aa][bb]
+ * or AB[aa:bb] into one property with the value "aabb...", points is
+ * their number then. Other properties hold a single value and count as
+ * one point for get_pointX() and get_pointY().
+ */
+#define sgfNumPoints(prop__) ((prop__)->points > 0 ? (int) (prop__)->points : 1)
+
     
 typedef struct SGFNode_t {
   SGFProperty *props;
@@ -70,8 +97,48 @@ typedef struct SGFNode_t {
   struct SGFNode_t *nextVar;    /* variation access.              */
   int draw_lvl;                 /* droceRoG: draw level           */
   int move_num;                 /* droceRoG: move number          */
+  void *snapshot;               /* droceRoG: board position cache */
+  int lazy_offset;              /* droceRoG: input offset of an   */
+                                /* unparsed variation, or -1      */
+  unsigned int prop_mask;       /* droceRoG: SGF_PROP_* present   */
+  SGFProperty *move;            /* droceRoG: first B or W         */
+  SGFProperty *comment;         /* droceRoG: first C              */
+  struct SGFNode_t *nextEvt;    /* droceRoG: next and previous    */
+  struct SGFNode_t *prevEvt;    /* comment, fork or end, see      */
+                                /* build_varinfo()                */
 } SGFNode;
 
+/* droceRoG: bits of SGFNode.prop_mask, kept up to date whenever a
+ * property is attached to the node.
+ */
+#define SGF_PROP_B      0x01
+#define SGF_PROP_W      0x02
+#define SGF_PROP_C      0x04
+#define SGF_PROP_AB     0x08
+#define SGF_PROP_AW     0x10
+#define SGF_PROP_AE     0x20
+#define SGF_PROP_MARKUP 0x40    /* board markers: CR, SQ, TR, MA */
+#define SGF_PROP_ANNOT  0x80    /* move annotations: BM, DO, IT, TE */
+
+#define SGF_PROP_MOVE   (SGF_PROP_B | SGF_PROP_W)
+#define SGF_PROP_SETUP  (SGF_PROP_AB | SGF_PROP_AW | SGF_PROP_AE)
+
+#define sgfHasProps(node__, mask__) (((node__)->prop_mask & (mask__)) != 0)
+
+/* droceRoG: node is a placeholder for an unparsed variation */
+#define sgfIsLazy(node__) ((node__)->lazy_offset >= 0)
+
+/* droceRoG: a game tree of a collection found by sgfScanCollection(),
+ * the strings are the first values of the root properties, cut to fit.
+ */
+typedef struct SGFGameInfo_t {
+  long offset;                  /* input offset of the '('        */
+  long length;                  /* bytes up to the closing ')'    */
+  char pb[48], pw[48];
+  char dt[24], re[16];
+  char gn[48];                  /* GN, or EV if there is no name  */
+} SGFGameInfo;
+
 
 /* low level functions */
 SGFNode *sgfPrev(SGFNode *node);
@@ -119,26 +186,142 @@ SGFNode *sgfCreateHeaderNode(int boardsize, float komi, int handicap);
 
 /* Read SGF tree from file. */
 SGFNode *readsgffile(const char *filename);
+/* droceRoG: flags for readsgffile_arena() */
+#define SGF_READ_LAZY 1     /* side variations are parsed on demand */
+
+/* Read SGF tree from file, all memory is taken from arena. With
+ * SGF_READ_LAZY, only the first variation of each fork is parsed, the
+ * others are placeholder nodes. Their input is needed later, so the
+ * file contents are returned in *input (to be freed by the caller).
+ */
+SGFNode *readsgffile_arena(const char *filename, SGFArena *arena, int flags,
+			   char **input, size_t *input_len);
+/* Same as readsgffile_arena(), but only length bytes from offset are
+ * read, e.g. one game tree of a collection.
+ */
+SGFNode *readsgffile_range(const char *filename, long offset, long length,
+			   SGFArena *arena, int flags,
+			   char **input, size_t *input_len);
+/* Find the top level game trees in len bytes at buf without parsing
+ * them. Returns their number, *games is to be freed by the caller.
+ */
+int sgfScanCollection(const char *buf, size_t len, SGFGameInfo **games);
+/* Parse the placeholder node in place and update variation links, draw
+ * levels and move numbers of the whole tree. Returns 0 on a parse error.
+ */
+int sgfMaterialize(SGFNode *node, const char *input, size_t input_len,
+		   SGFArena *arena);
+/* Read SGF tree from a buffer of len bytes. */
+SGFNode *readsgf_from_memory(const char *buf, size_t len);
+/* Same as readsgffile_arena(), but from a buffer, which is kept by the
+ * caller. */
+SGFNode *readsgf_from_memory_arena(const char *buf, size_t len,
+				   SGFArena *arena, int flags);
+/* Compute variation links, draw levels and move numbers again, the reader
+ * does this when a tree is read. */
+void sgfBuildVarInfo(SGFNode *root);
+#ifdef DROCEROG_PERF
+/* droceRoG: calls and time (ms) of the post-processing above. Each thread
+ * has its own counters, so the viewer reports those of the UI thread and
+ * the parsing in the background threads is not included. */
+extern __thread long sgf_perf_varinfo_calls;
+extern __thread double sgf_perf_varinfo_ms;
+extern __thread double sgf_perf_varinfo_max;
+#endif
 /* Specific solution for fuseki */
 SGFNode *readsgffilefuseki(const char *filename, int moves_per_game);
 
 /* Write SGF tree to a file. */
 int writesgf(SGFNode *root, const char *filename);
 
+/* droceRoG: Binary cache of a parsed tree including variation links, draw
+ * levels and move numbers. source, mtime and size identify the SGF file
+ * the tree has been read from, readsgfbin() returns NULL if they differ.
+ * The loaded tree lives in arena.
+ */
+int writesgfbin(SGFNode *root, const char *filename, const char *source,
+		long mtime, long size);
+SGFNode *readsgfbin(const char *filename, const char *source, long mtime,
+		    long size, SGFArena *arena);
+
+/* droceRoG: Compact copy of a tree for trees which are kept but not
+ * shown, e.g. parsed in advance. The nodes are a structure of arrays in
+ * preorder with 32-bit indices, the properties of all nodes are one array
+ * and their values one string pool. Board snapshots are not kept.
+ */
+#define SGF_COMPACT_NONE 0xffffffffu
+
+typedef struct SGFCompact_t {
+  unsigned int num_nodes;
+  unsigned int num_props;
+  unsigned int pool_size;
+  unsigned int *parent, *child, *next;  /* SGF_COMPACT_NONE: none */
+  unsigned int *prevVar, *nextVar;
+  unsigned int *nextEvt, *prevEvt;
+  unsigned int *props;          /* first property, num_nodes + 1 */
+  int *lazy_offset;
+  short *draw_lvl;
+  unsigned short *move_num;
+  unsigned char *prop_mask;
+  short *prop_name;             /* properties, num_props each     */
+  unsigned short *prop_points;
+  unsigned int *prop_value;     /* offset in the pool             */
+  char *pool;
+} SGFCompact;
+
+/* Compact copy of the tree of root, including the games after root.
+ * Returns NULL if it does not fit, e.g. more than 65535 moves.
+ */
+SGFCompact *sgfCompactNew(SGFNode *root);
+/* Nodes of compact as an SGFNode tree in arena, in the same memory
+ * order. compact may be released afterwards. Returns the root.
+ */
+SGFNode *sgfCompactView(const SGFCompact *compact, SGFArena *arena);
+void sgfCompactFree(SGFCompact *compact);
+
 
 /* ---------------------------------------------------------------- */
 /* ---                          SGFTree                         --- */
 /* ---------------------------------------------------------------- */
 
 
+/* A tree read by sgftree_readfile() lives in its arena. Nodes added later
+ * by the high level functions below are allocated separately and are not
+ * released by sgftree_free().
+ */
 typedef struct SGFTree_t {
   SGFNode *root;
   SGFNode *lastnode;
+  SGFArena arena;
+  char *input;          /* droceRoG: file contents of a lazily read tree */
+  size_t input_len;
+  SGFCompact *compact;  /* droceRoG: see sgftree_compact()  */
 } SGFTree;
 
 
 void sgftree_clear(SGFTree *tree);
+void sgftree_free(SGFTree *tree);
 int sgftree_readfile(SGFTree *tree, const char *infilename);
+/* droceRoG: read with SGF_READ_LAZY and the like. Placeholder nodes have
+ * to be materialized before they are used (and before writing the tree).
+ */
+int sgftree_readfile_flags(SGFTree *tree, const char *infilename, int flags);
+/* droceRoG: read one game tree of a collection, see readsgffile_range() */
+int sgftree_readfile_range(SGFTree *tree, const char *infilename,
+			   long offset, long length, int flags);
+int sgftree_materialize(SGFTree *tree, SGFNode *node);
+/* droceRoG: binary cache, see writesgfbin() */
+int sgftree_readbin(SGFTree *tree, const char *filename, const char *source,
+		    long mtime, long size);
+int sgftree_writebin(SGFTree *tree, const char *filename, const char *source,
+		     long mtime, long size);
+/* droceRoG: replace the nodes by a compact copy, root is NULL then.
+ * sgftree_expand() makes the nodes again, other functions must not be
+ * used in between. Both return 1 on success, the tree is unchanged
+ * otherwise.
+ */
+int sgftree_compact(SGFTree *tree);
+int sgftree_expand(SGFTree *tree);
 
 int sgftreeBack(SGFTree *tree);
 int sgftreeForward(SGFTree *tree);
@@ -172,6 +355,9 @@ void sgftreeSetLastNode(SGFTree *tree, SGFNode *lastnode);
 int get_moveX(SGFProperty *property, int boardsize);
 int get_moveY(SGFProperty *property, int boardsize);
 int get_moveXY(SGFProperty *property, int *i, int *j, int boardsize);
+/* droceRoG: coordinates of point k of a point list, see sgfNumPoints() */
+int get_pointX(SGFProperty *property, int k, int boardsize);
+int get_pointY(SGFProperty *property, int k, int boardsize);
 
 int show_sgf_properties(SGFNode *node);
 int show_sgf_tree(SGFNode *node);
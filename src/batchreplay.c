@@ -0,0 +1,250 @@
+/* droceRoG - replay of many SGF files on bitboards by a pool of threads
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "batchreplay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/******************************************************************************/
+
+#define ENC_SGFPROP(c1_, c2_) ((short)( c1_ | c2_ << 8 ))
+
+/* files of one batch_replay_files() call */
+typedef struct {
+    const char **files;
+    int num;
+    BatchWork work;
+    void *data;
+    void **results;
+    char *done;             /* result of file i is available */
+    int next;               /* next file taken by a worker */
+    pthread_mutex_t lock;   /* protects results, done and next */
+    pthread_cond_t cond;
+} BatchJob;
+
+/******************************************************************************/
+
+long batch_walk(BitBoard *bb, SGFNode *nd, BatchVisit visit, void *ctx);
+void batch_applyNode(BitBoard *bb, SGFNode *nd);
+void *batch_worker(void *arg);
+int batch_numWorkers(int num);
+
+/******************************************************************************/
+
+long batch_replay_tree(SGFNode *root, BatchVisit visit, void *ctx)
+{/*{{{*/
+    BitBoard bb;
+    SGFNode *game;
+    long n = 0;
+    int size;
+
+    /* all games of a collection */
+    for (game = root; game; game = game->next) {
+        if (!sgfGetIntProperty(game, "SZ", &size))
+            size = 19;
+        if (size <= 0 || size > BITBOARD_MAX_SIZE)
+            continue;
+
+        bitboard_init(&bb, size);
+        n += batch_walk(&bb, game, visit, ctx);
+    }
+
+    return n;
+}/*}}}*/
+
+int batch_replay_mainline(SGFNode *root, int maxMoves, BitBoard *bb)
+{/*{{{*/
+    SGFNode *nd;
+    int size, moves = 0;
+
+    if (!sgfGetIntProperty(root, "SZ", &size))
+        size = 19;
+    if (size <= 0 || size > BITBOARD_MAX_SIZE)
+        return -1;
+
+    bitboard_init(bb, size);
+    for (nd = root; nd; nd = nd->child) {
+        if (maxMoves > 0 && moves == maxMoves && sgfHasProps(nd, SGF_PROP_MOVE))
+            break;
+        batch_applyNode(bb, nd);
+        if (sgfHasProps(nd, SGF_PROP_MOVE))
+            moves += 1;
+    }
+
+    return moves;
+}/*}}}*/
+
+int batch_replay_files(const char **files, int num, BatchWork work, BatchMerge merge,
+                       void *data)
+{/*{{{*/
+    BatchJob job;
+    pthread_t workers[BATCH_MAX_WORKERS];
+    void *result;
+    int i, numWorkers;
+
+    if (num <= 0)
+        return 0;
+
+    job.files = files;
+    job.num = num;
+    job.work = work;
+    job.data = data;
+    job.results = (void **) calloc(num, sizeof(void *));
+    job.done = (char *) calloc(num, 1);
+    job.next = 0;
+    assert(job.results != NULL && job.done != NULL);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    numWorkers = batch_numWorkers(num);
+    for (i=0; i<numWorkers; i++) {
+        if (pthread_create(&workers[i], NULL, batch_worker, &job) != 0) {
+            fprintf(stderr, "[ERROR] Could not start replay thread\n");
+            break;
+        }
+    }
+    numWorkers = i;
+
+    /* merge in order while the workers go on, without any worker the files
+     * are replayed here */
+    for (i=0; i<num; i++) {
+        if (numWorkers == 0) {
+            merge(data, i, work(data, files[i]));
+            continue;
+        }
+
+        pthread_mutex_lock(&job.lock);
+        while (!job.done[i])
+            pthread_cond_wait(&job.cond, &job.lock);
+        result = job.results[i];
+        pthread_mutex_unlock(&job.lock);
+
+        merge(data, i, result);
+    }
+
+    for (i=0; i<numWorkers; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+    free(job.results);
+    free(job.done);
+
+    return numWorkers;
+}/*}}}*/
+
+/* Replay nd and the nodes below on bb. Each variation but the last one
+ * continues on a copy of the board, the last one on bb itself, so only
+ * nested variations recurse.
+ */
+long batch_walk(BitBoard *bb, SGFNode *nd, BatchVisit visit, void *ctx)
+{/*{{{*/
+    BitBoard fork;
+    SGFNode *child;
+    long n = 0;
+
+    for (;;) {
+        batch_applyNode(bb, nd);
+        if (visit)
+            visit(ctx, bb, nd);
+        n += 1;
+
+        if (nd->child == NULL)
+            return n;
+
+        for (child = nd->child; child->next; child = child->next) {
+            fork = *bb;
+            n += batch_walk(&fork, child, visit, ctx);
+        }
+        nd = child;
+    }
+}/*}}}*/
+
+void batch_applyNode(BitBoard *bb, SGFNode *nd)
+{/*{{{*/
+    SGFProperty *prop;
+    BoardSetupType type;
+    int k, r, c;
+
+    if (!sgfHasProps(nd, SGF_PROP_MOVE | SGF_PROP_SETUP))
+        return;
+
+    /* setup stones are placed in the order of the properties before the
+     * move, as on the Go board */
+    if (sgfHasProps(nd, SGF_PROP_SETUP)) {
+        for (prop = nd->props; prop; prop = prop->next) {
+            switch (prop->name) {
+                case ENC_SGFPROP('A', 'B'): type = SETUP_BLACK; break;
+                case ENC_SGFPROP('A', 'W'): type = SETUP_WHITE; break;
+                case ENC_SGFPROP('A', 'E'): type = SETUP_EMPTY; break;
+                default: continue;
+            }
+            for (k=0; k<sgfNumPoints(prop); k++) {
+                r = get_pointX(prop, k, bb->size);
+                c = get_pointY(prop, k, bb->size);
+                if (r >= 0 && c >= 0)
+                    bitboard_setup(bb, r, c, type);
+            }
+        }
+    }
+
+    if (!sgfHasProps(nd, SGF_PROP_MOVE))
+        return;
+
+    for (prop = nd->props; prop; prop = prop->next) {
+        if (prop->name != ENC_SGFPROP('B', ' ') && prop->name != ENC_SGFPROP('W', ' '))
+            continue;
+        for (k=0; k<sgfNumPoints(prop); k++) {
+            r = get_pointX(prop, k, bb->size);
+            c = get_pointY(prop, k, bb->size);
+            if (r < 0 || c < 0)
+                continue;
+            bitboard_play(bb, r, c, prop->name == ENC_SGFPROP('B', ' ') ? BOARD_BLACK : BOARD_WHITE);
+        }
+    }
+}/*}}}*/
+
+void *batch_worker(void *arg)
+{/*{{{*/
+    BatchJob *job = (BatchJob *) arg;
+    void *result;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        i = job->next < job->num ? job->next++ : -1;
+        pthread_mutex_unlock(&job->lock);
+        if (i < 0)
+            break;
+
+        result = job->work(job->data, job->files[i]);
+
+        pthread_mutex_lock(&job->lock);
+        job->results[i] = result;
+        job->done[i] = 1;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    return NULL;
+}/*}}}*/
+
+int batch_numWorkers(int num)
+{/*{{{*/
+    long n;
+
+    /* one file per worker at most, a single core is used by the caller */
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > BATCH_MAX_WORKERS)
+        n = BATCH_MAX_WORKERS;
+    if (n > num)
+        n = num;
+    return n > 1 ? (int) n : 0;
+}/*}}}*/
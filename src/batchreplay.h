@@ -0,0 +1,58 @@
+/* droceRoG - replay of many SGF files on bitboards by a pool of threads
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef BATCHREPLAY_H
+#define BATCHREPLAY_H
+
+#include <sgftree.h>
+
+#include "bitboard.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* upper limit of worker threads, also for devices with more cores */
+#define BATCH_MAX_WORKERS 8
+
+/* Called for every node with the position after the node. nd->parent is
+ * NULL for the root of each game. The visit may be NULL to replay only. */
+typedef void (*BatchVisit)(void *ctx, const BitBoard *bb, SGFNode *nd);
+
+/* Work on one file in a worker thread, the result is passed to BatchMerge. */
+typedef void *(*BatchWork)(void *data, const char *filename);
+
+/* Take the result of file i in the calling thread. */
+typedef void (*BatchMerge)(void *data, int i, void *result);
+
+/* Replay all games of the tree starting at root, each on an empty board of
+ * its size, and all their variations. The setup stones of a node are
+ * placed before its move. Games larger than BITBOARD_MAX_SIZE are skipped.
+ * Nothing global is used, so several trees may be replayed at the same
+ * time. Returns the number of visited nodes.
+ */
+long batch_replay_tree(SGFNode *root, BatchVisit visit, void *ctx);
+
+/* Replay the main line of the first game below root, i.e. always the
+ * first variation, on bb up to maxMoves nodes with a move (0: the whole
+ * line). Returns the number of those nodes, or -1 if the game is larger
+ * than BITBOARD_MAX_SIZE.
+ */
+int batch_replay_mainline(SGFNode *root, int maxMoves, BitBoard *bb);
+
+/* Run work for each of the num files on a pool of threads, one per core.
+ * merge is called in the calling thread for each file in the order of
+ * files, as soon as its work is done. Without threads everything runs in
+ * the calling thread. Returns the number of worker threads used.
+ */
+int batch_replay_files(const char **files, int num, BatchWork work, BatchMerge merge,
+                       void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATCHREPLAY_H */
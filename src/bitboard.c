@@ -0,0 +1,182 @@
+/* droceRoG - Go board on bitboards for replaying many games without display
+ *
+ * Chains are found by growing a mask row by row: each step adds the
+ * neighbours of all fields of the mask at once, restricted to the stones
+ * of the chain's colour.
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "bitboard.h"
+
+#include <string.h>
+#include <assert.h>
+
+/******************************************************************************/
+
+#define ROW_BIT(c_) ((BitRow) 1 << (c_))
+
+/******************************************************************************/
+
+int chain_fill(const BitBoard *bb, const BitRow *own, int r, int c,
+               BitRow *chain, int *lo, int *hi);
+int chain_remove(BitBoard *bb, BitRow *own, const BitRow *chain, int lo, int hi);
+int row_count(BitRow row);
+
+/******************************************************************************/
+
+void bitboard_init(BitBoard *bb, int size)
+{/*{{{*/
+    assert( size >= 1 && size <= BITBOARD_MAX_SIZE );
+
+    memset(bb, 0, sizeof(BitBoard));
+    bb->size = size;
+}/*}}}*/
+
+int bitboard_play(BitBoard *bb, int r, int c, BoardPlayer player)
+{/*{{{*/
+    BitRow chain[BITBOARD_MAX_SIZE];
+    BitRow *own, *opp;
+    int nb[4][2];
+    int j, n, lo, hi, captured;
+
+    assert( r >= 0 && r < bb->size );
+    assert( c >= 0 && c < bb->size );
+
+    own = player == BOARD_BLACK ? bb->black : bb->white;
+    opp = player == BOARD_BLACK ? bb->white : bb->black;
+
+    /* the stone replaces one of the opponent as on the Go board */
+    opp[r] &= ~ROW_BIT(c);
+    own[r] |= ROW_BIT(c);
+
+    n = 0;
+    if (r > 0)            { nb[n][0] = r - 1; nb[n++][1] = c; }
+    if (r < bb->size - 1) { nb[n][0] = r + 1; nb[n++][1] = c; }
+    if (c > 0)            { nb[n][0] = r; nb[n++][1] = c - 1; }
+    if (c < bb->size - 1) { nb[n][0] = r; nb[n++][1] = c + 1; }
+
+    /* remove opponent chains without liberties, a chain next to the stone
+     * twice is empty the second time */
+    captured = 0;
+    for (j=0; j<n; j++) {
+        if ((opp[nb[j][0]] & ROW_BIT(nb[j][1]))
+            && !chain_fill(bb, opp, nb[j][0], nb[j][1], chain, &lo, &hi))
+            captured += chain_remove(bb, opp, chain, lo, hi);
+    }
+
+    /* suicide: remove the own chain if it still has no liberties */
+    if (!chain_fill(bb, own, r, c, chain, &lo, &hi))
+        captured += chain_remove(bb, own, chain, lo, hi);
+
+    return captured;
+}/*}}}*/
+
+void bitboard_setup(BitBoard *bb, int r, int c, BoardSetupType type)
+{/*{{{*/
+    assert( r >= 0 && r < bb->size );
+    assert( c >= 0 && c < bb->size );
+
+    bb->black[r] &= ~ROW_BIT(c);
+    bb->white[r] &= ~ROW_BIT(c);
+    if (type == SETUP_BLACK)
+        bb->black[r] |= ROW_BIT(c);
+    else if (type == SETUP_WHITE)
+        bb->white[r] |= ROW_BIT(c);
+}/*}}}*/
+
+int bitboard_get_stone(const BitBoard *bb, int r, int c, BoardPlayer *player)
+{/*{{{*/
+    assert( r >= 0 && r < bb->size );
+    assert( c >= 0 && c < bb->size );
+
+    if (bb->black[r] & ROW_BIT(c)) {
+        *player = BOARD_BLACK;
+        return 1;
+    }
+    if (bb->white[r] & ROW_BIT(c)) {
+        *player = BOARD_WHITE;
+        return 1;
+    }
+    return 0;
+}/*}}}*/
+
+/* Grow the chain of own stones at (r,c) into chain, rows *lo to *hi are
+ * used. Returns 1 as soon as a liberty is found, then the chain may be
+ * incomplete, and 0 if it has none.
+ */
+int chain_fill(const BitBoard *bb, const BitRow *own, int r, int c,
+               BitRow *chain, int *lo, int *hi)
+{/*{{{*/
+    BitRow inside = (bb->size == 64 ? 0 : ROW_BIT(bb->size)) - 1;
+    BitRow grown;
+    int i, bChanged;
+
+    *lo = *hi = r;
+    chain[r] = ROW_BIT(c);
+
+    do {
+        bChanged = 0;
+
+        /* the chain reaches the rows above and below */
+        if (*lo > 0 && (chain[*lo] & own[*lo - 1])) {
+            *lo -= 1;
+            chain[*lo] = 0;
+        }
+        if (*hi < bb->size - 1 && (chain[*hi] & own[*hi + 1])) {
+            *hi += 1;
+            chain[*hi] = 0;
+        }
+
+        for (i=*lo; i<=*hi; i++) {
+            grown = chain[i] | chain[i] << 1 | chain[i] >> 1;
+            if (i > *lo)
+                grown |= chain[i-1];
+            if (i < *hi)
+                grown |= chain[i+1];
+
+            /* any empty neighbour is a liberty, also in the rows around */
+            if (grown & ~(bb->black[i] | bb->white[i]) & inside)
+                return 1;
+            if (i == *lo && i > 0 && (chain[i] & ~(bb->black[i-1] | bb->white[i-1])))
+                return 1;
+            if (i == *hi && i < bb->size - 1 && (chain[i] & ~(bb->black[i+1] | bb->white[i+1])))
+                return 1;
+
+            grown &= own[i];
+            if (grown != chain[i]) {
+                chain[i] = grown;
+                bChanged = 1;
+            }
+        }
+    } while (bChanged);
+
+    return 0;
+}/*}}}*/
+
+int chain_remove(BitBoard *bb, BitRow *own, const BitRow *chain, int lo, int hi)
+{/*{{{*/
+    int i, n = 0;
+
+    for (i=lo; i<=hi; i++) {
+        own[i] &= ~chain[i];
+        n += row_count(chain[i]);
+    }
+
+    /* notice removal in numbers of captured stones */
+    if (own == bb->black)
+        bb->num_caps_b += n;
+    else
+        bb->num_caps_w += n;
+
+    return n;
+}/*}}}*/
+
+int row_count(BitRow row)
+{/*{{{*/
+    int n;
+
+    for (n=0; row; n++)
+        row &= row - 1;
+    return n;
+}/*}}}*/
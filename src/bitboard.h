@@ -0,0 +1,52 @@
+/* droceRoG - Go board on bitboards for replaying many games without display
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "goboard.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* largest board size, same as the board hash */
+#define BITBOARD_MAX_SIZE 52
+
+typedef unsigned long long BitRow;  /* bit c is the field in column c */
+
+/* A board of its own, unlike the Go board of goboard.h there is no global
+ * state, no history and no display. Copy the struct to go back to a
+ * position later, e.g. at a fork.
+ */
+typedef struct {
+    int size;
+    BitRow black[BITBOARD_MAX_SIZE];    /* one mask per row */
+    BitRow white[BITBOARD_MAX_SIZE];
+    int num_caps_b;         /* captured stones, black and white */
+    int num_caps_w;
+} BitBoard;
+
+/* empty board of size x size, 1 <= size <= BITBOARD_MAX_SIZE */
+void bitboard_init(BitBoard *bb, int size);
+
+/* Play a move at (r,c) like board_placeStone(..., 1): opponent chains
+ * without liberties are captured, then the own chain if it has none.
+ * Returns the number of captured stones.
+ */
+int bitboard_play(BitBoard *bb, int r, int c, BoardPlayer player);
+
+/* Set the field (r,c) like board_setupStones(), without captures. */
+void bitboard_setup(BitBoard *bb, int r, int c, BoardSetupType type);
+
+/* Returns 1 and sets *player if there is a stone at (r,c), otherwise 0. */
+int bitboard_get_stone(const BitBoard *bb, int r, int c, BoardPlayer *player);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BITBOARD_H */
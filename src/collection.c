@@ -0,0 +1,114 @@
+/* droceRoG - game trees of SGF collections
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "collection.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/******************************************************************************/
+
+typedef struct {
+    char path[256];
+    long mtime;             /* stamp of the scanned file */
+    long size;
+    SGFGameInfo *games;
+    int num;
+} Collection;
+
+/******************************************************************************/
+
+static Collection lastFile = { "", 0, 0, NULL, 0 };
+
+/******************************************************************************/
+
+char *read_whole_file(const char *filename, size_t *len);
+
+/******************************************************************************/
+
+int collection_scan(const char *filename, const SGFGameInfo **games)
+{/*{{{*/
+    struct stat st;
+    char *buf;
+    size_t len;
+
+    *games = NULL;
+    if (filename == NULL || stat(filename, &st) != 0)
+        return 0;
+
+    /* the same file again, e.g. for the next game */
+    if (lastFile.games != NULL && strcmp(lastFile.path, filename) == 0
+        && lastFile.mtime == (long) st.st_mtime && lastFile.size == (long) st.st_size) {
+        *games = lastFile.games;
+        return lastFile.num;
+    }
+
+    collection_cleanup();
+
+    buf = read_whole_file(filename, &len);
+    if (buf == NULL)
+        return 0;
+    lastFile.num = sgfScanCollection(buf, len, &lastFile.games);
+    free(buf);
+    if (lastFile.num == 0)
+        return 0;
+
+    snprintf(lastFile.path, sizeof(lastFile.path), "%s", filename);
+    lastFile.mtime = (long) st.st_mtime;
+    lastFile.size = (long) st.st_size;
+
+    *games = lastFile.games;
+    return lastFile.num;
+}/*}}}*/
+
+void collection_title(const SGFGameInfo *games, int i, char *buf, int size)
+{/*{{{*/
+    const SGFGameInfo *g = &games[i];
+
+    if (!g->pb[0] && !g->pw[0]) {
+        snprintf(buf, size, "%d. %s", i + 1, g->gn[0] ? g->gn : "Game");
+    } else {
+        snprintf(buf, size, "%d. %s - %s%s%s%s%s", i + 1,
+                 g->pb, g->pw,
+                 g->dt[0] ? ", " : "", g->dt,
+                 g->re[0] ? ", " : "", g->re);
+    }
+}/*}}}*/
+
+void collection_cleanup()
+{/*{{{*/
+    free(lastFile.games);
+    lastFile.games = NULL;
+    lastFile.num = 0;
+    lastFile.path[0] = '\0';
+}/*}}}*/
+
+char *read_whole_file(const char *filename, size_t *len)
+{/*{{{*/
+    FILE *file;
+    char *buf;
+    long size;
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    buf = size >= 0 ? (char *) malloc(size + 1) : NULL;
+    if (buf == NULL || fread(buf, 1, size, file) != (size_t) size) {
+        free(buf);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    *len = (size_t) size;
+    return buf;
+}/*}}}*/
@@ -0,0 +1,33 @@
+/* droceRoG - game trees of SGF collections
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef COLLECTION_H
+#define COLLECTION_H
+
+#include <sgftree.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Find the game trees of the SGF file filename, see sgfScanCollection().
+ * The result of the last file is kept while the file is unchanged.
+ * Returns the number of games, 0 if the file cannot be read. The games
+ * stay valid until the next call for another file or collection_cleanup().
+ */
+int collection_scan(const char *filename, const SGFGameInfo **games);
+
+/* Write the text shown for game i of games to buf. */
+void collection_title(const SGFGameInfo *games, int i, char *buf, int size);
+
+/* release the games of the last file */
+void collection_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTION_H */
@@ -3,28 +3,98 @@
  * Author: Christoph Hermes (hermes@hausmilbe.net)
  */
 
+#include <stdio.h>
+#include <string.h>
+
 #include "inkview.h"
 #include "gogame.h"
+#include "goboard.h"
 #include "fileselector.h"
+#include "thumbbrowser.h"
+#include "thumbcache.h"
+#include "prefetch.h"
+#include "posindex.h"
+#include "collection.h"
+#include "session.h"
+#include "fontcache.h"
+#include "perf.h"
 
 /******************************************************************************/
 
 /* prototypes */
 int main_handler(int type, int par1, int par2);
 void msg(char *s);
-void cb_update_sgf(char *filename);
+void cb_update_sgf(char *filename, int game);
+void open_game(const char *filename, int game);
+void open_neighbour(int dir);
+void open_init_game();
+void search_position(PosIndexRegion region);
+void show_perf();
+void scrub_repeat(int key, int count);
+void scrub_frame();
+void scrub_rest();
+void scrub_end();
 
 /******************************************************************************/
 
 ifont *times12;
 char *init_filename = NULL;
+static char cur_filename[256] = "";
+static int cur_game = 0; /* game in a collection */
+
+/* Holding a navigation key scrolls through the game: the steps of the
+ * repeat events are applied without drawing, the board is redrawn fast
+ * every SCRUB_FRAME_DELAY ms and cleanly when the key is released or the
+ * repeats stop for SCRUB_REST_DELAY ms. The steps per repeat event are
+ * doubled every SCRUB_ACCEL repeats up to SCRUB_MAX_STEPS. */
+#define SCRUB_FRAME_DELAY 250
+#define SCRUB_REST_DELAY 600
+#define SCRUB_ACCEL 3
+#define SCRUB_MAX_STEPS 16
+
+static int scrubKey = 0; /* navigation key held down, 0: none */
+static int bScrubFrame = 0; /* fast redraw scheduled */
+
+/* file the performance counters are appended to */
+#define PERF_LOGFILE CONFIGPATH "/drocerog_perf.log"
+
+static imenu menu_search[] = {
+
+  { ITEM_HEADER,   0, "Search in library", NULL },
+  { ITEM_ACTIVE, 201, "Whole board", NULL },
+  { ITEM_ACTIVE, 202, "Top left corner", NULL },
+  { ITEM_ACTIVE, 203, "Top right corner", NULL },
+  { ITEM_ACTIVE, 204, "Bottom left corner", NULL },
+  { ITEM_ACTIVE, 205, "Bottom right corner", NULL },
+  { 0, 0, NULL, NULL }
+
+};
+
+#ifdef DROCEROG_PERF
+static imenu menu_perf[] = {
+
+  { ITEM_HEADER,   0, "Performance", NULL },
+  { ITEM_ACTIVE, 301, "Show counters", NULL },
+  { ITEM_ACTIVE, 302, "Append to log", NULL },
+  { ITEM_ACTIVE, 303, "Reset counters", NULL },
+  { 0, 0, NULL, NULL }
+
+};
+#endif
 
 static imenu menu1[] = {
 
   { ITEM_HEADER,   0, "Menu", NULL },
   { ITEM_ACTIVE, 101, "Open SGF file...", NULL },
+  { ITEM_ACTIVE, 108, "Browse library...", NULL },
+  { ITEM_ACTIVE, 104, "Open next game", NULL },
+  { ITEM_ACTIVE, 105, "Open previous game", NULL },
   { ITEM_ACTIVE, 102, "Go to move...", NULL },
+  { ITEM_SUBMENU, 106, "Search position", menu_search },
   { ITEM_ACTIVE, 103, "Show help...", NULL },
+#ifdef DROCEROG_PERF
+  { ITEM_SUBMENU, 107, "Performance", menu_perf },
+#endif
   { 0, 0, NULL, NULL }
 
 };
@@ -43,6 +113,14 @@ void menu1_handler(int index)
         case 101:
             fileselector_chooseFile(&cb_update_sgf);
             break;
+        case 108:
+            if (!thumbbrowser_open(cur_filename, &cb_update_sgf))
+                Message(ICON_INFORMATION, "Browse library", "No SGF files have been found.", 2000);
+            break;
+        case 104:
+        case 105:
+            open_neighbour(index == 104 ? 1 : -1);
+            break;
         case 102:
             OpenPageSelector(cb_page_selected);
             break;
@@ -50,6 +128,23 @@ void menu1_handler(int index)
             if (!gogame_set_showHelp(1))
                 gogame_draw_fullrepaint();
             break;
+        case 201:
+        case 202:
+        case 203:
+        case 204:
+        case 205:
+            search_position(POSINDEX_BOARD + index - 201);
+            break;
+        case 301:
+            show_perf();
+            break;
+        case 302:
+            if (!perf_log(PERF_LOGFILE))
+                Message(ICON_INFORMATION, "Performance", "Cannot write " PERF_LOGFILE, 2000);
+            break;
+        case 303:
+            perf_reset();
+            break;
     }
 }
 
@@ -62,12 +157,155 @@ void msg(char *s)
   PartialUpdate(350, 770, 250, 20);
 }/*}}}*/
 
-void cb_update_sgf(char *filename)
+void cb_update_sgf(char *filename, int game)
 {/*{{{*/
     // fprintf(stderr, "drocerog.c: callback called: %s\n", filename);
 
-    gogame_new_from_file(filename);
+    open_game(filename, game);
+}/*}}}*/
+
+void open_game(const char *filename, int game)
+{/*{{{*/
+    const char *neighbours[2];
+
+    /* filename may point into the file list, which is replaced by
+     * fileselector_getNeighbour() */
+    snprintf(cur_filename, sizeof(cur_filename), "%s", filename);
+    cur_game = game;
+
+    gogame_new_from_game(cur_filename, cur_game);
     gogame_draw_fullrepaint();
+    gogame_save_session();
+
+    /* parse the surrounding games while this one is shown */
+    if (gogame_isGameOpened()) {
+        neighbours[0] = fileselector_getNeighbour(cur_filename, 1);
+        neighbours[1] = fileselector_getNeighbour(cur_filename, -1);
+        prefetch_files(neighbours, 2);
+    }
+}/*}}}*/
+
+void open_neighbour(int dir)
+{/*{{{*/
+    const SGFGameInfo *games;
+    const char *filename;
+    int num;
+
+    /* the next game of a collection comes before the next file */
+    num = collection_scan(cur_filename, &games);
+    if (cur_game + dir >= 0 && cur_game + dir < num) {
+        open_game(cur_filename, cur_game + dir);
+        return;
+    }
+
+    filename = fileselector_getNeighbour(cur_filename, dir);
+    if (filename != NULL)
+        open_game(filename, 0);
+}/*}}}*/
+
+void open_init_game()
+{/*{{{*/
+    Session session;
+
+    /* continue the last session with its file or if none is given */
+    if (session_load(&session)
+        && (init_filename[0] == '\0' || strcmp(init_filename, session.filename) == 0)) {
+        snprintf(cur_filename, sizeof(cur_filename), "%s", session.filename);
+        cur_game = session.game;
+        gogame_new_from_session(&session);
+    } else {
+        snprintf(cur_filename, sizeof(cur_filename), "%s", init_filename);
+        cur_game = 0;
+        gogame_new_from_file(init_filename);
+    }
+    session_free(&session);
+}/*}}}*/
+
+void search_position(PosIndexRegion region)
+{/*{{{*/
+    const char **files;
+    BoardHash hash;
+    int num;
+
+    if (!gogame_isGameOpened())
+        return;
+
+    hash = posindex_region_hash(region);
+    if (hash == 0) {
+        Message(ICON_INFORMATION, "Search position", "There are no stones in this region.", 2000);
+        return;
+    }
+
+    /* index new and modified files */
+    ShowHourglass();
+    posindex_update(FLASHDIR);
+
+    num = posindex_search(hash, &files);
+    if (num == 0) {
+        Message(ICON_INFORMATION, "Search position", "The position has not been found.", 2000);
+        return;
+    }
+
+    fileselector_chooseFromList(files, num, &cb_update_sgf);
+}/*}}}*/
+
+void show_perf()
+{/*{{{*/
+    char buf[1024];
+
+    perf_report(buf, sizeof(buf));
+    Message(ICON_INFORMATION, "Performance", buf, 10000);
+}/*}}}*/
+
+void scrub_repeat(int key, int count)
+{/*{{{*/
+    int i, steps;
+
+    /* the pages of a full screen comment are turned on release */
+    if (!gogame_isGameOpened() || gogame_isHelpShown() || gogame_isFullCommentShown()
+        || thumbbrowser_isShown())
+        return;
+
+    steps = 1;
+    for (i=0; i<count / SCRUB_ACCEL && steps < SCRUB_MAX_STEPS; i++)
+        steps *= 2;
+
+    for (i=0; i<steps; i++) {
+        switch (key) {
+            case KEY_LEFT:  gogame_move_to_prevEvt(); break;
+            case KEY_RIGHT: gogame_move_to_nextEvt(); break;
+            case KEY_NEXT:  gogame_move_forward(); break;
+            case KEY_PREV:  gogame_move_back(); break;
+            default:        return;
+        }
+    }
+    scrubKey = key;
+
+    if (!bScrubFrame) {
+        bScrubFrame = 1;
+        SetHardTimer("ScrubFrame", scrub_frame, SCRUB_FRAME_DELAY);
+    }
+    SetHardTimer("ScrubRest", scrub_rest, SCRUB_REST_DELAY);
+}/*}}}*/
+
+void scrub_frame()
+{/*{{{*/
+    bScrubFrame = 0;
+    gogame_draw_scrub();
+}/*}}}*/
+
+void scrub_rest()
+{/*{{{*/
+    ClearTimer(scrub_frame);
+    bScrubFrame = 0;
+    gogame_draw_update();
+}/*}}}*/
+
+void scrub_end()
+{/*{{{*/
+    ClearTimer(scrub_rest);
+    scrubKey = 0;
+    scrub_rest();
 }/*}}}*/
 
 int main_handler(int type, int par1, int par2) 
@@ -77,7 +315,7 @@ int main_handler(int type, int par1, int par2)
     if (type == EVT_INIT) {
         // occurs once at startup, only in main handler
 
-        times12 = OpenFont("DejaVuSerif", 12, 1);
+        times12 = fontcache_get("DejaVuSerif", 12);
         // fonts = EnumFonts();
         // fprintf(stderr, "%d\n", i);
         // i = 0;
@@ -86,18 +324,33 @@ int main_handler(int type, int par1, int par2)
             // i += 1;
         // }
 
-        gogame_new_from_file(init_filename);
+        prefetch_init();
+
+        open_init_game();
 
         gogame_printGameInfo();
     }
 
     if (type == EVT_SHOW) {
         // occurs when this event handler becomes active
-        gogame_draw_fullrepaint();
+        if (thumbbrowser_isShown())
+            thumbbrowser_draw();
+        else
+            gogame_draw_fullrepaint();
     }
 
+    if (type == EVT_KEYREPEAT)
+        scrub_repeat(par1, par2);
+
     // if (type == EVT_KEYPRESS) {
-    if (type == EVT_KEYUP) {
+    if (type == EVT_KEYUP && thumbbrowser_isShown()) {
+        /* the browser takes all keys until it is closed */
+        if (!thumbbrowser_key(par1))
+            gogame_draw_fullrepaint();
+    } else if (type == EVT_KEYUP && scrubKey != 0 && par1 == scrubKey) {
+        /* release after scrolling, the steps have been made already */
+        scrub_end();
+    } else if (type == EVT_KEYUP) {
         switch (par1) {
             case KEY_OK:
                 if (gogame_isHelpShown()) {                     /* go from help screen back to game */
@@ -116,12 +369,14 @@ int main_handler(int type, int par1, int par2)
                 break;
 
             case KEY_LEFT:
-                gogame_move_to_prevEvt();
+                if (!gogame_turn_commentPage(-1))
+                    gogame_move_to_prevEvt();
                 gogame_draw_update();
                 break;
 
             case KEY_RIGHT:
-                gogame_move_to_nextEvt();
+                if (!gogame_turn_commentPage(1))
+                    gogame_move_to_nextEvt();
                 gogame_draw_update();
                 break;
 
@@ -136,12 +391,14 @@ int main_handler(int type, int par1, int par2)
                 break;
 
             case KEY_NEXT:
-                gogame_move_forward();
+                if (!gogame_turn_commentPage(1))
+                    gogame_move_forward();
                 gogame_draw_update();
                 break;
 
             case KEY_PREV:
-                gogame_move_back();
+                if (!gogame_turn_commentPage(-1))
+                    gogame_move_back();
                 gogame_draw_update();
                 break;
 
@@ -152,7 +409,17 @@ int main_handler(int type, int par1, int par2)
     }
 
     if (type == EVT_EXIT) {
+        ClearTimer(scrub_frame);
+        ClearTimer(scrub_rest);
+        gogame_save_session();
+        thumbbrowser_close();
+        thumbcache_cleanup();
+        prefetch_cleanup();
         gogame_cleanup();
+        posindex_cleanup();
+        fileselector_cleanup();
+        board_tiles_cleanup();
+        fontcache_cleanup();
     }
 
     return 0;
@@ -0,0 +1,492 @@
+/* droceRoG - persistent index of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "fileindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include <inkview.h>
+
+/******************************************************************************/
+
+#define FILEINDEX_PATH CONFIGPATH "/drocerog_index.txt"
+#define FILEINDEX_HEADER "# droceRoG file index 1\n"
+
+/* bytes read from each SGF file to find the game info */
+#define HEADER_READ_SIZE 4096
+
+typedef struct {
+    FileIndexEntry *entries;
+    int num;
+    int max;
+} FileIndex;
+
+/******************************************************************************/
+
+static FileIndex curIndex = { NULL, 0, 0 };
+static int bLoaded = 0;
+
+/* old entries sorted by path, used while scanning */
+static FileIndexEntry **oldByPath = NULL;
+static int bChanged = 0;
+
+/******************************************************************************/
+
+void index_load();
+void index_save();
+FileIndexEntry *index_add(FileIndex *idx);
+void index_free(FileIndex *idx);
+void scan_dir(FileIndex *idx, const char *dirname, int lvl);
+void scan_file(FileIndex *idx, const char *path, int lvl);
+FileIndexEntry *old_find(const char *path);
+int old_cmp(const void *a, const void *b);
+void entry_copy(FileIndexEntry *dst, const FileIndexEntry *src);
+void entry_setTitle(FileIndexEntry *e);
+void read_header(FileIndexEntry *e);
+char *copy_field(const char *s, size_t len);
+int is_SGF_filename(const char *fname);
+const char *get_filename_in_path(const char *path);
+
+/******************************************************************************/
+
+int fileindex_update(const char *dirname)
+{/*{{{*/
+    FileIndex idx = { NULL, 0, 0 };
+    int i;
+
+    assert(dirname);
+
+    if (!bLoaded)
+        index_load();
+
+    /* sort old entries for the lookup by path */
+    oldByPath = NULL;
+    if (curIndex.num > 0) {
+        oldByPath = (FileIndexEntry **) malloc(sizeof(FileIndexEntry *) * curIndex.num);
+        for (i=0; i<curIndex.num; i++)
+            oldByPath[i] = &curIndex.entries[i];
+        qsort(oldByPath, curIndex.num, sizeof(FileIndexEntry *), old_cmp);
+    }
+
+    bChanged = 0;
+    scan_dir(&idx, dirname, 0);
+    if (idx.num != curIndex.num)
+        bChanged = 1;
+
+    free(oldByPath);
+    oldByPath = NULL;
+
+    index_free(&curIndex);
+    curIndex = idx;
+
+    if (bChanged)
+        index_save();
+
+    return curIndex.num;
+}/*}}}*/
+
+int fileindex_entries(const FileIndexEntry **entries)
+{/*{{{*/
+    if (!bLoaded)
+        index_load();
+
+    *entries = curIndex.entries;
+    return curIndex.num;
+}/*}}}*/
+
+void fileindex_cleanup()
+{/*{{{*/
+    index_free(&curIndex);
+    bLoaded = 0;
+}/*}}}*/
+
+void scan_dir(FileIndex *idx, const char *dirname, int lvl)
+{/*{{{*/
+    struct stat st;
+    DIR *dir;
+    struct dirent *dir_content;
+    char fullpath[256];
+    FileIndexEntry *e, *old;
+    int i;
+
+    if (stat(dirname, &st) != 0 || !S_ISDIR(st.st_mode))
+        return;
+
+    /* add directory itself, empty directories are kept to notice new
+     * files in them */
+    e = index_add(idx);
+    e->path = strdup(dirname);
+    e->mtime = (long) st.st_mtime;
+    e->level = lvl;
+    e->isDir = 1;
+    entry_setTitle(e);
+
+    /* unchanged directory: take its contents from the old index. A file
+     * rewritten in place does not change the mtime of its directory, so
+     * the files are checked as well as the subdirectories */
+    old = old_find(dirname);
+    if (old && old->isDir && old->mtime == (long) st.st_mtime) {
+        for (i = old - curIndex.entries + 1; i < curIndex.num && curIndex.entries[i].level > lvl; i++) {
+            if (curIndex.entries[i].level != lvl + 1)
+                continue;
+            if (curIndex.entries[i].isDir)
+                scan_dir(idx, curIndex.entries[i].path, lvl + 1);
+            else
+                scan_file(idx, curIndex.entries[i].path, lvl + 1);
+        }
+        return;
+    }
+
+    bChanged = 1;
+
+    dir = iv_opendir(dirname);
+    if (!dir) {
+        fprintf(stderr, "[ERROR] Could not open directory %s", dirname);
+        return;
+    }
+
+    while ( (dir_content = iv_readdir(dir)) ) {
+        /* ignore ".." and "." directories */
+        if (!iv_strcmp(dir_content->d_name, ".") || !iv_strcmp(dir_content->d_name, ".."))
+            continue;
+
+        snprintf(fullpath, sizeof(fullpath), "%s/%s", dirname, dir_content->d_name);
+
+        /* recursively move down one dir level */
+        if (dir_content->d_type & DT_DIR) {
+            scan_dir(idx, fullpath, lvl + 1);
+            continue;
+        }
+
+        /* ignore non-sgf files */
+        if (!(dir_content->d_type & DT_REG) || !is_SGF_filename(dir_content->d_name))
+            continue;
+
+        scan_file(idx, fullpath, lvl + 1);
+    }
+
+    iv_closedir( dir );
+}/*}}}*/
+
+/* add the SGF file path, the game info is read only for new or modified
+ * files */
+void scan_file(FileIndex *idx, const char *path, int lvl)
+{/*{{{*/
+    struct stat st;
+    FileIndexEntry *e, *old;
+
+    if (stat(path, &st) != 0) {
+        bChanged = 1;
+        return;
+    }
+
+    old = old_find(path);
+    e = index_add(idx);
+    if (old && !old->isDir && old->mtime == (long) st.st_mtime) {
+        entry_copy(e, old);
+        return;
+    }
+
+    bChanged = 1;
+    e->path = strdup(path);
+    e->mtime = (long) st.st_mtime;
+    e->level = lvl;
+    e->isDir = 0;
+    read_header(e);
+    entry_setTitle(e);
+}/*}}}*/
+
+void index_load()
+{/*{{{*/
+    FILE *file;
+    char line[4096];
+    char *field[8];
+    char *p;
+    FileIndexEntry *e;
+    int n;
+
+    bLoaded = 1;
+    index_free(&curIndex);
+
+    file = fopen(FILEINDEX_PATH, "r");
+    if (!file)
+        return;
+
+    /* ignore index files of other versions */
+    if (!fgets(line, sizeof(line), file) || strcmp(line, FILEINDEX_HEADER) != 0) {
+        fclose(file);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        p = strchr(line, '\n');
+        if (p)
+            *p = '\0';
+
+        /* split tab separated fields */
+        n = 0;
+        field[n++] = line;
+        for (p = line; *p && n < 8; p++) {
+            if (*p == '\t') {
+                *p = '\0';
+                field[n++] = p + 1;
+            }
+        }
+
+        if (!((field[0][0] == 'D' && n == 4) || (field[0][0] == 'F' && n == 8)))
+            continue;
+
+        e = index_add(&curIndex);
+        e->isDir = field[0][0] == 'D';
+        e->level = atoi(field[1]);
+        e->mtime = atol(field[2]);
+        e->path = strdup(field[3]);
+        if (!e->isDir) {
+            e->pb = strdup(field[4]);
+            e->pw = strdup(field[5]);
+            e->dt = strdup(field[6]);
+            e->re = strdup(field[7]);
+        }
+        entry_setTitle(e);
+    }
+
+    fclose(file);
+}/*}}}*/
+
+void index_save()
+{/*{{{*/
+    FILE *file;
+    FileIndexEntry *e;
+    int i;
+
+    /* write a temporary file first, an interrupted write keeps the old index */
+    file = fopen(FILEINDEX_PATH ".tmp", "w");
+    if (!file) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", FILEINDEX_PATH ".tmp");
+        return;
+    }
+
+    fputs(FILEINDEX_HEADER, file);
+    for (i=0; i<curIndex.num; i++) {
+        e = &curIndex.entries[i];
+        if (e->isDir)
+            fprintf(file, "D\t%d\t%ld\t%s\n", e->level, e->mtime, e->path);
+        else
+            fprintf(file, "F\t%d\t%ld\t%s\t%s\t%s\t%s\t%s\n", e->level, e->mtime, e->path,
+                    e->pb, e->pw, e->dt, e->re);
+    }
+
+    if (fclose(file) != 0 || rename(FILEINDEX_PATH ".tmp", FILEINDEX_PATH) != 0)
+        fprintf(stderr, "[ERROR] Could not write %s\n", FILEINDEX_PATH);
+}/*}}}*/
+
+FileIndexEntry *index_add(FileIndex *idx)
+{/*{{{*/
+    FileIndexEntry *e;
+
+    if (idx->num == idx->max) {
+        idx->max = idx->max ? 2 * idx->max : 256;
+        idx->entries = (FileIndexEntry *) realloc(idx->entries, sizeof(FileIndexEntry) * idx->max);
+        assert(idx->entries != NULL);
+    }
+
+    e = &idx->entries[idx->num++];
+    memset(e, 0, sizeof(FileIndexEntry));
+
+    return e;
+}/*}}}*/
+
+void index_free(FileIndex *idx)
+{/*{{{*/
+    FileIndexEntry *e;
+    int i;
+
+    for (i=0; i<idx->num; i++) {
+        e = &idx->entries[i];
+        free(e->path);
+        free(e->title);
+        free(e->pb);
+        free(e->pw);
+        free(e->dt);
+        free(e->re);
+    }
+    free(idx->entries);
+
+    idx->entries = NULL;
+    idx->num = 0;
+    idx->max = 0;
+}/*}}}*/
+
+FileIndexEntry *old_find(const char *path)
+{/*{{{*/
+    FileIndexEntry key, *pKey, **found;
+
+    if (oldByPath == NULL)
+        return NULL;
+
+    key.path = (char *) path;
+    pKey = &key;
+    found = (FileIndexEntry **) bsearch(&pKey, oldByPath, curIndex.num, sizeof(FileIndexEntry *), old_cmp);
+
+    return found ? *found : NULL;
+}/*}}}*/
+
+int old_cmp(const void *a, const void *b)
+{/*{{{*/
+    return strcmp((*(FileIndexEntry * const *) a)->path, (*(FileIndexEntry * const *) b)->path);
+}/*}}}*/
+
+void entry_copy(FileIndexEntry *dst, const FileIndexEntry *src)
+{/*{{{*/
+    dst->path = strdup(src->path);
+    dst->title = strdup(src->title);
+    dst->mtime = src->mtime;
+    dst->level = src->level;
+    dst->isDir = src->isDir;
+    if (!src->isDir) {
+        dst->pb = strdup(src->pb);
+        dst->pw = strdup(src->pw);
+        dst->dt = strdup(src->dt);
+        dst->re = strdup(src->re);
+    }
+}/*}}}*/
+
+void entry_setTitle(FileIndexEntry *e)
+{/*{{{*/
+    char title[512];
+
+    if (e->isDir || (!e->pb[0] && !e->pw[0])) {
+        snprintf(title, sizeof(title), "%s", get_filename_in_path(e->path));
+    } else {
+        snprintf(title, sizeof(title), "%s  (%s - %s%s%s%s%s)", get_filename_in_path(e->path),
+                 e->pb, e->pw,
+                 e->dt[0] ? ", " : "", e->dt,
+                 e->re[0] ? ", " : "", e->re);
+    }
+
+    free(e->title);
+    e->title = strdup(title);
+}/*}}}*/
+
+void read_header(FileIndexEntry *e)
+{/*{{{*/
+    FILE *file;
+    char buf[HEADER_READ_SIZE];
+    char value[128];
+    char name[3];
+    const char *p, *end;
+    size_t len;
+    int n;
+
+    e->pb = NULL;
+    e->pw = NULL;
+    e->dt = NULL;
+    e->re = NULL;
+
+    len = 0;
+    file = fopen(e->path, "rb");
+    if (file) {
+        len = fread(buf, 1, sizeof(buf), file);
+        fclose(file);
+    }
+
+    /* scan the properties of the root node */
+    p = buf;
+    end = buf + len;
+    while (p < end && *p != ';')
+        p++;
+    if (p < end)
+        p++;
+    while (p < end && *p != ';' && *p != '(' && *p != ')') {
+        if (!isupper((int) (unsigned char) *p)) {
+            p++;
+            continue;
+        }
+
+        /* property name, lower case letters are ignored as in the parser */
+        n = 0;
+        while (p < end && isalpha((int) (unsigned char) *p)) {
+            if (isupper((int) (unsigned char) *p) && n < 2)
+                name[n++] = *p;
+            p++;
+        }
+        name[n] = '\0';
+
+        /* property values, the first one is kept */
+        while (p < end && isspace((int) (unsigned char) *p))
+            p++;
+        len = 0;
+        while (p < end && *p == '[') {
+            for (p++; p < end && *p != ']'; p++) {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+                if (len < sizeof(value) - 1)
+                    value[len++] = *p;
+            }
+            p++;
+            while (p < end && isspace((int) (unsigned char) *p))
+                p++;
+        }
+
+        if (strcmp(name, "PB") == 0 && !e->pb)
+            e->pb = copy_field(value, len);
+        else if (strcmp(name, "PW") == 0 && !e->pw)
+            e->pw = copy_field(value, len);
+        else if (strcmp(name, "DT") == 0 && !e->dt)
+            e->dt = copy_field(value, len);
+        else if (strcmp(name, "RE") == 0 && !e->re)
+            e->re = copy_field(value, len);
+    }
+
+    if (!e->pb)
+        e->pb = strdup("");
+    if (!e->pw)
+        e->pw = strdup("");
+    if (!e->dt)
+        e->dt = strdup("");
+    if (!e->re)
+        e->re = strdup("");
+}/*}}}*/
+
+char *copy_field(const char *s, size_t len)
+{/*{{{*/
+    char *copy;
+    size_t i;
+
+    /* tabs and line breaks would break the index file */
+    copy = (char *) malloc(len + 1);
+    for (i=0; i<len; i++)
+        copy[i] = ((unsigned char) s[i] < ' ') ? ' ' : s[i];
+    copy[len] = '\0';
+
+    return copy;
+}/*}}}*/
+
+int is_SGF_filename(const char *fname)
+{/*{{{*/
+    assert(fname);
+
+    return strstr(fname, ".sgf") != NULL;
+}/*}}}*/
+
+const char *get_filename_in_path(const char *path)
+{/*{{{*/
+    unsigned int i;
+    int lastOcc = 0;
+
+    assert(path);
+
+    for (i=0; i<strlen(path); i++) {
+        if (path[i] == '/')
+            lastOcc = i + 1;
+    }
+
+    return path + lastOcc;
+}/*}}}*/
@@ -0,0 +1,45 @@
+/* droceRoG - persistent index of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct {
+    char *path;             /* full path */
+    char *title;            /* text shown in the file selector */
+    long mtime;             /* modification time at the last update */
+    int level;              /* depth below the indexed directory */
+    unsigned int isDir:1;
+    char *pb, *pw;          /* game info of SGF files, "" if unknown */
+    char *dt, *re;
+} FileIndexEntry;
+
+/* Update the index of dirname: only directories with a changed mtime are
+ * read again, but every file is checked with stat(), so the mtime and the
+ * game info of each file entry are current. The result is saved on disk.
+ * The entries are in file selector order, i.e. each directory is followed
+ * by its contents. Returns the number of entries.
+ */
+int fileindex_update(const char *dirname);
+
+/* Get the current entries without scanning the file system. The index is
+ * loaded from disk if necessary. Returns the number of entries, the
+ * entries stay valid until the next fileindex_update() or cleanup.
+ */
+int fileindex_entries(const FileIndexEntry **entries);
+
+/* release the index in memory */
+void fileindex_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILEINDEX_H */
@@ -6,244 +6,244 @@
 #include "fileselector.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 
 #include <inkview.h>
 
-/******************************************************************************/
-
-typedef struct TOC_Elem_s {
-    struct TOC_Elem_s *next;
-    tocentry toc;
-    char full_fname[256];
-    unsigned int isDir:1;
-} TOC_Elem;
+#include "fileindex.h"
+#include "collection.h"
 
 /******************************************************************************/
 
-void (*cb_update_fun)(char *filename) = NULL;
+/* length of a game title in the game list */
+#define GAME_TITLE_SIZE 128
 
-static TOC_Elem *lst;
+void (*cb_update_fun)(char *filename, int game) = NULL;
 
 static tocentry *contents = NULL;
 
+/* files shown by fileselector_chooseFromList() */
+static const char **list_files = NULL;
+
+/* collection shown by choose_game() */
+static char game_file[256] = "";
+static char *game_titles = NULL;
+
 /******************************************************************************/
 
-TOC_Elem *readFileList(char *dirname, int lvl);
-TOC_Elem *tocElem_new();
-void tocElem_free(TOC_Elem *elem);
-int tocElem_getNumInList(TOC_Elem *elem);
+int dir_hasFiles(const FileIndexEntry *entries, int num, int i);
+void list_selected(int page);
+void choose_file(const char *filename);
+void choose_game(const char *filename, const SGFGameInfo *games, int num);
+void game_selected(int page);
 
 /******************************************************************************/
 
 void entry_selected(int page) 
 {/*{{{*/
-    TOC_Elem *cur;
+    const FileIndexEntry *entries;
+    int num;
 
     // fprintf(stderr, "fileselector.c: page %d selected.\n", page);
 
-    /* find selected entry */
-    cur = lst;
-    while (cur && cur->toc.page != page)
-        cur = cur->next;
-    assert(cur != NULL);
-    if (cb_update_fun != NULL)
-        (*cb_update_fun)(cur->full_fname);
-
-    /* free list */
-    while (lst != NULL) {
-        cur = lst;
-        lst = lst->next;
-
-        tocElem_free(cur);
-    }
+    /* the page is the position in the index */
+    num = fileindex_entries(&entries);
+    assert(page >= 0 && page < num);
 
     /* free contents */
     if (contents != NULL)
         free(contents);
+    contents = NULL;
+
+    if (!entries[page].isDir)
+        choose_file(entries[page].path);
 
 }/*}}}*/
 
-void fileselector_chooseFile(void (*cb_update)(char *filename))
+void fileselector_chooseFile(void (*cb_update)(char *filename, int game))
 {/*{{{*/
+    const FileIndexEntry *entries;
     int current_page = 1;
-    TOC_Elem *cur;
-    int i;
-    int numElems;
+    int i, num, numElems;
 
     cb_update_fun = cb_update;
 
-    /* read directory */
-    lst = readFileList(FLASHDIR, 0);
+    /* update index, only changed directories are read */
+    fileindex_update(FLASHDIR);
+    num = fileindex_entries(&entries);
 
-    /* add increasing number to toc list */
-    i = 0;
-    for (cur = lst; cur; cur = cur->next) {
-        // fprintf(stderr, "list elem: %s [lvl: %d]\n", cur->full_fname, cur->toc.level);
-        cur->toc.page = i;
-        cur->toc.position = (long long) i;
-        i += 1;
-    }
+    /* return if no file is found */
+    if (num <= 1)
+        return;
 
-    numElems = tocElem_getNumInList(lst);
+    /* build and populate contents list, the root directory and
+     * directories without SGF files are not shown */
+    contents = (tocentry *) malloc(sizeof(tocentry) * (num - 1));
+    numElems = 0;
+    for (i=1; i<num; i++) {
+        if (entries[i].isDir && !dir_hasFiles(entries, num, i))
+            continue;
 
-    /* free list and return if only one element is found */
-    if (numElems <= 1) {
-        tocElem_free(lst);
-        return;
+        contents[numElems].level = entries[i].level;
+        contents[numElems].page = i;
+        contents[numElems].position = (long long) i;
+        contents[numElems].text = entries[i].title;
+        numElems += 1;
     }
 
-    /* build and populate contents list */
-    contents = (tocentry *) malloc(sizeof(tocentry) * (numElems - 1));
-    cur = lst->next;
-    for (i=0; i<numElems-1; i++) {
-        contents[i].level = cur->toc.level;
-        contents[i].page = cur->toc.page;
-        contents[i].position = cur->toc.position;
-        contents[i].text = cur->toc.text;
-
-        cur = cur->next;
+    if (numElems == 0) {
+        free(contents);
+        contents = NULL;
+        return;
     }
 
-    // for (i=0; i<numElems-1; i++) {
+    // for (i=0; i<numElems; i++) {
         // fprintf(stderr, "contents[%d] = (lvl: %d, text: %s, page: %d, pos: %d)\n", 
                 // i, contents[i].level, contents[i].text,
                 // contents[i].page, (int) contents[i].position);
     // }
-    // fprintf(stderr, "ready building up content list\n");
-    // fflush(stderr);
 
-    OpenContents(contents, numElems-1, current_page, (iv_tochandler) entry_selected);
+    OpenContents(contents, numElems, current_page, (iv_tochandler) entry_selected);
 
     // fprintf(stderr, "finished OpenContents\n");
 }/*}}}*/
 
-int is_SGF_filename(char *fname)
+void fileselector_chooseFromList(const char **files, int num, void (*cb_update)(char *filename, int game))
 {/*{{{*/
-    assert(fname);
+    const FileIndexEntry *entries;
+    int i, j, numEntries;
+
+    if (num <= 0)
+        return;
 
-    return strstr(fname, ".sgf") > (char *)NULL;
+    cb_update_fun = cb_update;
+    list_files = files;
+
+    /* show the titles of the index, e.g. with the players */
+    numEntries = fileindex_entries(&entries);
+    contents = (tocentry *) malloc(sizeof(tocentry) * num);
+    for (i=0; i<num; i++) {
+        for (j=0; j<numEntries && (entries[j].isDir || strcmp(entries[j].path, files[i]) != 0); j++) {}
+
+        contents[i].level = 1;
+        contents[i].page = i;
+        contents[i].position = (long long) i;
+        contents[i].text = (char *) (j < numEntries ? entries[j].title : files[i]);
+    }
+
+    OpenContents(contents, num, 0, (iv_tochandler) list_selected);
 }/*}}}*/
 
-char* get_filename_in_path(char *path)
+void fileselector_openFile(const char *filename, void (*cb_update)(char *filename, int game))
 {/*{{{*/
-    unsigned int i;
-    int lastOcc = 0;
+    cb_update_fun = cb_update;
+    choose_file(filename);
+}/*}}}*/
 
-    assert(path);
+void list_selected(int page)
+{/*{{{*/
+    const char **files = list_files;
 
-    for (i=0; i<strlen(path); i++) {
-        if (path[i] == '/')
-            lastOcc = i + 1;
-    }
+    list_files = NULL;
+    if (contents != NULL)
+        free(contents);
+    contents = NULL;
 
-    return path + lastOcc;
+    if (files != NULL)
+        choose_file(files[page]);
 }/*}}}*/
 
-TOC_Elem *readFileList(char *dirname, int lvl)
+void choose_file(const char *filename)
 {/*{{{*/
-    DIR *dir;
-    struct dirent *dir_content;
-    char fullpath[256];
-    TOC_Elem *subdir, *curElem, *curList;
-    
-    dir = iv_opendir(dirname); /* root directory */
-    if (!dir) {
-        fprintf(stderr, "[ERROR] Could not open directory %s", dirname);
-        return NULL;
-    }
+    const SGFGameInfo *games;
+    int num;
+
+    /* only the header of each game is scanned for the game list */
+    num = collection_scan(filename, &games);
+    if (num > 1)
+        choose_game(filename, games, num);
+    else if (cb_update_fun != NULL)
+        (*cb_update_fun)((char *) filename, 0);
+}/*}}}*/
 
-    /* add current directory to toc list */
-    curElem = tocElem_new();
-    snprintf(curElem->full_fname, sizeof(curElem->full_fname), "%s", dirname);
-    curElem->isDir = 1;
-    curElem->toc.level = lvl;
-    /* point only to filename */
-    curElem->toc.text = get_filename_in_path(curElem->full_fname);
-    curList = curElem; /* save beginning */
-
-    while ( (dir_content = iv_readdir(dir)) ) {
-        /* ignore ".." and "." directories */
-        if (!iv_strcmp(dir_content->d_name, ".") || !iv_strcmp(dir_content->d_name, ".."))
-            continue;
+void choose_game(const char *filename, const SGFGameInfo *games, int num)
+{/*{{{*/
+    int i;
 
-        /* recursively move down one dir level */
-        if (dir_content->d_type & DT_DIR) {
-            snprintf(fullpath, sizeof(fullpath), "%s/%s", dirname, dir_content->d_name);
-            subdir = readFileList(fullpath, lvl + 1);
-
-            /* ignore subdirectory if only one element exists (the dir name itself) */
-            if (tocElem_getNumInList(subdir) <= 1) {
-                tocElem_free(subdir);
-                continue;
-            }
-
-            /* add subdirectory lists to curElem */
-            curElem->next = subdir;
-            while (curElem->next)   /* move to end of list */
-                curElem = curElem->next;
-        }
-
-        /* ignore non-sgf files */
-        if (dir_content->d_type & DT_REG && is_SGF_filename(dir_content->d_name)) {
-            /* add file element to list */
-            curElem->next = tocElem_new();
-            curElem = curElem->next;
-            snprintf(curElem->full_fname, sizeof(curElem->full_fname),
-                     "%s/%s",
-                     dirname, dir_content->d_name);
-            curElem->isDir = 0;
-            curElem->toc.level = lvl + 1;
-            /* point only to filename */
-            curElem->toc.text = get_filename_in_path(curElem->full_fname);
-        }
-            
-
-        // fprintf(stderr, "dir content: %s/%s [lvl: %d] [isFile: %d] [isDir: %d]\n",
-                // dirname, dir_content->d_name, lvl,
-                // dir_content->d_type & DT_REG, dir_content->d_type & DT_DIR);
+    /* filename may be part of the file index or the list of files */
+    snprintf(game_file, sizeof(game_file), "%s", filename);
+
+    contents = (tocentry *) malloc(sizeof(tocentry) * num);
+    game_titles = (char *) malloc(GAME_TITLE_SIZE * num);
+    for (i=0; i<num; i++) {
+        collection_title(games, i, game_titles + i * GAME_TITLE_SIZE, GAME_TITLE_SIZE);
+
+        contents[i].level = 1;
+        contents[i].page = i;
+        contents[i].position = (long long) i;
+        contents[i].text = game_titles + i * GAME_TITLE_SIZE;
     }
 
-    iv_closedir( dir );
+    OpenContents(contents, num, 0, (iv_tochandler) game_selected);
+}/*}}}*/
+
+void game_selected(int page)
+{/*{{{*/
+    if (contents != NULL)
+        free(contents);
+    contents = NULL;
+    free(game_titles);
+    game_titles = NULL;
 
-    return curList;
+    if (cb_update_fun != NULL)
+        (*cb_update_fun)(game_file, page);
 }/*}}}*/
 
-TOC_Elem *tocElem_new()
+const char *fileselector_getNeighbour(const char *filename, int dir)
 {/*{{{*/
-    TOC_Elem *elem;
+    const FileIndexEntry *entries;
+    int i, num;
+
+    assert(filename);
 
-    elem = (TOC_Elem *) malloc(sizeof(TOC_Elem));
+    /* no index so far, e.g. file given at program start */
+    if (fileindex_entries(&entries) == 0)
+        fileindex_update(FLASHDIR);
+    num = fileindex_entries(&entries);
 
-    elem->next = NULL;
-    elem->isDir = 0;
-    elem->toc.level = 0;
-    elem->toc.page = 0;
-    elem->toc.position = 0;
-    elem->toc.text = NULL;
+    for (i=0; i<num; i++) {
+        if (!entries[i].isDir && strcmp(entries[i].path, filename) == 0)
+            break;
+    }
+    if (i == num)
+        return NULL;
+
+    /* next file in the given direction */
+    do {
+        i += dir > 0 ? 1 : -1;
+    } while (i >= 0 && i < num && entries[i].isDir);
+    if (i < 0 || i >= num)
+        return NULL;
 
-    return elem;
+    return entries[i].path;
 }/*}}}*/
 
-void tocElem_free(TOC_Elem *elem)
+void fileselector_cleanup()
 {/*{{{*/
-    if (elem != NULL)
-        free(elem);
+    fileindex_cleanup();
+    collection_cleanup();
 }/*}}}*/
 
-int tocElem_getNumInList(TOC_Elem *elem)
+int dir_hasFiles(const FileIndexEntry *entries, int num, int i)
 {/*{{{*/
-    int num = 0;
-
-    if (!elem)
-        return -1;
+    int j;
 
-    while (elem) {
-        num += 1;
-        elem = elem->next;
+    for (j=i+1; j<num && entries[j].level > entries[i].level; j++) {
+        if (!entries[j].isDir)
+            return 1;
     }
 
-    return num;
+    return 0;
 }/*}}}*/
-
@@ -7,9 +7,30 @@
 #define FILESELECTOR_H
 
 /* Choose an SGF file by opening a selection tool and save the result by
- * calling "cb_update(filename)".
+ * calling "cb_update(filename, game)". For a collection of several games
+ * the game is chosen in a second list, otherwise game is 0.
  */
-void fileselector_chooseFile(void (*cb_update)(char *filename));
+void fileselector_chooseFile(void (*cb_update)(char *filename, int game));
+
+/* Choose one of num files, e.g. search results, like
+ * fileselector_chooseFile(). The list has to stay valid until the
+ * selection is done.
+ */
+void fileselector_chooseFromList(const char **files, int num, void (*cb_update)(char *filename, int game));
+
+/* Open filename as if it was chosen in the selector, i.e. the game of a
+ * collection is chosen in a list first.
+ */
+void fileselector_openFile(const char *filename, void (*cb_update)(char *filename, int game));
+
+/* Get the SGF file after (dir > 0) or before (dir < 0) filename in the
+ * order of the file selector. Returns NULL if there is none. The string
+ * stays valid until the next directory scan.
+ */
+const char *fileselector_getNeighbour(const char *filename, int dir);
+
+/* free the file list of the last directory scan */
+void fileselector_cleanup();
 
 #endif /* FILESELECTOR_H */
 
@@ -0,0 +1,66 @@
+/* droceRoG - fonts shared by all games
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "fontcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+
+typedef struct {
+    char name[32];
+    int size;
+    ifont *font;
+} FontEntry;
+
+typedef struct {
+    FontEntry *entries;
+    int num, max;
+} FontCache;
+
+/******************************************************************************/
+
+static FontCache fonts = { NULL, 0, 0 };
+
+/******************************************************************************/
+
+ifont *fontcache_get(const char *name, int size)
+{/*{{{*/
+    FontEntry *entries;
+    int i;
+
+    for (i=0; i<fonts.num; i++) {
+        if (fonts.entries[i].size == size && strcmp(fonts.entries[i].name, name) == 0)
+            return fonts.entries[i].font;
+    }
+
+    if (fonts.num == fonts.max) {
+        fonts.max = fonts.max ? 2 * fonts.max : 8;
+        entries = (FontEntry *) realloc(fonts.entries, sizeof(FontEntry) * fonts.max);
+        if (entries == NULL) {
+            fonts.max = fonts.num;
+            return NULL;
+        }
+        fonts.entries = entries;
+    }
+
+    snprintf(fonts.entries[fonts.num].name, sizeof(fonts.entries[fonts.num].name), "%s", name);
+    fonts.entries[fonts.num].size = size;
+    fonts.entries[fonts.num].font = OpenFont(name, size, 1);
+    return fonts.entries[fonts.num++].font;
+}/*}}}*/
+
+void fontcache_cleanup()
+{/*{{{*/
+    int i;
+
+    for (i=0; i<fonts.num; i++)
+        CloseFont(fonts.entries[i].font);
+    free(fonts.entries);
+    fonts.entries = NULL;
+    fonts.num = fonts.max = 0;
+}/*}}}*/
@@ -0,0 +1,30 @@
+/* droceRoG - fonts shared by all games
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef FONTCACHE_H
+#define FONTCACHE_H
+
+#include <inkview.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Font name of the given size (antialiased), opened with the first
+ * request and kept until fontcache_cleanup(), i.e. the fonts of the first
+ * game are reused by all following ones. The fonts are owned by the
+ * cache, do not close them.
+ */
+ifont *fontcache_get(const char *name, int size);
+
+/* close all fonts, at exit */
+void fontcache_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FONTCACHE_H */
@@ -1,9 +1,12 @@
-/* Implementation of Go board methods.
+/* Implementation of Go board methods: drawing of the board. The rules are
+ * implemented in goboard_core.c.
  *
  * Author: Christoph Hermes (hermes@hausmilbe.net)
  */
 
-#include "goboard.h"
+#include "goboard_core.h"
+#include "fontcache.h"
+#include "perf.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -13,744 +16,316 @@
 
 /******************************************************************************/
 
-typedef enum { /* WARNING: when changing the element number, consider the bit
-                * field length in GoBoardElement */
-    GRID_TL, GRID_T, GRID_TR,        /* top left, top, top right          */
-    GRID_L, GRID_R, GRID_C, GRID_CP, /* left, right, center, center point */
-    GRID_BL, GRID_B, GRID_BR         /* bottom left, bottom, bottom right */
-} GridType;
 const char gridTypeString[10][2] = { "B", "C", "D",
                                      "E", "F", "A", "J",
                                      "G", "I", "H" };
-
-typedef enum { /* WARNING: when changing the element number, consider the bit
-                * field length in GoBoardElement */
-    FIELD_EMPTY,              /* empty field */
-    FIELD_BLACK, FIELD_WHITE  /* black and white stone */
-} FieldType;
 const char fieldTypeString[3][2] = { " ", /* empty field not used */
                                      "K", "L" };
-
-typedef enum { /* WARNING: when changing the element number, consider the bit
-                * field length in GoBoardElement */
-    MARKER_EMPTY,                                   /* no marker */
-    MARKER_KO,                                      /* ko marker */
-    MARKER_SQUARE, MARKER_CIRC, MARKER_TRIANGLE     /* shape marker */
-} MarkerType;
 const char markerTypeString[5][2] = { " ", /* empty marker, not used */
                                       "M",
                                       "M", "N", "O" };
 
 typedef struct
 {
-    unsigned grid_type:4;   /* GridType */
-    unsigned field_type:2;  /* FieldType */
-    unsigned marker_type:3; /* MarkerType */
-    unsigned draw_update:1; /* Update this field? */
-} GoBoardElement;
-
-typedef struct
-{
-    int size;               /* size x size */
-    GoBoardElement *board;  /* board[col * size + row] */
-    int num_caps_b;         /* captured stones, black and white */
-    int num_caps_w;
-    int cur_move_r;         /* current move, if val < 0, no current */
-    int cur_move_c;         /* move is set. */
     int draw_elemSize;      /* size in points for each field element */
     ifont *draw_font;       /* ttf handler for the drocerog ttf */
     int draw_offset_x;      /* move the board the specified points right */
     int draw_offset_y;      /* move the board the specified points down */
-} GoBoard;
+} BoardDisplay;
 
-enum BOOL { FALSE, TRUE };
+typedef struct {
+    short r_min, c_min;     /* fields of a screen refresh, inclusive */
+    short r_max, c_max;
+} DirtyRect;
 
-typedef struct ListElem_s {
-    struct ListElem_s *next;
-    int data;               /* FieldType and MarkerType are integers (enum) */
-    int r;                  /* element placed on pos (r,c) */
-    int c;
-} ListElem;
+/* Cost of a screen refresh in fields: each PartialUpdateBW() costs as much
+ * as refreshing REFRESH_COST_FIXED additional fields. */
+#define REFRESH_COST_FIXED 6
 
-typedef struct HistoryElem_s {
-    struct HistoryElem_s *prev;
-    ListElem *stones_placed;
-    ListElem *stones_removed;
-    ListElem *marker_set;
-    ListElem *curMove;      /* link to list element in stones_placed */
-} HistoryElem;
+/* more dirty fields are refreshed with their bounding box */
+#define MAX_DIRTY_RECTS 48
 
-/******************************************************************************/
+/* one tile for each combination of GridType, FieldType, MarkerType and
+ * current move */
+#define NUM_TILES (10 * 3 * 5 * 2)
 
-static GoBoard *curBoard = NULL;
+typedef struct {
+    int elemSize;           /* size of the tiles in points */
+    ibitmap *tiles[NUM_TILES];
+} TileCache;
 
-static HistoryElem *history_curNode = NULL;
+typedef struct {
+    int bFast;              /* refresh with DynamicUpdate() */
+    int bGhosts;            /* area below refreshed fast since */
+    DirtyRect area;
+} FastRefresh;
 
 /******************************************************************************/
 
-void clearDeadGroups(int cur_r, int cur_c);
-void hist_free(HistoryElem *curNode);
-HistoryElem *hist_newElem(HistoryElem *prevElem);   /* prevElem is allowed to be NULL */
-void list_free(ListElem *curNode);
-ListElem *list_newElem(ListElem *prevElem, int r, int c, int data); /* prevElem is allowed to be NULL */
+static BoardDisplay display = { 0, NULL, 0, 0 };
 
-/******************************************************************************/
+/* Rendered fields, kept across boards with the same field size. A field is
+ * drawn with the font once and copied from the screen, afterwards it is a
+ * single DrawBitmap(). */
+static TileCache tileCache = { 0, { NULL } };
 
-void board_new(int size, int offset_y)
-{/*{{{*/
-    int r, c, i, hoshi;
-
-    if (curBoard != NULL)
-        board_cleanup();
-
-    /* allocate memory */
-    curBoard = (GoBoard*) malloc( sizeof(GoBoard) );
-    curBoard->size = size;
-    curBoard->board = (GoBoardElement *) malloc( sizeof(GoBoardElement) * size * size );
-
-    /* init board grid and fields */
-    for (r=0; r<size; r++) {
-        for (c=0; c<size; c++) {
-            i = c * size + r;
-
-            /* empty field */
-            curBoard->board[i].field_type = FIELD_EMPTY;
-            /* empty marker */
-            curBoard->board[i].marker_type = MARKER_EMPTY;
-            /* update field when drawing */
-            curBoard->board[i].draw_update = TRUE;
-
-            /* common grid point */
-            curBoard->board[i].grid_type = GRID_C;
-
-            /* curBoard borders */
-            if (r == 0)      curBoard->board[i].grid_type = GRID_T;
-            if (r == size-1) curBoard->board[i].grid_type = GRID_B;
-            if (c == 0)      curBoard->board[i].grid_type = GRID_L;
-            if (c == size-1) curBoard->board[i].grid_type = GRID_R;
-
-            /* corners */
-            if (r == 0 && c == 0)           curBoard->board[i].grid_type = GRID_TL;
-            if (r == 0 && c == size-1)      curBoard->board[i].grid_type = GRID_TR;
-            if (r == size-1 && c == 0)      curBoard->board[i].grid_type = GRID_BL;
-            if (r == size-1 && c == size-1) curBoard->board[i].grid_type = GRID_BR;
+/* fast refreshes leave ghosts, their area is refreshed cleanly later */
+static FastRefresh fastRefresh = { 0, 0, { 0, 0, 0, 0 } };
 
-        }
-    }
-    /* star points (hoshi) */
-    if (size % 2 == 1) {
-        curBoard->board[(int)(size/2) * size + (int)(size/2)].grid_type = GRID_CP;
-    }
-    if (size < 9)  hoshi = -1;
-    if (size == 9) hoshi = 2;
-    if (size > 9)  hoshi = 3;
-    if (hoshi > 0) {
-        curBoard->board[hoshi * size + hoshi].grid_type = GRID_CP;
-        if (size % 2 == 1)
-            curBoard->board[hoshi * size + (int)(size/2)].grid_type = GRID_CP;
-        curBoard->board[hoshi * size + (size - hoshi - 1)].grid_type = GRID_CP;
-        if (size % 2 == 1) {
-            curBoard->board[(int)(size/2) * size + hoshi].grid_type = GRID_CP;
-            curBoard->board[(int)(size/2) * size + (size - hoshi - 1)].grid_type = GRID_CP;
-        }
-        curBoard->board[(size - hoshi - 1) * size + hoshi].grid_type = GRID_CP;
-        if (size % 2 == 1)
-            curBoard->board[(size - hoshi - 1) * size + (int)(size/2)].grid_type = GRID_CP;
-        curBoard->board[(size - hoshi - 1) * size + (size - hoshi - 1)].grid_type = GRID_CP;
-    }
-
-    /* set font size and load ttf */
-    curBoard->draw_elemSize = (int) (ScreenWidth() / size);
-    curBoard->draw_font = OpenFont("drocerog", curBoard->draw_elemSize, 1);
-    curBoard->draw_offset_x = (int) ((ScreenWidth() - curBoard->draw_elemSize * size) / 2);
-    curBoard->draw_offset_y = offset_y;
-
-    /* init captured stones */
-    curBoard->num_caps_b = 0;
-    curBoard->num_caps_w = 0;
+/******************************************************************************/
 
-    /* init current move */
-    curBoard->cur_move_r = -1;
-    curBoard->cur_move_c = -1;
+void field_draw(int i);
+void tiles_reset(int elemSize);
+int dirty_cluster(DirtyRect *rects);
+int rect_cost(const DirtyRect *a);
+void rect_merge(DirtyRect *dst, const DirtyRect *a, const DirtyRect *b);
+int rect_overlaps(const DirtyRect *a, const DirtyRect *b);
+void rect_refresh(const DirtyRect *r, int bClean);
 
-    /* init history */
-    history_curNode = hist_newElem(NULL);
+/******************************************************************************/
 
+void board_new(int size, int offset_y)
+{/*{{{*/
+    board_core_new(size);
+
+    /* set font size and get the ttf */
+    display.draw_elemSize = (int) (ScreenWidth() / size);
+    display.draw_font = fontcache_get("drocerog", display.draw_elemSize);
+    display.draw_offset_x = (int) ((ScreenWidth() - display.draw_elemSize * size) / 2);
+    display.draw_offset_y = offset_y;
+    fastRefresh.bGhosts = 0;
+    if (tileCache.elemSize != display.draw_elemSize)
+        tiles_reset(display.draw_elemSize);
 }/*}}}*/
 
-HistoryElem *hist_newElem(HistoryElem *prevElem)
+void board_cleanup()
 {/*{{{*/
-    HistoryElem *newElem;
+    /* the font stays in the font cache */
+    display.draw_font = NULL;
 
-    newElem = (HistoryElem *) malloc(sizeof(HistoryElem));
-    newElem->prev = prevElem;
-    newElem->stones_placed = NULL;
-    newElem->stones_removed = NULL;
-    newElem->marker_set = NULL;
-    newElem->curMove = NULL;
-
-    return newElem;
+    board_core_cleanup();
 }/*}}}*/
 
-ListElem *list_newElem(ListElem *prevElem, int r, int c, int data)
+void board_tiles_cleanup()
 {/*{{{*/
-    ListElem *newElem;
-
-    newElem = (ListElem *) malloc(sizeof(ListElem));
-    newElem->next = NULL;
-    newElem->r = r;
-    newElem->c = c;
-    newElem->data = data;
-    if (prevElem != NULL) {
-        while (prevElem->next)
-            prevElem = prevElem->next;
-        prevElem->next = newElem;
-    }
-
-    return newElem;
+    tiles_reset(0);
 }/*}}}*/
 
-void board_placeStone(int r, int c, BoardPlayer player, int bIsMove)
+void board_draw_update(int bPartialUpdate)
 {/*{{{*/
-    ListElem *elem;
+    DirtyRect rects[MAX_DIRTY_RECTS];
+    int i, n;
 
     assert( curBoard != NULL );
-    assert( r >= 0 );
-    assert( c >= 0 );
-    assert( r < curBoard->size );
-    assert( c < curBoard->size );
-
-    switch (player) {
-        case BOARD_BLACK:
-            curBoard->board[c * curBoard->size + r].field_type = FIELD_BLACK;
-            break;
 
-        case BOARD_WHITE:
-            curBoard->board[c * curBoard->size + r].field_type = FIELD_WHITE;
-            break;
-    }
-    curBoard->board[c * curBoard->size + r].draw_update = 1;
-
-    /* update current move */
-    if (bIsMove) {
-        /* update old cur_move coordinates */
-        if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
-            curBoard->board[curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r].draw_update = 1;
-            
-        curBoard->cur_move_r = r;
-        curBoard->cur_move_c = c;
-        /* draw_update already set to 1 */
-    }
+    SetFont(display.draw_font, BLACK);
 
-    /* update history */
-    if (bIsMove) { 
-        /* new move creates a new history element */
-        history_curNode = hist_newElem(history_curNode);
-        /* new move, cleanup previous marker data */
-        if (history_curNode->prev) {
-            for (elem = history_curNode->prev->marker_set; elem; elem = elem->next) {
-                // fprintf(stderr, "removing marker %d at pos (%d,%d)\n", 
-                    // curBoard->board[elem->c * curBoard->size + elem->r].marker_type,
-                    // elem->c, elem->r);
-                curBoard->board[elem->c * curBoard->size + elem->r].marker_type = MARKER_EMPTY;
-                curBoard->board[elem->c * curBoard->size + elem->r].draw_update = 1;
-            }
-        }
+    /* full repaint, the FullUpdate() call is left to the caller */
+    if (!bPartialUpdate) {
+        for (i=0; i<curBoard->size*curBoard->size; i++)
+            field_draw(i);
+        curBoard->num_dirty = 0;
+        fastRefresh.bGhosts = 0;
+        return;
     }
-    elem = list_newElem(history_curNode->stones_placed, r, c, curBoard->board[c * curBoard->size + r].field_type);
-    /* if stones_placement list is empty, create a ew one */
-    if (history_curNode->stones_placed == NULL)
-        history_curNode->stones_placed = elem;
-    if (bIsMove)
-        history_curNode->curMove = elem;
-
-    /* remove stones if necessary */
-    if (bIsMove)
-        clearDeadGroups(r, c);
-
-    // /* print history after this move */
-    // {
-        // HistoryElem *curHist;
-        // ListElem *curLstElem;
-        // for (curHist=history_curNode; curHist; curHist = curHist->prev) {
-            // fprintf(stderr, "H[");
-            // for (curLstElem=curHist->stones_placed; curLstElem; curLstElem=curLstElem->next)
-                // fprintf(stderr, " P[%d,%d]", curLstElem->r, curLstElem->c);
-            // for (curLstElem=curHist->stones_removed; curLstElem; curLstElem=curLstElem->next)
-                // fprintf(stderr, " R[%d,%d]", curLstElem->r, curLstElem->c);
-            // fprintf(stderr, " ]\n <- ");
-        // }
-        // fprintf(stderr, "END \n");
-    // }
 
-}/*}}}*/
+    if (curBoard->num_dirty == 0 && !fastRefresh.bGhosts)
+        return;
 
-void board_placeMarker(int r, int c, BoardMarker marker)
-{/*{{{*/
-    ListElem *elem;
+    /* group the dirty fields before drawing resets their flags */
+    n = curBoard->num_dirty > 0 ? dirty_cluster(rects) : 0;
 
-    assert( curBoard != NULL );
-    assert( r >= 0 );
-    assert( c >= 0 );
-    assert( r < curBoard->size );
-    assert( c < curBoard->size );
-
-    switch (marker) {
-        case MARK_SQUARE:
-            curBoard->board[c * curBoard->size + r].marker_type = MARKER_SQUARE;
-            break;
-
-        case MARK_CIRC:
-            curBoard->board[c * curBoard->size + r].marker_type = MARKER_CIRC;
-            break;
+    for (i=0; i<curBoard->num_dirty; i++)
+        field_draw(curBoard->dirty[i]);
+    curBoard->num_dirty = 0;
 
-        case MARK_TRIANGLE:
-            curBoard->board[c * curBoard->size + r].marker_type = MARKER_TRIANGLE;
-            break;
-    }
-    curBoard->board[c * curBoard->size + r].draw_update = 1;
-
-    /* update history */
-    elem = list_newElem(history_curNode->marker_set, r, c, curBoard->board[c * curBoard->size + r].marker_type);
-    /* If stones_placement list is empty, create a new one.
-     * Otherwise, the element is already placed in the history chain. 
-     */
-    if (history_curNode->marker_set == NULL) {
-        history_curNode->marker_set = elem;
+    /* the fields refreshed fast are refreshed cleanly once at rest,
+     * together with the dirty ones */
+    if (!fastRefresh.bFast && fastRefresh.bGhosts) {
+        for (i=0; i<n; i++)
+            rect_merge(&fastRefresh.area, &fastRefresh.area, &rects[i]);
+        fastRefresh.bGhosts = 0;
+        rect_refresh(&fastRefresh.area, 1);
+        return;
     }
-}/*}}}*/
-
-int board_undo()
-{/*{{{*/
-    HistoryElem *oldHist = NULL;
-    ListElem *curLstElem = NULL;
 
-    assert( curBoard != NULL );
-    assert( history_curNode != NULL );
-
-    /* check if undo is possible */
-    if (!history_curNode->prev)
-        return 0;
-
-    oldHist = history_curNode;
-    history_curNode = history_curNode->prev;
-
-    /* undo stone removal */
-    for (curLstElem=oldHist->stones_removed; curLstElem; curLstElem=curLstElem->next) {
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].field_type = curLstElem->data;
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].draw_update = 1;
-        /* notice undo removal in number of captured stones */
-        switch (curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].field_type) {
-            case FIELD_BLACK:
-                    curBoard->num_caps_b -= 1;
-                break;
-            case FIELD_WHITE:
-                    curBoard->num_caps_w -= 1;
-                break;
+    for (i=0; i<n; i++) {
+        if (fastRefresh.bFast) {
+            if (fastRefresh.bGhosts)
+                rect_merge(&fastRefresh.area, &fastRefresh.area, &rects[i]);
+            else
+                fastRefresh.area = rects[i];
+            fastRefresh.bGhosts = 1;
         }
+        rect_refresh(&rects[i], 0);
     }
-    /* undo stone placement */
-    for (curLstElem=oldHist->stones_placed; curLstElem; curLstElem=curLstElem->next) {
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].field_type = FIELD_EMPTY;
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].draw_update = 1;
-    }
-    /* undo marker */
-    for (curLstElem=oldHist->marker_set; curLstElem; curLstElem=curLstElem->next) {
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].marker_type = MARKER_EMPTY;
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].draw_update = 1;
-    }
-    for (curLstElem=history_curNode->marker_set; curLstElem; curLstElem=curLstElem->next) {
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].marker_type = curLstElem->data;
-        curBoard->board[curLstElem->c * curBoard->size + curLstElem->r].draw_update = 1;
-    }
-    /* undo current move marker */
-    curBoard->board[curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r].draw_update = 1;
-    if (history_curNode->curMove) {
-        curBoard->cur_move_r = history_curNode->curMove->r;
-        curBoard->cur_move_c = history_curNode->curMove->c;
-    } else {
-        curBoard->cur_move_r = -1;
-        curBoard->cur_move_c = -1;
-    }
-    curBoard->board[curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r].draw_update = 1;
-
-
-    /* unchain old history element and delete it */
-    oldHist->prev = NULL;
-    hist_free(oldHist);
-
-    return 1;
 }/*}}}*/
 
-void clearDeadGroups(int cur_r, int cur_c)
+void board_set_fastRefresh(int bFast)
 {/*{{{*/
-    short *groups = NULL;
-    short *idxs = NULL;
-    short lastIdx = 1;
-    short oldIdx = 0;
-    short neighbors[5];
-    int neighborsLibs[5];
-    int r, c, sz, i, j;
-    int bFoundElem;
-
-    assert( curBoard != NULL );
-
-    sz = curBoard->size;
+    fastRefresh.bFast = bFast;
+}/*}}}*/
 
-    /* TODO: only two rows are necessary! */
-    groups = (short *) malloc(sizeof(short) * sz * sz);
-    idxs = (short *) malloc(sizeof(short) * sz * sz);
+/* screen refresh of the fields in r, with the full waveform if bClean is set */
+void rect_refresh(const DirtyRect *r, int bClean)
+{/*{{{*/
+    int x, y, w, h;
+
+    x = display.draw_offset_x + r->c_min * display.draw_elemSize;
+    y = display.draw_offset_y + r->r_min * display.draw_elemSize;
+    w = display.draw_elemSize * (r->c_max - r->c_min + 1);
+    h = display.draw_elemSize * (r->r_max - r->r_min + 1);
+
+    if (bClean)
+        PERF_REFRESH(PERF_PARTIAL_UPDATE, w, h, PartialUpdate(x, y, w, h));
+    else if (fastRefresh.bFast)
+        PERF_REFRESH(PERF_PARTIAL_UPDATE, w, h, DynamicUpdate(x, y, w, h));
+    else
+        PERF_REFRESH(PERF_PARTIAL_UPDATE, w, h, PartialUpdateBW(x, y, w, h));
+}/*}}}*/
 
-    /* init index list */
-    for (r=0; r<(sz*sz); r++) {
-        idxs[r] = r-1;
-        groups[r] = 99;
+void field_draw(int i)
+{/*{{{*/
+    GoBoardElement *field = &curBoard->board[i];
+    int r, c, x, y, bCurrent, key;
+
+    r = i % curBoard->size;
+    c = i / curBoard->size;
+    x = display.draw_offset_x + c * display.draw_elemSize;
+    y = display.draw_offset_y + r * display.draw_elemSize;
+    bCurrent = curBoard->cur_move_r == r && curBoard->cur_move_c == c;
+
+    field->draw_update = 0;
+
+    /* use the rendered tile if available */
+    key = ((field->grid_type * 3 + field->field_type) * 5 + field->marker_type) * 2 + bCurrent;
+    if (tileCache.tiles[key] != NULL) {
+        DrawBitmap(x, y, tileCache.tiles[key]);
+        return;
     }
 
-    for (r=0; r<sz; r++) {
-        for (c=0; c<sz; c++) {
-            if (curBoard->board[c * sz + r].field_type == FIELD_EMPTY) {
-                groups[c * sz + r] = 0;
-                continue;
-            }
-
-            if (r == 0 && c == 0) {
-                groups[c * sz + r] = lastIdx;
-                lastIdx += 1;
-            } else if (r == 0 && c > 0) {
-                if (curBoard->board[c * sz + r].field_type == curBoard->board[(c-1) * sz + r].field_type) {
-                    groups[c * sz + r] = groups[(c-1) * sz + r];
-                } else {
-                    groups[c * sz + r] = lastIdx;
-                    lastIdx += 1;
-                }
-            } else if (r > 0 && c == 0) {
-                if (curBoard->board[c * sz + r].field_type == curBoard->board[c * sz + (r-1)].field_type) {
-                    groups[c * sz + r] = groups[c * sz + (r-1)];
-                } else {
-                    groups[c * sz + r] = lastIdx;
-                    lastIdx += 1;
-                }
-            } else {
-                if (curBoard->board[c * sz + r].field_type != curBoard->board[c * sz + (r-1)].field_type 
-                    && curBoard->board[c * sz + r].field_type != curBoard->board[(c-1) * sz + r].field_type) {
-                    groups[c * sz + r] = lastIdx;
-                    lastIdx += 1;
-                } else if (curBoard->board[c * sz + r].field_type == curBoard->board[c * sz + (r-1)].field_type 
-                           && curBoard->board[c * sz + r].field_type != curBoard->board[(c-1) * sz + r].field_type) {
-                    groups[c * sz + r] = groups[c * sz + (r-1)];
-                } else if (curBoard->board[c * sz + r].field_type != curBoard->board[c * sz + (r-1)].field_type 
-                           && curBoard->board[c * sz + r].field_type == curBoard->board[(c-1) * sz + r].field_type) {
-                    groups[c * sz + r] = groups[(c-1) * sz + r];
-                } else if (curBoard->board[c * sz + r].field_type == curBoard->board[c * sz + (r-1)].field_type 
-                           && curBoard->board[c * sz + r].field_type == curBoard->board[(c-1) * sz + r].field_type) {
-                    groups[c * sz + r] = groups[c * sz + (r-1)];
-                    oldIdx = idxs[groups[(c-1) * sz + r]];
-                    for (i=0; i<lastIdx; i++) {
-                        if (idxs[i] == oldIdx)
-                            idxs[i] = idxs[groups[c * sz + r]];
-                    }
-                }
-            }
-        }
-    }
+    FillArea(x, y, display.draw_elemSize, display.draw_elemSize, WHITE);
 
-    // /* print groups and idxs[groups] */
-    // fprintf(stderr, "Idxs: ");
-    // for (i=0; i<lastIdx; i++) {
-        // fprintf(stderr, "I[%d]=%d, ", i, idxs[i]);
-    // }
-    // fprintf(stderr, "\n");
-    // for (r=0; r<sz; r++) {
-        // for (c=0; c<sz; c++) {
-            // fprintf(stderr, "%2d ", groups[c * sz + r]);
-        // }
-        // fprintf(stderr, "    ");
-        // for (c=0; c<sz; c++) {
-            // fprintf(stderr, "%2d ", idxs[groups[c * sz + r]]);
-        // }
-        // fprintf(stderr, "\n");
-    // }
-
-    /* create consistent numbers in groups */
-    for (r=0; r<sz; r++) {
-        for (c=0; c<sz; c++) {
-            groups[c * sz + r] = idxs[groups[c * sz + r]];
-        }
-    }
+    SetFont(display.draw_font, BLACK);
+    switch (field->field_type) {
+        case FIELD_EMPTY:
+            DrawString(x, y, gridTypeString[field->grid_type]);
+            break;
 
-    /* get neighbor groups for current stone */
-    i = 0;
-    if ((cur_r - 1) >= 0 && groups[cur_c * sz + (cur_r - 1)] >= 0) {
-        neighbors[i] = groups[cur_c * sz + (cur_r - 1)];
-        neighborsLibs[i] = 0;
-        i += 1;
-    }
-    if ((cur_r + 1) < sz && groups[cur_c * sz + (cur_r + 1)] >= 0) {
-        bFoundElem = 0;
-        for (j=0; j<i; j++) {
-            if (neighbors[j] == groups[cur_c * sz + (cur_r + 1)])
-                bFoundElem = 1;
-        }
-        if (!bFoundElem) {
-            neighbors[i] = groups[cur_c * sz + (cur_r + 1)];
-            neighborsLibs[i] = 0;
-            i += 1;
-        }
-    }
-    if ((cur_c - 1) >= 0 && groups[(cur_c - 1) * sz + cur_r] >= 0) {
-        bFoundElem = 0;
-        for (j=0; j<i; j++) {
-            if (neighbors[j] == groups[(cur_c - 1) * sz + cur_r])
-                bFoundElem = 1;
-        }
-        if (!bFoundElem) {
-            neighbors[i] = groups[(cur_c - 1) * sz + cur_r];
-            neighborsLibs[i] = 0;
-            i += 1;
-        }
-    }
-    if ((cur_c + 1) < sz && groups[(cur_c + 1) * sz + cur_r] >= 0) {
-        bFoundElem = 0;
-        for (j=0; j<i; j++) {
-            if (neighbors[j] == groups[(cur_c + 1) * sz + cur_r])
-                bFoundElem = 1;
-        }
-        if (!bFoundElem) {
-            neighbors[i] = groups[(cur_c + 1) * sz + cur_r];
-            neighborsLibs[i] = 0;
-            i += 1;
-        }
+        case FIELD_BLACK:
+        case FIELD_WHITE:
+            DrawString(x, y, fieldTypeString[field->field_type]);
+            break;
     }
-    neighbors[i] = -1; /* terminal indicator */
 
-    /* determine number of liberties for each neighbor group */
-    for (r=0; r<sz; r++) {
-        for (c=0; c<sz; c++) {
-            if (groups[c * sz + r] < 0)
-                continue;
+    switch (field->marker_type) {
+        case MARKER_KO:
+            DrawString(x, y, markerTypeString[field->marker_type]);
+            break;
 
-            for (i=0; neighbors[i] >= 0; i++) {
-                if (groups[c * sz + r] != neighbors[i])
-                    continue;
-
-                if ((r-1) >= 0 && groups[c * sz + (r-1)] == -1)
-                    neighborsLibs[i] += 1;
-                if ((r+1) < sz && groups[c * sz + (r+1)] == -1)
-                    neighborsLibs[i] += 1;
-                if ((c-1) >= 0 && groups[(c-1) * sz + r] == -1)
-                    neighborsLibs[i] += 1;
-                if ((c+1) < sz && groups[(c+1) * sz + r] == -1)
-                    neighborsLibs[i] += 1;
-            }
-        }
+        case MARKER_SQUARE:
+        case MARKER_TRIANGLE:
+        case MARKER_CIRC:
+            if (field->field_type == FIELD_BLACK)
+                SetFont(display.draw_font, WHITE);
+            DrawString(x, y, markerTypeString[field->marker_type]);
+            break;
     }
 
-    /* remove groups with no liberties */
-    for (i=0; neighbors[i] >= 0; i++) {
-        if (neighborsLibs[i] > 0)
-            continue;
-
-        for (r=0; r<sz; r++) {
-            for (c=0; c<sz; c++) {
-                if (groups[c * sz + r] == neighbors[i]) {
-                    if (history_curNode->stones_removed) {
-                        list_newElem(history_curNode->stones_removed, r, c, curBoard->board[c * sz + r].field_type);
-                    } else {
-                        history_curNode->stones_removed = list_newElem(history_curNode->stones_removed, r, c, curBoard->board[c * sz + r].field_type);
-                    }
-
-                    /* notice removal in numbers of captured stones */
-                    switch (curBoard->board[c * sz + r].field_type) {
-                        case FIELD_BLACK:
-                            curBoard->num_caps_b += 1;
-                            break;
-                        case FIELD_WHITE:
-                            curBoard->num_caps_w += 1;
-                            break;
-                    }
-
-                    curBoard->board[c * sz + r].field_type = FIELD_EMPTY;
-                    curBoard->board[c * sz + r].draw_update = 1;
-                }
-            }
-        }
+    /* mark current move on the board */
+    if (bCurrent) {
+        SetFont(display.draw_font, 
+                (field->field_type == FIELD_BLACK) ? WHITE : BLACK);
+        DrawString(x, y, markerTypeString[MARKER_CIRC]);
     }
 
-    // /* print groups */
-    // for (r=0; r<sz; r++) {
-        // for (c=0; c<sz; c++) {
-            // fprintf(stderr, "%2d ", groups[c * sz + r]);
-        // }
-        // fprintf(stderr, "\n");
-    // }
-    // /* print neighbor groups and number of libs */
-    // fprintf(stderr, "Neighbor groups (+ num libs) of current stone [%d,%d]: ", cur_r, cur_c);
-    // for (i=0; neighbors[i] >= 0; i++)
-        // fprintf(stderr, "%d (%d), ", neighbors[i], neighborsLibs[i]);
-    // fprintf(stderr, "\n");
-
-
-    free(idxs);
-    free(groups);
-
+    tileCache.tiles[key] = BitmapFromScreen(x, y, display.draw_elemSize, display.draw_elemSize);
 }/*}}}*/
 
-void board_cleanup()
+void tiles_reset(int elemSize)
 {/*{{{*/
-    if (curBoard != NULL) {
-        free(curBoard->board);
-        curBoard->board = NULL;
-
-        CloseFont(curBoard->draw_font);
+    int i;
 
-        free(curBoard);
-        curBoard = NULL;
-
-        /* free history */
-        if (history_curNode != NULL) {
-            hist_free(history_curNode);
-            history_curNode = NULL;
-        }
+    for (i=0; i<NUM_TILES; i++) {
+        free(tileCache.tiles[i]);
+        tileCache.tiles[i] = NULL;
     }
+    tileCache.elemSize = elemSize;
 }/*}}}*/
 
-void hist_free(HistoryElem *curNode)
+int dirty_cluster(DirtyRect *rects)
 {/*{{{*/
-    HistoryElem *prevNode;
-
-    while (curNode) {
-        prevNode = curNode->prev;
-
-        list_free(curNode->stones_placed);
-        list_free(curNode->stones_removed);
-        list_free(curNode->marker_set);
-        free(curNode);
-
-        curNode = prevNode;
+    DirtyRect merged;
+    int i, j, k, n, best_i, best_j, gain, best_gain;
+
+    /* too many fields (e.g. after a jump): one bounding box */
+    n = curBoard->num_dirty <= MAX_DIRTY_RECTS ? curBoard->num_dirty : 1;
+    for (i=0; i<n; i++) {
+        rects[i].r_min = rects[i].r_max = curBoard->dirty[i] % curBoard->size;
+        rects[i].c_min = rects[i].c_max = curBoard->dirty[i] / curBoard->size;
     }
-}/*}}}*/
-
-void list_free(ListElem *curNode)
-{/*{{{*/
-    ListElem *nextNode;
-
-    while (curNode) {
-        nextNode = curNode->next;
-        free(curNode);
-        curNode = nextNode;
-    }
-}/*}}}*/
-
-void board_print()
-{/*{{{*/
-    int r, c;
-
-    assert( curBoard != NULL );
-
-    for (r=0; r<curBoard->size; r++) {
-        for (c=0; c<curBoard->size; c++) {
-            fprintf(stderr, "%d ", curBoard->board[c * curBoard->size + r].grid_type);
-        }
-        fprintf(stderr, "\n");
+    for (i=n; i<curBoard->num_dirty; i++) {
+        k = curBoard->dirty[i];
+        if (rects[0].r_min > k % curBoard->size) rects[0].r_min = k % curBoard->size;
+        if (rects[0].r_max < k % curBoard->size) rects[0].r_max = k % curBoard->size;
+        if (rects[0].c_min > k / curBoard->size) rects[0].c_min = k / curBoard->size;
+        if (rects[0].c_max < k / curBoard->size) rects[0].c_max = k / curBoard->size;
     }
-}/*}}}*/
-
-void board_draw_update(int bPartialUpdate)
-{/*{{{*/
-    int r, c, i, x, y;
-    int r_min, r_max, c_min, c_max;
-
-    assert( curBoard != NULL );
-
-    /* init min and max values with unreachable numbers */
-    r_min = curBoard->size;
-    r_max = -1;
-    c_min = curBoard->size;
-    c_max = -1;
-
-    SetFont(curBoard->draw_font, BLACK);
-
-    for (r=0; r<curBoard->size; r++) {
-        for (c=0; c<curBoard->size; c++) {
-            i = c * curBoard->size + r;
-            x = curBoard->draw_offset_x + c * curBoard->draw_elemSize;
-            y = curBoard->draw_offset_y + r * curBoard->draw_elemSize;
-
-            /* check if update necessary */
-            if (!bPartialUpdate || curBoard->board[i].draw_update) {
-
-                if (r_min > r) r_min = r;
-                if (r_max < r) r_max = r;
-                if (c_min > c) c_min = c;
-                if (c_max < c) c_max = c;
-
-                if (bPartialUpdate)
-                    FillArea(x, y, curBoard->draw_elemSize, curBoard->draw_elemSize, WHITE);
-
-                SetFont(curBoard->draw_font, BLACK);
-                switch (curBoard->board[i].field_type) {
-                    case FIELD_EMPTY:
-                        DrawString(x, y, gridTypeString[curBoard->board[i].grid_type]);
-                        break;
-
-                    case FIELD_BLACK:
-                    case FIELD_WHITE:
-                        DrawString(x, y, fieldTypeString[curBoard->board[i].field_type]);
-                        break;
-                }
-
-                switch (curBoard->board[i].marker_type) {
-                    case MARKER_KO:
-                        DrawString(x, y, markerTypeString[curBoard->board[i].marker_type]);
-                        break;
-
-                    case MARKER_SQUARE:
-                    case MARKER_TRIANGLE:
-                    case MARKER_CIRC:
-                        if (curBoard->board[i].field_type == FIELD_BLACK)
-                            SetFont(curBoard->draw_font, WHITE);
-                        DrawString(x, y, markerTypeString[curBoard->board[i].marker_type]);
-                        // SetFont(curBoard->draw_font, BLACK);
-                        break;
-                }
 
-                /* mark current move on the board */
-                if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0 
-                    && curBoard->cur_move_r == r && curBoard->cur_move_c == c) {
-                    SetFont(curBoard->draw_font, 
-                            (curBoard->board[i].field_type == FIELD_BLACK) ? WHITE : BLACK);
-                    DrawString(x, y, markerTypeString[MARKER_CIRC]);
+    /* Greedy: merge the pair whose bounding box is cheapest compared to two
+     * separate refreshes, as long as merging does not cost more. Rectangles
+     * overlapped by a merged one are absorbed, so all of them stay
+     * disjoint. */
+    for (;;) {
+        best_gain = -1;
+        best_i = best_j = -1;
+        for (i=0; i<n; i++) {
+            for (j=i+1; j<n; j++) {
+                rect_merge(&merged, &rects[i], &rects[j]);
+                gain = rect_cost(&rects[i]) + rect_cost(&rects[j]) - rect_cost(&merged);
+                if (gain > best_gain) {
+                    best_gain = gain;
+                    best_i = i;
+                    best_j = j;
                 }
-
-                // if (bPartialUpdate)
-                    // PartialUpdate(x, y, curBoard->draw_elemSize, curBoard->draw_elemSize);
-
-                curBoard->board[i].draw_update = 0;
             }
         }
+        if (best_i < 0)
+            break;
 
-    }
-    /*
-    if (bPartialUpdate)
-        PartialUpdate(0, curBoard->draw_offset_y, curBoard->draw_elemSize * curBoard->size, curBoard->draw_elemSize * curBoard->size);
-    */
-
-    if (bPartialUpdate && r_min < curBoard->size) { /* ... && any element updated? */
-        // fprintf(stderr, "r_min = %d, r_max = %d, c_min = %d, c_max = %d\n", r_min, r_max, c_min, c_max);
-        x = curBoard->draw_offset_x + c_min * curBoard->draw_elemSize;
-        y = curBoard->draw_offset_y + r_min * curBoard->draw_elemSize;
-        PartialUpdateBW(x, y, curBoard->draw_elemSize * (c_max - c_min + 1), curBoard->draw_elemSize * (r_max - r_min + 1));
+        rect_merge(&rects[best_i], &rects[best_i], &rects[best_j]);
+        rects[best_j] = rects[--n];
+
+        /* keep rectangles disjoint */
+        for (k=0; k<n; k++) {
+            if (k == best_i || !rect_overlaps(&rects[k], &rects[best_i]))
+                continue;
+            rect_merge(&rects[best_i], &rects[best_i], &rects[k]);
+            rects[k] = rects[--n];
+            if (best_i == n)
+                best_i = k;
+            k = -1;     /* check all again with the grown rectangle */
+        }
     }
 
+    return n;
 }/*}}}*/
 
-void board_get_captured(int *black, int *white)
+int rect_cost(const DirtyRect *a)
 {/*{{{*/
-    assert(black);
-    assert(white);
+    return REFRESH_COST_FIXED + (a->r_max - a->r_min + 1) * (a->c_max - a->c_min + 1);
+}/*}}}*/
 
-    *black = curBoard->num_caps_w;
-    *white = curBoard->num_caps_b;
+void rect_merge(DirtyRect *dst, const DirtyRect *a, const DirtyRect *b)
+{/*{{{*/
+    dst->r_min = a->r_min < b->r_min ? a->r_min : b->r_min;
+    dst->c_min = a->c_min < b->c_min ? a->c_min : b->c_min;
+    dst->r_max = a->r_max > b->r_max ? a->r_max : b->r_max;
+    dst->c_max = a->c_max > b->c_max ? a->c_max : b->c_max;
 }/*}}}*/
 
+int rect_overlaps(const DirtyRect *a, const DirtyRect *b)
+{/*{{{*/
+    return a->r_min <= b->r_max && b->r_min <= a->r_max
+           && a->c_min <= b->c_max && b->c_min <= a->c_max;
+}/*}}}*/
@@ -8,6 +8,13 @@
 
 typedef enum { BOARD_BLACK, BOARD_WHITE } BoardPlayer;
 typedef enum { MARK_SQUARE, MARK_CIRC, MARK_TRIANGLE } BoardMarker;
+typedef unsigned long long BoardHash;
+typedef enum { SETUP_BLACK, SETUP_WHITE, SETUP_EMPTY } BoardSetupType;
+
+typedef struct {
+    short r, c;
+    short type;             /* BoardSetupType */
+} BoardSetupStone;
 
 #ifdef __cplusplus
 extern "C"
@@ -20,6 +27,16 @@ void board_new(int size, int offset_y);
 /* delete allocated memory and reset board */
 void board_cleanup();
 
+/* release the rendered fields, which are kept across boards, at exit */
+void board_tiles_cleanup();
+
+/* Same without the display, e.g. to replay games off screen. A board of
+ * board_core_new() must not be drawn. These and all functions below
+ * except board_draw_update() are part of the goboard_core library.
+ */
+void board_core_new(int size);
+void board_core_cleanup();
+
 /* print board to console */
 void board_print();
 
@@ -29,11 +46,29 @@ void board_print();
  */
 void board_draw_update(int bPartialUpdate);
 
-/* If bIsMove=1, then this function performs a liberty check and a creates a
- * new history entry. Otherwise, it just updates the current history.
+/* While bFast is set, partial updates use the fast waveform of
+ * DynamicUpdate(), e.g. while scrolling through a game. The next partial
+ * update afterwards refreshes the whole area changed meanwhile cleanly.
+ */
+void board_set_fastRefresh(int bFast);
+
+/* Start a new history entry for the next node of the game tree. Markers of
+ * the previous node are removed. Each entry is reverted by one board_undo().
+ */
+void board_beginNode();
+
+/* If bIsMove=1, then this function performs a liberty check and sets the
+ * current move. The stone is added to the current history entry.
  */
 void board_placeStone(int r, int c, BoardPlayer player, int bIsMove);
 
+/* Setup stones of a node (SGF AB, AW and AE): the fields of stones[0..num-1]
+ * are set in this order, without captures and without changing the current
+ * move. The chains are rebuilt once after all fields, changed fields are
+ * added to the current history entry.
+ */
+void board_setupStones(const BoardSetupStone *stones, int num);
+
 /* set marker to board at position (r,c)
  */
 void board_placeMarker(int r, int c, BoardMarker marker);
@@ -46,6 +81,47 @@ int board_undo();
  */
 void board_get_captured(int *black, int *white);
 
+/* Returns 1 and sets *player if there is a stone at (r,c), otherwise 0.
+ */
+int board_get_stone(int r, int c, BoardPlayer *player);
+
+/* Get the board size, 0 if there is no board.
+ */
+int board_get_size();
+
+/* Board snapshots: stones, markers, captured stones and the current move.
+ * board_snapshot_save() writes board_snapshot_size() bytes to buf. After
+ * board_snapshot_restore(), the history is empty, i.e. board_undo() returns
+ * 0 until new nodes are added. board_snapshot_check() returns 1 if the len
+ * bytes at buf are a snapshot of this board size, e.g. read from disk.
+ */
+int board_snapshot_size();
+void board_snapshot_save(void *buf);
+void board_snapshot_restore(const void *buf);
+int board_snapshot_check(const void *buf, int len);
+
+/* The undo log: board_history_save() writes board_history_size() bytes to
+ * buf. board_history_restore() requires the board of the saved log, e.g.
+ * after board_snapshot_restore() of the same position, and replaces the
+ * history by the log of len bytes. Returns 0 for an inconsistent log, the
+ * history is kept then.
+ */
+int board_history_size();
+void board_history_save(void *buf);
+int board_history_restore(const void *buf, int len);
+
+/* Zobrist hash of the stones on the board, updated with every placement,
+ * capture and undo. Equal positions have equal hashes, independent of the
+ * move order. Markers, captured stones and the player to move are not
+ * included.
+ */
+BoardHash board_hash();
+
+/* Hash value of a single stone at (r,c), the board hash is the XOR of the
+ * values of all stones. Does not depend on the current board.
+ */
+BoardHash board_hash_stone(int r, int c, BoardPlayer player);
+
 /******************************************************************************/
 
 #ifdef __cplusplus
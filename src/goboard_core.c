@@ -0,0 +1,913 @@
+/* Implementation of the Go board rules: placing stones, captures, undo,
+ * snapshots and the position hash. Nothing is drawn here, changed fields
+ * are only listed for the display (see goboard.c).
+ *
+ * Author: Christoph Hermes (hermes@hausmilbe.net)
+ */
+
+#include "goboard_core.h"
+#include "perf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/******************************************************************************/
+
+enum BOOL { FALSE, TRUE };
+
+typedef enum {
+    HIST_PLACED,            /* stone placed, data is the previous FieldType */
+    HIST_REMOVED,           /* stone captured, data is its FieldType */
+    HIST_MARKER             /* marker set, data is the MarkerType */
+} HistoryRecType;
+
+typedef struct {
+    unsigned char type;     /* HistoryRecType */
+    unsigned char data;
+    short pos;              /* board index: col * size + row */
+} HistoryRec;
+
+typedef struct {
+    int rec_begin;          /* first record of this step */
+    short cur_move_r;       /* current move after this step */
+    short cur_move_c;
+} HistoryStep;
+
+typedef struct {
+    HistoryRec *recs;       /* records of all steps, one after another */
+    int num_recs;
+    int max_recs;
+    HistoryStep *steps;     /* steps[0] is the initial position */
+    int num_steps;
+    int max_steps;
+} History;
+
+typedef struct {
+    int num_caps_b;         /* captured stones, black and white */
+    int num_caps_w;
+    short cur_move_r;       /* current move */
+    short cur_move_c;
+} BoardSnapshotHeader;      /* followed by one byte per field: FieldType | MarkerType << 2 */
+
+/******************************************************************************/
+
+GoBoard *curBoard = NULL;
+
+/* The undo log keeps its memory across moves and games. */
+static History history = { NULL, 0, 0, NULL, 0, 0 };
+
+/******************************************************************************/
+
+void clearDeadGroups(int cur_r, int cur_c);
+int chain_neighbors(int i, int *nb);
+void chain_addStone(int i);
+void chain_removeChain(int head);
+void chain_rebuild(int i);
+void chain_refreshAround(int i);
+void hist_reset(int cur_move_r, int cur_move_c);
+void hist_newStep();
+void hist_addRec(int type, int pos, int data);
+void hash_toggle(int i, int field);
+void field_setDirty(int i);
+
+/******************************************************************************/
+
+void board_core_new(int size)
+{/*{{{*/
+    int r, c, i, hoshi;
+
+    if (curBoard != NULL)
+        board_core_cleanup();
+
+    /* allocate memory */
+    curBoard = (GoBoard*) malloc( sizeof(GoBoard) );
+    curBoard->size = size;
+    curBoard->board = (GoBoardElement *) malloc( sizeof(GoBoardElement) * size * size );
+
+    /* init board grid and fields */
+    for (r=0; r<size; r++) {
+        for (c=0; c<size; c++) {
+            i = c * size + r;
+
+            /* empty field */
+            curBoard->board[i].field_type = FIELD_EMPTY;
+            /* empty marker */
+            curBoard->board[i].marker_type = MARKER_EMPTY;
+            /* update field when drawing */
+            curBoard->board[i].draw_update = TRUE;
+
+            /* common grid point */
+            curBoard->board[i].grid_type = GRID_C;
+
+            /* curBoard borders */
+            if (r == 0)      curBoard->board[i].grid_type = GRID_T;
+            if (r == size-1) curBoard->board[i].grid_type = GRID_B;
+            if (c == 0)      curBoard->board[i].grid_type = GRID_L;
+            if (c == size-1) curBoard->board[i].grid_type = GRID_R;
+
+            /* corners */
+            if (r == 0 && c == 0)           curBoard->board[i].grid_type = GRID_TL;
+            if (r == 0 && c == size-1)      curBoard->board[i].grid_type = GRID_TR;
+            if (r == size-1 && c == 0)      curBoard->board[i].grid_type = GRID_BL;
+            if (r == size-1 && c == size-1) curBoard->board[i].grid_type = GRID_BR;
+
+        }
+    }
+    /* star points (hoshi) */
+    if (size % 2 == 1) {
+        curBoard->board[(int)(size/2) * size + (int)(size/2)].grid_type = GRID_CP;
+    }
+    if (size < 9)  hoshi = -1;
+    if (size == 9) hoshi = 2;
+    if (size > 9)  hoshi = 3;
+    if (hoshi > 0) {
+        curBoard->board[hoshi * size + hoshi].grid_type = GRID_CP;
+        if (size % 2 == 1)
+            curBoard->board[hoshi * size + (int)(size/2)].grid_type = GRID_CP;
+        curBoard->board[hoshi * size + (size - hoshi - 1)].grid_type = GRID_CP;
+        if (size % 2 == 1) {
+            curBoard->board[(int)(size/2) * size + hoshi].grid_type = GRID_CP;
+            curBoard->board[(int)(size/2) * size + (size - hoshi - 1)].grid_type = GRID_CP;
+        }
+        curBoard->board[(size - hoshi - 1) * size + hoshi].grid_type = GRID_CP;
+        if (size % 2 == 1)
+            curBoard->board[(size - hoshi - 1) * size + (int)(size/2)].grid_type = GRID_CP;
+        curBoard->board[(size - hoshi - 1) * size + (size - hoshi - 1)].grid_type = GRID_CP;
+    }
+
+    /* init captured stones */
+    curBoard->num_caps_b = 0;
+    curBoard->num_caps_w = 0;
+
+    /* init current move */
+    curBoard->cur_move_r = -1;
+    curBoard->cur_move_c = -1;
+
+    /* init chains, all fields are empty */
+    curBoard->chain_head = (short *) malloc( sizeof(short) * size * size );
+    curBoard->chain_next = (short *) malloc( sizeof(short) * size * size );
+    curBoard->chain_size = (short *) malloc( sizeof(short) * size * size );
+    curBoard->chain_libs = (short *) malloc( sizeof(short) * size * size );
+    curBoard->chain_stack = (short *) malloc( sizeof(short) * size * size );
+    curBoard->chain_mark = (int *) malloc( sizeof(int) * size * size );
+    for (i=0; i<size*size; i++) {
+        curBoard->chain_head[i] = -1;
+        curBoard->chain_next[i] = i;
+        curBoard->chain_size[i] = 0;
+        curBoard->chain_libs[i] = 0;
+        curBoard->chain_mark[i] = 0;
+    }
+    curBoard->chain_stamp = 0;
+
+    /* all fields are drawn first */
+    curBoard->dirty = (short *) malloc( sizeof(short) * size * size );
+    for (i=0; i<size*size; i++)
+        curBoard->dirty[i] = i;
+    curBoard->num_dirty = size * size;
+
+    /* init hash keys, the board is empty */
+    curBoard->hash_keys = (BoardHash *) malloc( sizeof(BoardHash) * 2 * size * size );
+    for (r=0; r<size; r++) {
+        for (c=0; c<size; c++) {
+            curBoard->hash_keys[c * size + r] = board_hash_stone(r, c, BOARD_BLACK);
+            curBoard->hash_keys[size * size + c * size + r] = board_hash_stone(r, c, BOARD_WHITE);
+        }
+    }
+    curBoard->hash = 0;
+
+    /* init history */
+    hist_reset(-1, -1);
+
+}/*}}}*/
+
+
+void board_core_cleanup()
+{/*{{{*/
+    if (curBoard != NULL) {
+        free(curBoard->board);
+        curBoard->board = NULL;
+
+        free(curBoard->chain_head);
+        free(curBoard->chain_next);
+        free(curBoard->chain_size);
+        free(curBoard->chain_libs);
+        free(curBoard->chain_stack);
+        free(curBoard->chain_mark);
+        free(curBoard->hash_keys);
+        free(curBoard->dirty);
+
+        free(curBoard);
+        curBoard = NULL;
+
+        /* keep the history memory for the next board */
+        history.num_recs = 0;
+        history.num_steps = 0;
+    }
+}/*}}}*/
+
+void hist_reset(int cur_move_r, int cur_move_c)
+{/*{{{*/
+    if (history.steps == NULL) {
+        history.max_steps = 256;
+        history.steps = (HistoryStep *) malloc(sizeof(HistoryStep) * history.max_steps);
+        history.max_recs = 1024;
+        history.recs = (HistoryRec *) malloc(sizeof(HistoryRec) * history.max_recs);
+        assert( history.steps != NULL && history.recs != NULL );
+    }
+
+    history.num_recs = 0;
+    history.num_steps = 1;
+    history.steps[0].rec_begin = 0;
+    history.steps[0].cur_move_r = cur_move_r;
+    history.steps[0].cur_move_c = cur_move_c;
+}/*}}}*/
+
+void hist_newStep()
+{/*{{{*/
+    HistoryStep *step;
+
+    if (history.num_steps == history.max_steps) {
+        history.max_steps *= 2;
+        history.steps = (HistoryStep *) realloc(history.steps, sizeof(HistoryStep) * history.max_steps);
+        assert( history.steps != NULL );
+    }
+
+    /* the current move is kept until a new one is placed */
+    step = &history.steps[history.num_steps];
+    step->rec_begin = history.num_recs;
+    step->cur_move_r = step[-1].cur_move_r;
+    step->cur_move_c = step[-1].cur_move_c;
+    history.num_steps += 1;
+}/*}}}*/
+
+void hist_addRec(int type, int pos, int data)
+{/*{{{*/
+    HistoryRec *rec;
+
+    if (history.num_recs == history.max_recs) {
+        history.max_recs *= 2;
+        history.recs = (HistoryRec *) realloc(history.recs, sizeof(HistoryRec) * history.max_recs);
+        assert( history.recs != NULL );
+    }
+
+    rec = &history.recs[history.num_recs++];
+    rec->type = type;
+    rec->data = data;
+    rec->pos = pos;
+}/*}}}*/
+
+void board_placeStone(int r, int c, BoardPlayer player, int bIsMove)
+{/*{{{*/
+    int oldField, wasEmpty;
+
+    assert( curBoard != NULL );
+    assert( r >= 0 );
+    assert( c >= 0 );
+    assert( r < curBoard->size );
+    assert( c < curBoard->size );
+
+    oldField = curBoard->board[c * curBoard->size + r].field_type;
+    wasEmpty = oldField == FIELD_EMPTY;
+
+    switch (player) {
+        case BOARD_BLACK:
+            curBoard->board[c * curBoard->size + r].field_type = FIELD_BLACK;
+            break;
+
+        case BOARD_WHITE:
+            curBoard->board[c * curBoard->size + r].field_type = FIELD_WHITE;
+            break;
+    }
+    field_setDirty(c * curBoard->size + r);
+
+    /* update hash */
+    hash_toggle(c * curBoard->size + r, oldField);
+    hash_toggle(c * curBoard->size + r, curBoard->board[c * curBoard->size + r].field_type);
+
+    /* update chains: a stone on an empty field just joins its neighbors,
+     * replacing a stone requires rebuilding the surrounding chains */
+    if (wasEmpty) {
+        chain_addStone(c * curBoard->size + r);
+    } else {
+        curBoard->chain_stamp += 1;
+        chain_refreshAround(c * curBoard->size + r);
+    }
+
+    /* update current move */
+    if (bIsMove) {
+        /* update old cur_move coordinates */
+        if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
+            field_setDirty(curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r);
+            
+        curBoard->cur_move_r = r;
+        curBoard->cur_move_c = c;
+        /* field already marked for drawing */
+
+        history.steps[history.num_steps-1].cur_move_r = r;
+        history.steps[history.num_steps-1].cur_move_c = c;
+    }
+
+    /* update history */
+    hist_addRec(HIST_PLACED, c * curBoard->size + r, oldField);
+
+    /* remove stones if necessary */
+    if (bIsMove)
+        PERF_TIME(PERF_CAPTURE, clearDeadGroups(r, c));
+
+}/*}}}*/
+
+void board_setupStones(const BoardSetupStone *stones, int num)
+{/*{{{*/
+    int k, i, field, rec_begin;
+
+    assert( curBoard != NULL );
+
+    /* set all fields first, each change is one record */
+    rec_begin = history.num_recs;
+    for (k=0; k<num; k++) {
+        assert( stones[k].r >= 0 && stones[k].r < curBoard->size );
+        assert( stones[k].c >= 0 && stones[k].c < curBoard->size );
+
+        i = stones[k].c * curBoard->size + stones[k].r;
+        switch (stones[k].type) {
+            case SETUP_BLACK: field = FIELD_BLACK; break;
+            case SETUP_WHITE: field = FIELD_WHITE; break;
+            default:          field = FIELD_EMPTY; break;
+        }
+        if (curBoard->board[i].field_type == field)
+            continue;
+
+        hash_toggle(i, curBoard->board[i].field_type);
+        hash_toggle(i, field);
+        hist_addRec(HIST_PLACED, i, curBoard->board[i].field_type);
+        curBoard->board[i].field_type = field;
+        field_setDirty(i);
+    }
+
+    /* then rebuild the chains around the changed fields, each once */
+    curBoard->chain_stamp += 1;
+    for (k=rec_begin; k<history.num_recs; k++)
+        chain_refreshAround(history.recs[k].pos);
+}/*}}}*/
+
+void board_beginNode()
+{/*{{{*/
+    HistoryStep *step;
+    int i;
+
+    assert( curBoard != NULL );
+
+    hist_newStep();
+
+    /* new node, cleanup previous marker data */
+    step = &history.steps[history.num_steps-2];
+    for (i=step->rec_begin; i<step[1].rec_begin; i++) {
+        if (history.recs[i].type == HIST_MARKER) {
+            curBoard->board[history.recs[i].pos].marker_type = MARKER_EMPTY;
+            field_setDirty(history.recs[i].pos);
+        }
+    }
+}/*}}}*/
+
+void board_placeMarker(int r, int c, BoardMarker marker)
+{/*{{{*/
+    assert( curBoard != NULL );
+    assert( r >= 0 );
+    assert( c >= 0 );
+    assert( r < curBoard->size );
+    assert( c < curBoard->size );
+
+    switch (marker) {
+        case MARK_SQUARE:
+            curBoard->board[c * curBoard->size + r].marker_type = MARKER_SQUARE;
+            break;
+
+        case MARK_CIRC:
+            curBoard->board[c * curBoard->size + r].marker_type = MARKER_CIRC;
+            break;
+
+        case MARK_TRIANGLE:
+            curBoard->board[c * curBoard->size + r].marker_type = MARKER_TRIANGLE;
+            break;
+    }
+    field_setDirty(c * curBoard->size + r);
+
+    /* update history */
+    hist_addRec(HIST_MARKER, c * curBoard->size + r, curBoard->board[c * curBoard->size + r].marker_type);
+}/*}}}*/
+
+int board_undo()
+{/*{{{*/
+    HistoryRec *rec, *begin, *end;
+    HistoryStep *step;
+    GoBoardElement *field;
+
+    assert( curBoard != NULL );
+
+    /* check if undo is possible */
+    if (history.num_steps <= 1)
+        return 0;
+
+    history.num_steps -= 1;
+    step = &history.steps[history.num_steps];
+    begin = history.recs + step->rec_begin;
+    end = history.recs + history.num_recs;
+    history.num_recs = step->rec_begin;
+
+    /* undo stone placement, removal and markers in reverse order */
+    curBoard->chain_stamp += 1;
+    for (rec=end-1; rec>=begin; rec--) {
+        field = &curBoard->board[rec->pos];
+        switch (rec->type) {
+            case HIST_PLACED:
+                hash_toggle(rec->pos, field->field_type);
+                hash_toggle(rec->pos, rec->data);
+                field->field_type = rec->data;
+                break;
+            case HIST_REMOVED:
+                hash_toggle(rec->pos, rec->data);
+                field->field_type = rec->data;
+                /* notice undo removal in number of captured stones */
+                if (rec->data == FIELD_BLACK)
+                    curBoard->num_caps_b -= 1;
+                else if (rec->data == FIELD_WHITE)
+                    curBoard->num_caps_w -= 1;
+                break;
+            case HIST_MARKER:
+                field->marker_type = MARKER_EMPTY;
+                break;
+        }
+        field_setDirty(rec->pos);
+    }
+    /* rebuild the chains touched by this move */
+    for (rec=begin; rec<end; rec++) {
+        if (rec->type != HIST_MARKER)
+            chain_refreshAround(rec->pos);
+    }
+    /* restore markers of the previous step */
+    for (rec=history.recs+step[-1].rec_begin; rec<begin; rec++) {
+        if (rec->type == HIST_MARKER) {
+            curBoard->board[rec->pos].marker_type = rec->data;
+            field_setDirty(rec->pos);
+        }
+    }
+    /* undo current move marker */
+    if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
+        field_setDirty(curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r);
+    curBoard->cur_move_r = step[-1].cur_move_r;
+    curBoard->cur_move_c = step[-1].cur_move_c;
+    if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
+        field_setDirty(curBoard->cur_move_c * curBoard->size + curBoard->cur_move_r);
+
+    return 1;
+}/*}}}*/
+
+BoardHash board_hash()
+{/*{{{*/
+    assert( curBoard != NULL );
+
+    return curBoard->hash;
+}/*}}}*/
+
+BoardHash board_hash_stone(int r, int c, BoardPlayer player)
+{/*{{{*/
+    BoardHash z;
+
+    /* fixed pseudo random value of (r,c,player), the splitmix64 finalizer
+     * spreads the few input bits over the whole value */
+    z = ((BoardHash) (player == BOARD_WHITE) << 16 | (BoardHash) r << 8 | (BoardHash) c) + 1;
+    z *= 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}/*}}}*/
+
+void hash_toggle(int i, int field)
+{/*{{{*/
+    /* add or remove a stone of type field at board index i */
+    if (field != FIELD_EMPTY)
+        curBoard->hash ^= curBoard->hash_keys[(field - 1) * curBoard->size * curBoard->size + i];
+}/*}}}*/
+
+int board_snapshot_size()
+{/*{{{*/
+    assert( curBoard != NULL );
+
+    return sizeof(BoardSnapshotHeader) + curBoard->size * curBoard->size;
+}/*}}}*/
+
+void board_snapshot_save(void *buf)
+{/*{{{*/
+    BoardSnapshotHeader *header = (BoardSnapshotHeader *) buf;
+    unsigned char *fields = (unsigned char *) buf + sizeof(BoardSnapshotHeader);
+    int i;
+
+    assert( curBoard != NULL );
+
+    header->num_caps_b = curBoard->num_caps_b;
+    header->num_caps_w = curBoard->num_caps_w;
+    header->cur_move_r = curBoard->cur_move_r;
+    header->cur_move_c = curBoard->cur_move_c;
+
+    for (i=0; i<curBoard->size*curBoard->size; i++)
+        fields[i] = curBoard->board[i].field_type | curBoard->board[i].marker_type << 2;
+}/*}}}*/
+
+void board_snapshot_restore(const void *buf)
+{/*{{{*/
+    const BoardSnapshotHeader *header = (const BoardSnapshotHeader *) buf;
+    const unsigned char *fields = (const unsigned char *) buf + sizeof(BoardSnapshotHeader);
+    int i, sz;
+
+    assert( curBoard != NULL );
+
+    sz = curBoard->size;
+
+    /* reset history, undo is not possible beyond the snapshot */
+    hist_reset(header->cur_move_r, header->cur_move_c);
+
+    /* copy fields, update only the changed ones */
+    for (i=0; i<sz*sz; i++) {
+        if (curBoard->board[i].field_type != (fields[i] & 3)
+            || curBoard->board[i].marker_type != fields[i] >> 2) {
+            hash_toggle(i, curBoard->board[i].field_type);
+            hash_toggle(i, fields[i] & 3);
+            curBoard->board[i].field_type = fields[i] & 3;
+            curBoard->board[i].marker_type = fields[i] >> 2;
+            field_setDirty(i);
+        }
+
+        /* markers of the snapshot are removed with the next node */
+        if (curBoard->board[i].marker_type != MARKER_EMPTY)
+            hist_addRec(HIST_MARKER, i, curBoard->board[i].marker_type);
+    }
+
+    curBoard->num_caps_b = header->num_caps_b;
+    curBoard->num_caps_w = header->num_caps_w;
+
+    if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
+        field_setDirty(curBoard->cur_move_c * sz + curBoard->cur_move_r);
+    curBoard->cur_move_r = header->cur_move_r;
+    curBoard->cur_move_c = header->cur_move_c;
+    if (curBoard->cur_move_r >= 0 && curBoard->cur_move_c >= 0)
+        field_setDirty(curBoard->cur_move_c * sz + curBoard->cur_move_r);
+
+    /* rebuild all chains */
+    curBoard->chain_stamp += 1;
+    for (i=0; i<sz*sz; i++) {
+        if (curBoard->board[i].field_type == FIELD_EMPTY)
+            curBoard->chain_head[i] = -1;
+        else if (curBoard->chain_mark[i] != curBoard->chain_stamp)
+            chain_rebuild(i);
+    }
+}/*}}}*/
+
+int board_history_size()
+{/*{{{*/
+    return 2 * sizeof(int) + history.num_steps * sizeof(HistoryStep)
+           + history.num_recs * sizeof(HistoryRec);
+}/*}}}*/
+
+void board_history_save(void *buf)
+{/*{{{*/
+    int *header = (int *) buf;
+    char *data = (char *) buf + 2 * sizeof(int);
+
+    /* number of steps and records, followed by both arrays */
+    header[0] = history.num_steps;
+    header[1] = history.num_recs;
+    memcpy(data, history.steps, history.num_steps * sizeof(HistoryStep));
+    memcpy(data + history.num_steps * sizeof(HistoryStep), history.recs,
+           history.num_recs * sizeof(HistoryRec));
+}/*}}}*/
+
+int board_snapshot_check(const void *buf, int len)
+{/*{{{*/
+    const BoardSnapshotHeader *header = (const BoardSnapshotHeader *) buf;
+    const unsigned char *fields = (const unsigned char *) buf + sizeof(BoardSnapshotHeader);
+    int i, sz;
+
+    assert( curBoard != NULL );
+
+    sz = curBoard->size;
+    if (len != board_snapshot_size() || header->num_caps_b < 0 || header->num_caps_w < 0
+        || header->cur_move_r < -1 || header->cur_move_r >= sz
+        || header->cur_move_c < -1 || header->cur_move_c >= sz)
+        return 0;
+
+    /* field_type has two bits, FIELD_WHITE is the largest value */
+    for (i=0; i<sz*sz; i++) {
+        if ((fields[i] & 3) > FIELD_WHITE || fields[i] >> 2 > MARKER_TRIANGLE)
+            return 0;
+    }
+
+    return 1;
+}/*}}}*/
+
+int board_history_restore(const void *buf, int len)
+{/*{{{*/
+    const int *header = (const int *) buf;
+    const HistoryStep *steps;
+    const HistoryRec *recs;
+    int i, num_steps, num_recs;
+
+    assert( curBoard != NULL );
+
+    if (len < (int) (2 * sizeof(int)))
+        return 0;
+    num_steps = header[0];
+    num_recs = header[1];
+    if (num_steps < 1 || num_recs < 0 || num_steps > len || num_recs > len
+        || len != (int) (2 * sizeof(int) + num_steps * sizeof(HistoryStep) + num_recs * sizeof(HistoryRec)))
+        return 0;
+    steps = (const HistoryStep *) ((const char *) buf + 2 * sizeof(int));
+    recs = (const HistoryRec *) (steps + num_steps);
+
+    /* the log has to fit to this board */
+    if (steps[0].rec_begin != 0 || steps[num_steps-1].cur_move_r != curBoard->cur_move_r
+        || steps[num_steps-1].cur_move_c != curBoard->cur_move_c)
+        return 0;
+    for (i=0; i<num_steps; i++) {
+        if ((i > 0 && (steps[i].rec_begin < steps[i-1].rec_begin || steps[i].rec_begin > num_recs))
+            || steps[i].cur_move_r < -1 || steps[i].cur_move_r >= curBoard->size
+            || steps[i].cur_move_c < -1 || steps[i].cur_move_c >= curBoard->size)
+            return 0;
+    }
+    /* field_type has two bits, FIELD_WHITE is the largest value */
+    for (i=0; i<num_recs; i++) {
+        if (recs[i].pos < 0 || recs[i].pos >= curBoard->size * curBoard->size)
+            return 0;
+        switch (recs[i].type) {
+            case HIST_PLACED:
+                if (recs[i].data > FIELD_WHITE)
+                    return 0;
+                break;
+            case HIST_REMOVED:
+                if (recs[i].data != FIELD_BLACK && recs[i].data != FIELD_WHITE)
+                    return 0;
+                break;
+            case HIST_MARKER:
+                if (recs[i].data > MARKER_TRIANGLE)
+                    return 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    while (history.max_steps < num_steps) {
+        history.max_steps *= 2;
+        history.steps = (HistoryStep *) realloc(history.steps, sizeof(HistoryStep) * history.max_steps);
+        assert( history.steps != NULL );
+    }
+    while (history.max_recs < num_recs) {
+        history.max_recs *= 2;
+        history.recs = (HistoryRec *) realloc(history.recs, sizeof(HistoryRec) * history.max_recs);
+        assert( history.recs != NULL );
+    }
+    memcpy(history.steps, steps, num_steps * sizeof(HistoryStep));
+    memcpy(history.recs, recs, num_recs * sizeof(HistoryRec));
+    history.num_steps = num_steps;
+    history.num_recs = num_recs;
+
+    return 1;
+}/*}}}*/
+
+void clearDeadGroups(int cur_r, int cur_c)
+{/*{{{*/
+    int nb[4];
+    int i, j, n;
+
+    assert( curBoard != NULL );
+
+    i = cur_c * curBoard->size + cur_r;
+    n = chain_neighbors(i, nb);
+
+    /* remove opponent chains without liberties */
+    for (j=0; j<n; j++) {
+        if (curBoard->board[nb[j]].field_type != FIELD_EMPTY
+            && curBoard->board[nb[j]].field_type != curBoard->board[i].field_type
+            && curBoard->chain_libs[curBoard->chain_head[nb[j]]] == 0)
+            chain_removeChain(curBoard->chain_head[nb[j]]);
+    }
+
+    /* suicide: remove own chain if it still has no liberties */
+    if (curBoard->chain_libs[curBoard->chain_head[i]] == 0)
+        chain_removeChain(curBoard->chain_head[i]);
+
+}/*}}}*/
+
+int chain_neighbors(int i, int *nb)
+{/*{{{*/
+    int sz = curBoard->size;
+    int n = 0;
+
+    /* board is stored column-wise: i = c * size + r */
+    if (i % sz > 0)       nb[n++] = i - 1;
+    if (i % sz < sz - 1)  nb[n++] = i + 1;
+    if (i >= sz)          nb[n++] = i - sz;
+    if (i < sz * (sz-1))  nb[n++] = i + sz;
+
+    return n;
+}/*}}}*/
+
+void chain_addStone(int i)
+{/*{{{*/
+    short *head = curBoard->chain_head;
+    short *next = curBoard->chain_next;
+    int nb[4];
+    int j, n, a, b, k, tmp;
+
+    /* new chain with a single stone */
+    head[i] = i;
+    next[i] = i;
+    curBoard->chain_size[i] = 1;
+    curBoard->chain_libs[i] = 0;
+
+    n = chain_neighbors(i, nb);
+    for (j=0; j<n; j++) {
+        if (curBoard->board[nb[j]].field_type == FIELD_EMPTY)
+            curBoard->chain_libs[i] += 1;
+        else
+            curBoard->chain_libs[head[nb[j]]] -= 1;
+    }
+
+    /* merge with neighboring chains of the same color, the smaller chain is
+     * relabeled */
+    for (j=0; j<n; j++) {
+        if (curBoard->board[nb[j]].field_type != curBoard->board[i].field_type)
+            continue;
+        if (head[nb[j]] == head[i])
+            continue;
+
+        a = head[i];
+        b = head[nb[j]];
+        if (curBoard->chain_size[a] < curBoard->chain_size[b]) {
+            tmp = a; a = b; b = tmp;
+        }
+
+        k = b;
+        do {
+            head[k] = a;
+            k = next[k];
+        } while (k != b);
+
+        tmp = next[a];
+        next[a] = next[b];
+        next[b] = tmp;
+        curBoard->chain_size[a] += curBoard->chain_size[b];
+        curBoard->chain_libs[a] += curBoard->chain_libs[b];
+    }
+}/*}}}*/
+
+void chain_removeChain(int head)
+{/*{{{*/
+    int nb[4];
+    int i, j, n;
+
+    /* take stones from the board */
+    i = head;
+    do {
+        hist_addRec(HIST_REMOVED, i, curBoard->board[i].field_type);
+
+        /* notice removal in numbers of captured stones */
+        switch (curBoard->board[i].field_type) {
+            case FIELD_BLACK:
+                curBoard->num_caps_b += 1;
+                break;
+            case FIELD_WHITE:
+                curBoard->num_caps_w += 1;
+                break;
+        }
+
+        hash_toggle(i, curBoard->board[i].field_type);
+        curBoard->board[i].field_type = FIELD_EMPTY;
+        field_setDirty(i);
+        curBoard->chain_head[i] = -1;
+        i = curBoard->chain_next[i];
+    } while (i != head);
+
+    /* the emptied fields are new liberties for the adjacent chains */
+    i = head;
+    do {
+        n = chain_neighbors(i, nb);
+        for (j=0; j<n; j++) {
+            if (curBoard->chain_head[nb[j]] >= 0)
+                curBoard->chain_libs[curBoard->chain_head[nb[j]]] += 1;
+        }
+        i = curBoard->chain_next[i];
+    } while (i != head);
+}/*}}}*/
+
+void chain_rebuild(int i)
+{/*{{{*/
+    short *stack = curBoard->chain_stack;
+    int nb[4];
+    int sp, j, n, k, last;
+    int color = curBoard->board[i].field_type;
+
+    /* flood fill the chain containing stone i */
+    curBoard->chain_mark[i] = curBoard->chain_stamp;
+    curBoard->chain_size[i] = 0;
+    curBoard->chain_libs[i] = 0;
+    last = i;
+    stack[0] = i;
+    sp = 1;
+    while (sp > 0) {
+        k = stack[--sp];
+
+        curBoard->chain_head[k] = i;
+        curBoard->chain_next[last] = k;
+        last = k;
+        curBoard->chain_size[i] += 1;
+
+        n = chain_neighbors(k, nb);
+        for (j=0; j<n; j++) {
+            if (curBoard->board[nb[j]].field_type == FIELD_EMPTY) {
+                curBoard->chain_libs[i] += 1;
+            } else if (curBoard->board[nb[j]].field_type == color
+                       && curBoard->chain_mark[nb[j]] != curBoard->chain_stamp) {
+                curBoard->chain_mark[nb[j]] = curBoard->chain_stamp;
+                stack[sp++] = nb[j];
+            }
+        }
+    }
+    curBoard->chain_next[last] = i;
+}/*}}}*/
+
+void chain_refreshAround(int i)
+{/*{{{*/
+    int nb[4];
+    int j, n;
+
+    /* Rebuild the chain at i and all neighboring chains. Chains which have
+     * been rebuilt since the last change of chain_stamp are skipped. */
+    if (curBoard->board[i].field_type == FIELD_EMPTY)
+        curBoard->chain_head[i] = -1;
+    else if (curBoard->chain_mark[i] != curBoard->chain_stamp)
+        chain_rebuild(i);
+
+    n = chain_neighbors(i, nb);
+    for (j=0; j<n; j++) {
+        if (curBoard->board[nb[j]].field_type != FIELD_EMPTY
+            && curBoard->chain_mark[nb[j]] != curBoard->chain_stamp)
+            chain_rebuild(nb[j]);
+    }
+}/*}}}*/
+
+void board_print()
+{/*{{{*/
+    int r, c;
+
+    assert( curBoard != NULL );
+
+    for (r=0; r<curBoard->size; r++) {
+        for (c=0; c<curBoard->size; c++) {
+            fprintf(stderr, "%d ", curBoard->board[c * curBoard->size + r].grid_type);
+        }
+        fprintf(stderr, "\n");
+    }
+}/*}}}*/
+
+void field_setDirty(int i)
+{/*{{{*/
+    /* each field is listed once */
+    if (curBoard->board[i].draw_update)
+        return;
+    curBoard->board[i].draw_update = 1;
+    curBoard->dirty[curBoard->num_dirty++] = i;
+}/*}}}*/
+
+void board_get_captured(int *black, int *white)
+{/*{{{*/
+    assert(black);
+    assert(white);
+
+    *black = curBoard->num_caps_w;
+    *white = curBoard->num_caps_b;
+}/*}}}*/
+
+int board_get_stone(int r, int c, BoardPlayer *player)
+{/*{{{*/
+    assert( curBoard != NULL );
+    assert( r >= 0 && r < curBoard->size );
+    assert( c >= 0 && c < curBoard->size );
+
+    switch (curBoard->board[c * curBoard->size + r].field_type) {
+        case FIELD_BLACK:
+            *player = BOARD_BLACK;
+            return 1;
+        case FIELD_WHITE:
+            *player = BOARD_WHITE;
+            return 1;
+    }
+
+    return 0;
+}/*}}}*/
+
+int board_get_size()
+{/*{{{*/
+    return curBoard != NULL ? curBoard->size : 0;
+}/*}}}*/
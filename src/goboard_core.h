@@ -0,0 +1,71 @@
+/* Internal data of the Go board, shared by the board rules (goboard_core.c)
+ * and the drawing of the board (goboard.c). The rules do not depend on the
+ * display.
+ *
+ * Author: Christoph Hermes (hermes@hausmilbe.net)
+ */
+
+#ifndef GOBOARD_CORE_H
+#define GOBOARD_CORE_H
+
+#include "goboard.h"
+
+/******************************************************************************/
+
+typedef enum { /* WARNING: when changing the element number, consider the bit
+                * field length in GoBoardElement */
+    GRID_TL, GRID_T, GRID_TR,        /* top left, top, top right          */
+    GRID_L, GRID_R, GRID_C, GRID_CP, /* left, right, center, center point */
+    GRID_BL, GRID_B, GRID_BR         /* bottom left, bottom, bottom right */
+} GridType;
+
+typedef enum { /* WARNING: when changing the element number, consider the bit
+                * field length in GoBoardElement */
+    FIELD_EMPTY,              /* empty field */
+    FIELD_BLACK, FIELD_WHITE  /* black and white stone */
+} FieldType;
+
+typedef enum { /* WARNING: when changing the element number, consider the bit
+                * field length in GoBoardElement */
+    MARKER_EMPTY,                                   /* no marker */
+    MARKER_KO,                                      /* ko marker */
+    MARKER_SQUARE, MARKER_CIRC, MARKER_TRIANGLE     /* shape marker */
+} MarkerType;
+
+typedef struct
+{
+    unsigned grid_type:4;   /* GridType */
+    unsigned field_type:2;  /* FieldType */
+    unsigned marker_type:3; /* MarkerType */
+    unsigned draw_update:1; /* Update this field? */
+} GoBoardElement;
+
+typedef struct
+{
+    int size;               /* size x size */
+    GoBoardElement *board;  /* board[col * size + row] */
+    int num_caps_b;         /* captured stones, black and white */
+    int num_caps_w;
+    int cur_move_r;         /* current move, if val < 0, no current */
+    int cur_move_c;         /* move is set. */
+    short *chain_head;      /* representative stone of each chain, -1 if empty */
+    short *chain_next;      /* next stone of the same chain (circular list) */
+    short *chain_size;      /* number of stones, valid at chain_head */
+    short *chain_libs;      /* pseudo liberties, valid at chain_head */
+    short *chain_stack;     /* flood fill stack */
+    int *chain_mark;        /* visited marker for local chain rebuilds */
+    int chain_stamp;
+    BoardHash hash;         /* Zobrist hash of the stones */
+    BoardHash *hash_keys;   /* hash_keys[(FieldType-1) * size * size + i] */
+    short *dirty;           /* fields with draw_update set */
+    int num_dirty;
+} GoBoard;
+
+/******************************************************************************/
+
+/* current board, NULL if there is none */
+extern GoBoard *curBoard;
+
+/******************************************************************************/
+
+#endif /* GOBOARD_CORE_H */
@@ -6,12 +6,22 @@
 #include "gogame.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <sgftree.h>
 #include <inkview.h>
 
 #include "goboard.h"
+#include "batchreplay.h"
+#include "posindex.h"
+#include "prefetch.h"
+#include "treecache.h"
+#include "collection.h"
+#include "session.h"
+#include "fontcache.h"
+#include "textlayout.h"
+#include "perf.h"
 
 /******************************************************************************/
 
@@ -62,8 +72,63 @@ static DrawProperties drawProps;
 static char *str_unknown = "unknown";
 
 static int bShowFullScreenComment = 0;
+static int fullComment_page = 0; /* page of the full screen comment */
 static int bShowHelpScreen = 0;
 
+static char gameFile[256] = ""; /* file of the game tree */
+static int gameNum = 0; /* game of a collection */
+
+static SGFNode **nodePath = NULL; /* path buffer used by goto_node() */
+static int nodePath_size = 0;
+
+static BoardSetupStone *setupStones = NULL; /* setup buffer of apply_sgf_cmds_to_board() */
+static int setupStones_max = 0;
+
+/* cell of the variation window */
+typedef struct {
+    SGFNode *node;
+    short col, lvl;
+    short parent_lvl; /* lvl of the parent in the previous column, -1: none */
+} VarCell;
+
+/* layout of the variation window as drawn last, it stays valid as long
+ * as the window starts at the same node and no variation is parsed */
+typedef struct {
+    int valid;
+    SGFNode *origin;
+    SGFNode *current; /* highlighted node */
+    char info[256];   /* game info text */
+    VarCell *cells;
+    int num, max;
+} VarLayout;
+
+typedef struct {
+    int x, y, w, h;
+} VarRect;
+
+static VarLayout varLayout = { 0, NULL, NULL, "", NULL, 0, 0 };
+static VarRect varDirty; /* area changed by var_redrawNode() */
+
+/* position of a node in the game tree */
+typedef struct {
+    BoardHash hash;
+    SGFNode *node;
+} NodeHash;
+
+/* positions of all parsed nodes which place stones, sorted by hash, to
+ * find other occurrences of the current position; rebuilt on demand when
+ * a variation is parsed */
+typedef struct {
+    int valid;
+    NodeHash *nodes;
+    int num, max;
+    BitBoard known;     /* stones known to hash, see transpos_visit() */
+    BoardHash hash;
+} Transpositions;
+
+static Transpositions transpos;
+static char transNote[160] = ""; /* other occurrences of the current position */
+
 /******************************************************************************/
 
 #define GET_CHAR_PROP(name__, ref__) \
@@ -72,6 +137,12 @@ static int bShowHelpScreen = 0;
 
 #define ENC_SGFPROP(c1_, c2_) ((short)( c1_ | c2_ << 8 ))
 
+/* maximal distance between two nodes with board snapshots in a variation */
+#define SNAPSHOT_INTERVAL 16
+
+/* delay before a parsed game is written to the tree cache (ms) */
+#define TREECACHE_DELAY 2000
+
 /******************************************************************************/
 
 void readGameInfo();
@@ -79,45 +150,90 @@ void initDrawProperties();
 void test_readSGF();
 void debug_msg(char *s);
 void apply_sgf_cmds_to_board();
+int collect_setup(SGFNode *nd, int size);
 void updateCommentStr();
+void updateTransNote();
+void transpos_build();
+void transpos_visit(void *ctx, const BitBoard *bb, SGFNode *nd);
+int nodehash_cmp(const void *a, const void *b);
+void draw_commentWindow();
+int draw_comment(int x, int y, int w, int h, int page);
+void fullComment_rect(int *x, int *y, int *w, int *h);
+void draw_fullComment();
+void store_snapshot();
+void materialize_variations(SGFNode *ndBegin);
+void materialize_node(SGFNode *nd);
+void var_cellPos(int col, int lvl, int *x, int *y);
+void var_layout(SGFNode *ndBegin);
+void var_drawCell(const VarCell *cell);
+void var_drawEdge(const VarCell *cell);
+int var_redrawNode(SGFNode *nd);
+void rect_add(VarRect *r, int x, int y, int w, int h);
+void push_nodePath(int n, SGFNode *nd);
+void goto_node(SGFNode *target);
+void store_tree_cache();
+int read_game_tree(const char *filename, int game);
 
 /******************************************************************************/
 
 void debug_msg(char *s) 
 {/*{{{*/
-    ifont *times12;
-
-    times12 = OpenFont("DejaVuSerif", 12, 1);
     FillArea(350, 770, 250, 20, WHITE);
-    SetFont(times12, BLACK);
+    SetFont(fontcache_get("DejaVuSerif", 12), BLACK);
     DrawString(350, 770, s);
     PartialUpdateBW(350, 770, 250, 20);
-    CloseFont(times12);
 }/*}}}*/
 
 int gogame_new_from_file(const char *filename)
 {/*{{{*/
+    return gogame_new_from_game(filename, 0);
+}/*}}}*/
+
+int gogame_new_from_game(const char *filename, int game)
+{/*{{{*/
+    int bOk;
+
     gogame_cleanup();
     initDrawProperties();
 
-    gameTree = (SGFTree *) malloc(sizeof(SGFTree));
-    if (gameTree == NULL)
-        return 1;
-    sgftree_clear(gameTree); /* set node pointers to NULL */
-
-    if (!sgftree_readfile(gameTree, filename)) {
-        gogame_cleanup();
-        return 2;
+    /* use the tree parsed in the background or the cached one if
+     * available, both know the first game of a file only */
+    if (game == 0) {
+        gameTree = prefetch_take(filename);
+        if (gameTree == NULL)
+            gameTree = treecache_load(filename);
+    }
+    if (gameTree == NULL) {
+        gameTree = (SGFTree *) malloc(sizeof(SGFTree));
+        if (gameTree == NULL)
+            return 1;
+        sgftree_clear(gameTree); /* set node pointers to NULL */
+
+        PERF_TIME(PERF_READFILE, bOk = read_game_tree(filename, game));
+        if (!bOk) {
+            gogame_cleanup();
+            return 2;
+        }
     }
     curNode = gameTree->root;
+    snprintf(gameFile, sizeof(gameFile), "%s", filename);
+    gameNum = game;
+
+    /* a tree parsed from text is cached when the game is shown */
+    if (gameTree->input != NULL && game == 0)
+        SetWeakTimer("TreeCache", store_tree_cache, TREECACHE_DELAY);
 
     readGameInfo();
 
     board_new(gameInfo.boardSize, drawProps.fontSize * 2 + drawProps.fontSpace * 3);
 
-    apply_sgf_cmds_to_board();
+    PERF_TIME(PERF_APPLY_NODE, apply_sgf_cmds_to_board());
     /* test_readSGF(); */
 
+    /* the root position is always available, goto_node() relies on it */
+    curNode->snapshot = sgfArenaAlloc(&gameTree->arena, board_snapshot_size());
+    board_snapshot_save(curNode->snapshot);
+
     updateCommentStr();
     bShowFullScreenComment = 0;
     bShowHelpScreen = 0;
@@ -125,15 +241,92 @@ int gogame_new_from_file(const char *filename)
     return 0;
 }/*}}}*/
 
+int gogame_new_from_session(const Session *s)
+{/*{{{*/
+    SGFNode *nd;
+    int i, k, ret;
+
+    ret = gogame_new_from_game(s->filename, s->game);
+    if (ret != 0)
+        return ret;
+
+    /* follow the child indices, lazy variations on the way are parsed */
+    nd = gameTree->root;
+    for (k=0; k<s->path_len && nd; k++) {
+        for (nd = nd->child, i = 0; nd && i < s->path[k]; nd = nd->next, i++) {}
+        if (nd)
+            materialize_node(nd);
+    }
+    if (nd == NULL || nd == gameTree->root || !board_snapshot_check(s->snapshot, s->snapshot_len))
+        return 0;
+
+    /* the saved position replaces the replay of the path, undo continues
+     * with the saved log (or from the root snapshot if it does not fit) */
+    board_snapshot_restore(s->snapshot);
+    board_history_restore(s->history, s->history_len);
+    curNode = nd;
+    curNode->snapshot = sgfArenaAlloc(&gameTree->arena, s->snapshot_len);
+    memcpy(curNode->snapshot, s->snapshot, s->snapshot_len);
+
+    updateCommentStr();
+
+    return 0;
+}/*}}}*/
+
+int gogame_save_session()
+{/*{{{*/
+    Session s;
+    SGFNode *nd, *sib;
+    int i, n, bOk;
+
+    if (gameTree == NULL)
+        return 0;
+
+    memset(&s, 0, sizeof(s));
+    snprintf(s.filename, sizeof(s.filename), "%s", gameFile);
+    s.game = gameNum;
+
+    /* child index of each node from the current one up to the root */
+    for (nd = curNode, n = 0; nd->parent; nd = nd->parent)
+        n++;
+    s.path_len = n;
+    s.snapshot_len = board_snapshot_size();
+    s.history_len = board_history_size();
+
+    /* one byte more each like in session_load(), the path is empty at
+     * the root and malloc(0) may return NULL */
+    s.path = (int *) malloc(sizeof(int) * s.path_len + 1);
+    s.snapshot = malloc(s.snapshot_len + 1);
+    s.history = malloc(s.history_len + 1);
+
+    bOk = s.path != NULL && s.snapshot != NULL && s.history != NULL;
+    if (bOk) {
+        for (nd = curNode; nd->parent; nd = nd->parent) {
+            for (sib = nd->parent->child, i = 0; sib != nd; sib = sib->next)
+                i++;
+            s.path[--n] = i;
+        }
+        board_snapshot_save(s.snapshot);
+        board_history_save(s.history);
+        bOk = session_store(&s);
+    }
+    session_free(&s);
+
+    return bOk;
+}/*}}}*/
+
 void gogame_cleanup()
 {/*{{{*/
+    ClearTimer(store_tree_cache);
+
     if (gameTree != NULL) {
-        /* free SGF info */
-        sgfFreeNode(gameTree->root); /* recursively free the sgf tree */
-        sgftree_clear(gameTree);
+        /* free SGF info, the whole tree is released with its arena */
+        sgftree_free(gameTree);
         free(gameTree);
         gameTree = NULL;
         curNode = NULL;
+        varLayout.valid = 0;
+        textlayout_clear(); /* the comments were part of the tree */
 
         /* cleanup other game info */
         gameInfo.black.name = NULL;
@@ -151,14 +344,12 @@ void gogame_cleanup()
 
         /* cleanup draw properties */
         drawProps.fontSize = 12;
-        CloseFont(drawProps.font_ttf);
         drawProps.font_ttf = NULL;
 
         drawProps.varFontSize = 12;
         drawProps.varFontSep = 0;
         drawProps.varwin_h = 0;
         drawProps.varwin_w = 0;
-        CloseFont(drawProps.varWin_ttf);
         drawProps.varWin_ttf = NULL;
 
         bShowFullScreenComment = 0;
@@ -167,13 +358,53 @@ void gogame_cleanup()
         /* cleanup go board */
         board_cleanup();
     }
+
+    free(nodePath);
+    nodePath = NULL;
+    nodePath_size = 0;
+
+    free(setupStones);
+    setupStones = NULL;
+    setupStones_max = 0;
+
+    free(varLayout.cells);
+    varLayout.cells = NULL;
+    varLayout.num = varLayout.max = 0;
+
+    free(transpos.nodes);
+    transpos.nodes = NULL;
+    transpos.num = transpos.max = 0;
+    transpos.valid = 0;
+    transNote[0] = '\0';
+}/*}}}*/
+
+void store_tree_cache()
+{/*{{{*/
+    if (gameTree != NULL)
+        treecache_store(gameTree, gameFile);
+}/*}}}*/
+
+int read_game_tree(const char *filename, int game)
+{/*{{{*/
+    const SGFGameInfo *games;
+    int num;
+
+    if (game == 0)
+        return sgftree_readfile_flags(gameTree, filename, SGF_READ_LAZY);
+
+    /* only the chosen game of a collection is read */
+    num = collection_scan(filename, &games);
+    if (game < 0 || game >= num)
+        return 0;
+    return sgftree_readfile_range(gameTree, filename, games[game].offset,
+                                  games[game].length, SGF_READ_LAZY);
 }/*}}}*/
 
 void initDrawProperties()
 {/*{{{*/
     drawProps.fontSize  = (int) ((double)ScreenWidth() / 600.0 * 14.0);
     drawProps.fontSpace = (int) ((double)ScreenWidth() / 600.0 * 4.0);
-    drawProps.font_ttf = OpenFont("DejaVuSerif", drawProps.fontSize, 1);
+    drawProps.font_ttf = fontcache_get("DejaVuSerif", drawProps.fontSize);
 
     /* variation window */
     drawProps.varwin_w = 4;
@@ -181,7 +412,7 @@ void initDrawProperties()
 
     drawProps.varFontSize  = (int) ((double)ScreenWidth() / 600.0 * 20.0);
     drawProps.varFontSep = drawProps.varFontSize / 4;
-    drawProps.varWin_ttf = OpenFont("drocerog", drawProps.varFontSize, 1);
+    drawProps.varWin_ttf = fontcache_get("drocerog", drawProps.varFontSize);
 
     /* distance to screen border */
     drawProps.border_sep = drawProps.varFontSize;
@@ -202,6 +433,9 @@ void test_readSGF()
 
     /* test: list all properties in the main path, ignoring children */
     for (cur = gameTree->root; cur; cur = cur->child) {
+        if (cur->parent)
+            board_beginNode();
+
         /* list all properties */
         for (prop = cur->props; prop; prop = prop->next) {
             fprintf(stderr, "%c%c[%s] ",
@@ -233,13 +467,178 @@ void test_readSGF()
     }
 }/*}}}*/
 
-void draw_variation(int bPartialUpdate)
+void materialize_variations(SGFNode *ndBegin)
+{/*{{{*/
+    SGFNode *nd, *ndVar;
+    int i, bFound;
+
+    /* parse lazy variations shown in the variation window, this
+     * changes the links of the other nodes, so start again each time */
+    do {
+        bFound = 0;
+        i = 0;
+        for (nd=ndBegin; nd && i < drawProps.varwin_w && !bFound; nd=nd->child, i++) {
+            for (ndVar=nd; ndVar && !bFound; ndVar=ndVar->nextVar) {
+                if (sgfIsLazy(ndVar)) {
+                    materialize_node(ndVar);
+                    bFound = 1;
+                }
+            }
+        }
+    } while (bFound);
+}/*}}}*/
+
+void materialize_node(SGFNode *nd)
+{/*{{{*/
+    /* the levels of the variations change, lay out the window again,
+     * the new nodes add positions */
+    if (sgfIsLazy(nd)) {
+        varLayout.valid = 0;
+        transpos.valid = 0;
+    }
+
+    sgftree_materialize(gameTree, nd);
+}/*}}}*/
+
+void var_cellPos(int col, int lvl, int *x, int *y)
+{/*{{{*/
+    *x = drawProps.comment_width + 2 * drawProps.border_sep + 2 * col * drawProps.varFontSize;
+    *y = ScreenHeight() - drawProps.varFontSize - drawProps.varFontSize * drawProps.varFontSep 
+         + lvl * (drawProps.varFontSize + drawProps.varFontSep);
+}/*}}}*/
+
+void var_layout(SGFNode *ndBegin)
 {/*{{{*/
-    int i, lvl, x, y, x_parent, y_parent;
     SGFNode *nd = NULL;
     SGFNode *ndVar = NULL;
+    VarCell *cell;
+    int i;
+
+    varLayout.num = 0;
+    i = 0;
+    for (nd=ndBegin; nd; nd=nd->child) {
+        for (ndVar=nd; ndVar; ndVar=ndVar->nextVar) {
+            if (ndVar->draw_lvl >= drawProps.varwin_h)
+                continue;
+
+            if (varLayout.num == varLayout.max) {
+                varLayout.max = varLayout.max ? 2 * varLayout.max : 64;
+                varLayout.cells = (VarCell *) realloc(varLayout.cells, sizeof(VarCell) * varLayout.max);
+            }
+            cell = &varLayout.cells[varLayout.num++];
+            cell->node = ndVar;
+            cell->col = i;
+            cell->lvl = ndVar->draw_lvl;
+            cell->parent_lvl = (ndVar->parent && i > 0) ? ndVar->parent->draw_lvl : -1;
+        }
+
+        i += 1;
+        if (i >= drawProps.varwin_w)
+            break;
+    }
+
+    varLayout.origin = ndBegin;
+    varLayout.valid = 1;
+}/*}}}*/
+
+void var_drawCell(const VarCell *cell)
+{/*{{{*/
+    SGFNode *ndVar = cell->node;
+    int x, y;
+
+    var_cellPos(cell->col, cell->lvl, &x, &y);
+
+    if (is_move_node(ndVar)) {
+        /* set current position color */
+        SetFont(drawProps.varWin_ttf, BLACK);
+
+        /* draw stone */
+        if (sgfHasProps(ndVar, SGF_PROP_B)) {
+            DrawString(x, y, "K");
+            SetFont(drawProps.varWin_ttf, WHITE);
+        } else if (sgfHasProps(ndVar, SGF_PROP_W)) {
+            DrawString(x, y, "L");
+            SetFont(drawProps.varWin_ttf, BLACK);
+        }
+
+        /* indicate comment if exists */
+        if (sgfHasProps(ndVar, SGF_PROP_C))
+            DrawString(x, y, "O");
+    } else { /* no move: draw just a placeholder */
+        /* draw triangle */
+        SetFont(drawProps.varWin_ttf, BLACK);
+        DrawString(x, y, "O");
+    }
+
+    /* indicate current position */
+    if (ndVar == curNode) {
+        DrawLine(x, y, x + drawProps.varFontSize, y, BLACK);
+        DrawLine(x + drawProps.varFontSize, y, x + drawProps.varFontSize, y + drawProps.varFontSize, BLACK);
+        DrawLine(x, y + drawProps.varFontSize, x + drawProps.varFontSize, y + drawProps.varFontSize, BLACK);
+        DrawLine(x, y, x, y + drawProps.varFontSize, BLACK);
+    }
+}/*}}}*/
+
+void var_drawEdge(const VarCell *cell)
+{/*{{{*/
+    int x, y, x_parent, y_parent;
+
+    if (cell->parent_lvl < 0)
+        return;
+
+    var_cellPos(cell->col, cell->lvl, &x, &y);
+    var_cellPos(cell->col - 1, cell->parent_lvl, &x_parent, &y_parent);
+    DrawLine(x, y + drawProps.varFontSize / 2,
+             x_parent + drawProps.varFontSize, y_parent + drawProps.varFontSize / 2, 
+             BLACK);
+}/*}}}*/
+
+/* Draw a single cell again, e.g. if the current node moved to or away from
+ * it. The edges ending at the cell are restored, too. Returns 0 if the node
+ * is not part of the layout.
+ */
+int var_redrawNode(SGFNode *nd)
+{/*{{{*/
+    const VarCell *cell = varLayout.cells;
+    int k, x, y;
+
+    for (k=0; k<varLayout.num && cell[k].node != nd; k++) {}
+    if (k == varLayout.num)
+        return 0;
+
+    var_cellPos(cell[k].col, cell[k].lvl, &x, &y);
+    FillArea(x, y, drawProps.varFontSize + 1, drawProps.varFontSize + 1, WHITE);
+    var_drawCell(&cell[k]);
+    var_drawEdge(&cell[k]);
+
+    /* edges to the children in the next column */
+    for (k=0; k<varLayout.num; k++) {
+        if (cell[k].node->parent == nd && cell[k].col > 0)
+            var_drawEdge(&cell[k]);
+    }
+
+    rect_add(&varDirty, x, y, drawProps.varFontSize + 1, drawProps.varFontSize + 1);
+
+    return 1;
+}/*}}}*/
+
+void rect_add(VarRect *r, int x, int y, int w, int h)
+{/*{{{*/
+    if (r->w == 0) {
+        r->x = x; r->y = y; r->w = w; r->h = h;
+        return;
+    }
+
+    if (x + w > r->x + r->w) r->w = x + w - r->x;
+    if (y + h > r->y + r->h) r->h = y + h - r->y;
+    if (x < r->x) { r->w += r->x - x; r->x = x; }
+    if (y < r->y) { r->h += r->y - y; r->y = y; }
+}/*}}}*/
+
+void draw_variation(int bPartialUpdate)
+{/*{{{*/
+    int k, info_x, info_w;
     SGFNode *ndBegin = NULL;
-    char *tmp;
     char gInfo[256];
     int caps_b, caps_w;
 
@@ -248,23 +647,8 @@ void draw_variation(int bPartialUpdate)
     if (!curNode)
         return;
 
-    if (bPartialUpdate) {
-        FillArea(drawProps.comment_width + 2 * drawProps.border_sep,                 /* x */
-                 drawProps.info_y,                                                   /* y */
-                 ScreenWidth() - drawProps.comment_width + 2 * drawProps.border_sep, /* w */
-                 ScreenHeight() - drawProps.info_y,                                  /* h */
-                 WHITE);
-    }
-
-    /* print game info (move number, captured stones) */
-    SetFont(drawProps.font_ttf, BLACK);
-    board_get_captured(&caps_b, &caps_w);
-    snprintf(gInfo, sizeof(gInfo), "Move %d\nCap.: B[%d] W[%d]", curNode->move_num, caps_b, caps_w);
-    DrawTextRect(drawProps.comment_width + 2 * drawProps.border_sep,                 /* x */
-                 drawProps.info_y,                                                   /* y */
-                 ScreenWidth() - drawProps.comment_width + 2 * drawProps.border_sep, /* w */
-                 drawProps.fontSize * 3,
-                 gInfo, ALIGN_LEFT | VALIGN_TOP );
+    info_x = drawProps.comment_width + 2 * drawProps.border_sep;
+    info_w = ScreenWidth() - drawProps.comment_width + 2 * drawProps.border_sep;
 
     /* find top variation */
     for (ndBegin=curNode; ndBegin->prevVar; ndBegin=ndBegin->prevVar) {};
@@ -273,71 +657,68 @@ void draw_variation(int bPartialUpdate)
     if (ndBegin->parent)
         ndBegin = ndBegin->parent;
 
-    i = 0;
-    for (nd=ndBegin; nd; nd=nd->child) {
-        for (ndVar=nd; ndVar; ndVar=ndVar->nextVar) {
-            lvl = ndVar->draw_lvl;
-            x = drawProps.comment_width + 2 * drawProps.border_sep + 2 * i * drawProps.varFontSize;
-            y = ScreenHeight() - drawProps.varFontSize - drawProps.varFontSize * drawProps.varFontSep 
-                + lvl * (drawProps.varFontSize + drawProps.varFontSep);
-
-            if (lvl < drawProps.varwin_h) {
-                /* draw "parent" line */
-                if (ndVar->parent && i > 0) {
-                    x_parent = drawProps.comment_width + 2 * drawProps.border_sep + 2 * (i-1) * drawProps.varFontSize;
-                    y_parent = ScreenHeight() - drawProps.varFontSize - drawProps.varFontSize * drawProps.varFontSep 
-                               + ndVar->parent->draw_lvl * (drawProps.varFontSize + drawProps.varFontSep);
-
-                    DrawLine(x, y + drawProps.varFontSize / 2,
-                             x_parent + drawProps.varFontSize, y_parent + drawProps.varFontSize / 2, 
-                             BLACK);
-                }
+    materialize_variations(ndBegin);
 
-                if (is_move_node(ndVar)) {
-                    /* set current position color */
-                    SetFont(drawProps.varWin_ttf, BLACK);
-
-                    /* draw stone */
-                    if (sgfGetCharProperty(ndVar, "B ", &tmp)) {
-                        DrawString(x, y, "K");
-                        SetFont(drawProps.varWin_ttf, WHITE);
-                    } else if (sgfGetCharProperty(ndVar, "W ", &tmp)) {
-                        DrawString(x, y, "L");
-                        SetFont(drawProps.varWin_ttf, BLACK);
-                    }
-
-                    /* indicate comment if exists */
-                    if (sgfGetCharProperty(ndVar, "C ", &tmp))
-                        DrawString(x, y, "O");
-                } else { /* no move: draw just a placeholder */
-                    /* set position color */
-                    SetFont(drawProps.varWin_ttf, BLACK);
-
-                    /* draw triangle */
-                    SetFont(drawProps.varWin_ttf, BLACK);
-                    DrawString(x, y, "O");
-                }
+    board_get_captured(&caps_b, &caps_w);
+    snprintf(gInfo, sizeof(gInfo), "Move %d\nCap.: B[%d] W[%d]", curNode->move_num, caps_b, caps_w);
 
-                /* indicate current position */
-                if (ndVar == curNode) {
-                    DrawLine(x, y, x + drawProps.varFontSize, y, BLACK);
-                    DrawLine(x + drawProps.varFontSize, y, x + drawProps.varFontSize, y + drawProps.varFontSize, BLACK);
-                    DrawLine(x, y + drawProps.varFontSize, x + drawProps.varFontSize, y + drawProps.varFontSize, BLACK);
-                    DrawLine(x, y, x, y + drawProps.varFontSize, BLACK);
-                }
-            }
+    /* same window as before: only the highlight of the current node and
+     * the game info may have changed */
+    if (bPartialUpdate && varLayout.valid && varLayout.origin == ndBegin) {
+        varDirty.w = 0;
+
+        if (strcmp(gInfo, varLayout.info) != 0) {
+            FillArea(info_x, drawProps.info_y, info_w, drawProps.fontSize * 3, WHITE);
+            SetFont(drawProps.font_ttf, BLACK);
+            DrawTextRect(info_x, drawProps.info_y, info_w, drawProps.fontSize * 3,
+                         gInfo, ALIGN_LEFT | VALIGN_TOP );
+            rect_add(&varDirty, info_x, drawProps.info_y, info_w, drawProps.fontSize * 3);
         }
 
-        i += 1;
-        if (i >= drawProps.varwin_w)
-            break;
+        if (varLayout.current != curNode) {
+            var_redrawNode(varLayout.current);
+            var_redrawNode(curNode);
+        }
+
+        if (varDirty.w > 0)
+            PERF_REFRESH(PERF_PARTIAL_UPDATE, varDirty.w, varDirty.h,
+                         PartialUpdateBW(varDirty.x, varDirty.y, varDirty.w, varDirty.h));
+
+        varLayout.current = curNode;
+        snprintf(varLayout.info, sizeof(varLayout.info), "%s", gInfo);
+        return;
     }
 
     if (bPartialUpdate) {
-        PartialUpdateBW(drawProps.comment_width + 2 * drawProps.border_sep,                 /* x */
-                        drawProps.info_y,                                                   /* y */
-                        ScreenWidth() - drawProps.comment_width + 2 * drawProps.border_sep, /* w */
-                        ScreenHeight() - drawProps.info_y);                                 /* h */
+        FillArea(info_x,                                                             /* x */
+                 drawProps.info_y,                                                   /* y */
+                 info_w,                                                             /* w */
+                 ScreenHeight() - drawProps.info_y,                                  /* h */
+                 WHITE);
+    }
+
+    /* print game info (move number, captured stones) */
+    SetFont(drawProps.font_ttf, BLACK);
+    DrawTextRect(info_x,                                                             /* x */
+                 drawProps.info_y,                                                   /* y */
+                 info_w,                                                             /* w */
+                 drawProps.fontSize * 3,
+                 gInfo, ALIGN_LEFT | VALIGN_TOP );
+
+    var_layout(ndBegin);
+    for (k=0; k<varLayout.num; k++) {
+        var_drawEdge(&varLayout.cells[k]);
+        var_drawCell(&varLayout.cells[k]);
+    }
+    varLayout.current = curNode;
+    snprintf(varLayout.info, sizeof(varLayout.info), "%s", gInfo);
+
+    if (bPartialUpdate) {
+        PERF_REFRESH(PERF_PARTIAL_UPDATE, info_w, ScreenHeight() - drawProps.info_y,
+                     PartialUpdateBW(info_x,                                                /* x */
+                                     drawProps.info_y,                                      /* y */
+                                     info_w,                                                /* w */
+                                     ScreenHeight() - drawProps.info_y));                   /* h */
     }
 
 }/*}}}*/
@@ -368,32 +749,17 @@ void gogame_draw_fullrepaint()
             DrawString(drawProps.border_sep, drawProps.fontSpace*2+drawProps.fontSize, msg);
 
             /* draw comment window */
-            if (comment_str != NULL) {
-                SetFont(drawProps.font_ttf, BLACK);
-                DrawTextRect( drawProps.border_sep, drawProps.info_y,
-                              drawProps.comment_width, ScreenHeight() - drawProps.info_y,
-                              comment_str,
-                              ALIGN_LEFT | VALIGN_TOP );
-                comment_update = 0;
-                // fprintf(stderr, "x, y = %d, %d | w, h = %d, %d\n", 5, drawProps.info_y,
-                        // drawProps.comment_width, ScreenHeight() - drawProps.info_y);
-            }
+            draw_commentWindow();
+            comment_update = 0;
 
             /* draw variation window */
-            draw_variation(0);
+            PERF_TIME(PERF_VARIATION_DRAW, draw_variation(0));
 
         } else { /* if (bShowFullScreenComment) */
             assert(comment_str != NULL);
 
-            SetFont(drawProps.font_ttf, BLACK);
-            DrawTextRect( drawProps.border_sep, drawProps.border_sep,
-                          ScreenWidth() - 2 * drawProps.border_sep,
-                          ScreenHeight() - 3 * drawProps.border_sep,
-                          comment_str,
-                          ALIGN_LEFT | VALIGN_TOP );
-            DrawString(drawProps.border_sep,
-                       ScreenHeight() - 2 * drawProps.border_sep,
-                       "Info: Press the OK button to switch back to the game.");
+            draw_fullComment();
+            comment_update = 0;
         }
 
     } else {
@@ -401,17 +767,16 @@ void gogame_draw_fullrepaint()
         linePts = curFontSz; /* free line */
 
         /* title */
-        default_ttf = OpenFont("DejaVuSerif", curFontSz, 1);
+        default_ttf = fontcache_get("DejaVuSerif", curFontSz);
         SetFont(default_ttf, BLACK);
         DrawString(drawProps.border_sep, linePts, "droceRoG - Go Game Record Viewer");
         linePts += curFontSz + curFontSz / 2;
-        CloseFont(default_ttf);
 
         linePts += curFontSz + curFontSz / 2; /* free line */
 
         /* Author, version and short help */
         curFontSz = ScreenWidth() / 600 * 14;
-        default_ttf = OpenFont("DejaVuSerif", curFontSz, 1);
+        default_ttf = fontcache_get("DejaVuSerif", curFontSz);
         SetFont(default_ttf, BLACK);
         DrawString(drawProps.border_sep, linePts, "Author: Christoph Hermes (hermes<at>hausmilbe<dot>net)");
         linePts += curFontSz + curFontSz / 2;
@@ -436,6 +801,7 @@ Right-hand keys:\n\
 * Menu - Opens context menu (file selection, go to move, etc.)\n\
 * Forward / Backward - One move forward / backward\n\
 * OK - Displays a comment on the full screen instead under the board\n\
+  (the pages of a long comment are turned by Left / Right)\n\
 \n\
 \n\
 Navigation keys:\n\
@@ -451,47 +817,135 @@ Navigation keys:\n\
                        ScreenHeight() - 2 * drawProps.border_sep,
                        "Info: Press the OK button to switch back to the game.");
         }
-
-        CloseFont(default_ttf);
     }
 
     /* draw go board, if an SGF is loaded and none fullscreen info has to be
      * displayed */
     if (gameTree != NULL && !bShowFullScreenComment && !bShowHelpScreen)
-        board_draw_update(0);
+        PERF_TIME(PERF_BOARD_DRAW, board_draw_update(0));
 
-    FullUpdate();
+    PERF_REFRESH(PERF_FULL_UPDATE, ScreenWidth(), ScreenHeight(), FullUpdate());
 
 }/*}}}*/
 
 void gogame_draw_update()
 {/*{{{*/
+    int x, y, w, h;
+
     // fprintf(stderr, "gogame.c: gogame_draw_update called\n");
     if (!gameTree)
         return;
 
-    board_draw_update(1);
+    /* only the text changes while turning the pages of a full screen
+     * comment */
+    if (bShowFullScreenComment) {
+        if (comment_update) {
+            fullComment_rect(&x, &y, &w, &h);
+            FillArea(x, y, w, h, WHITE);
+            draw_fullComment();
+            PERF_REFRESH(PERF_PARTIAL_UPDATE, w, h, PartialUpdate(x, y, w, h));
+            comment_update = 0;
+        }
+        return;
+    }
+
+    /* cleans up after gogame_draw_scrub() */
+    board_set_fastRefresh(0);
+    PERF_TIME(PERF_BOARD_DRAW, board_draw_update(1));
 
     if (comment_update) {
         FillArea(drawProps.border_sep, drawProps.info_y,
                  drawProps.comment_width, ScreenHeight() - drawProps.info_y,
                  WHITE);
-        if (comment_str != NULL) {
-            SetFont(drawProps.font_ttf, BLACK);
-            DrawTextRect( drawProps.border_sep, drawProps.info_y,
-                          drawProps.comment_width, ScreenHeight() - drawProps.info_y,
-                          comment_str,
-                          ALIGN_LEFT | VALIGN_TOP );
-            // fprintf(stderr, "x, y = %d, %d | w, h = %d, %d\n", 5, drawProps.info_y,
-                    // drawProps.comment_width, ScreenHeight() - drawProps.info_y);
-        } 
-
-        PartialUpdate(drawProps.border_sep, drawProps.info_y,
-                      drawProps.comment_width, ScreenHeight() - drawProps.info_y);
+        draw_commentWindow();
+
+        PERF_REFRESH(PERF_PARTIAL_UPDATE, drawProps.comment_width, ScreenHeight() - drawProps.info_y,
+                     PartialUpdate(drawProps.border_sep, drawProps.info_y,
+                                   drawProps.comment_width, ScreenHeight() - drawProps.info_y));
         comment_update = 0;
     }
 
-    draw_variation(1);
+    PERF_TIME(PERF_VARIATION_DRAW, draw_variation(1));
+}/*}}}*/
+
+void gogame_draw_scrub()
+{/*{{{*/
+    if (!gameTree || bShowFullScreenComment || bShowHelpScreen)
+        return;
+
+    /* comment and variation window wait for gogame_draw_update() */
+    board_set_fastRefresh(1);
+    PERF_TIME(PERF_BOARD_DRAW, board_draw_update(1));
+}/*}}}*/
+
+/* Draw the comment window below the board: the note on other occurrences
+ * of the position, if any, and the first page of the comment.
+ */
+void draw_commentWindow()
+{/*{{{*/
+    int y = drawProps.info_y;
+    int h = ScreenHeight() - drawProps.info_y;
+    int noteH;
+
+    if (transNote[0] != '\0') {
+        SetFont(drawProps.font_ttf, BLACK);
+        noteH = TextRectHeight(drawProps.comment_width, transNote, ALIGN_LEFT | VALIGN_TOP);
+        DrawTextRect(drawProps.border_sep, y, drawProps.comment_width, noteH,
+                     transNote, ALIGN_LEFT | VALIGN_TOP);
+        y += noteH + drawProps.fontSpace;
+        h -= noteH + drawProps.fontSpace;
+    }
+
+    if (comment_str != NULL && h > 0)
+        draw_comment(drawProps.border_sep, y, drawProps.comment_width, h, 0);
+}/*}}}*/
+
+/* Draw page of the current comment into the rectangle, the line breaks
+ * are cached for each comment. Returns the number of pages.
+ */
+int draw_comment(int x, int y, int w, int h, int page)
+{/*{{{*/
+    const TextLayout *tl;
+
+    tl = textlayout_get(comment_str, drawProps.font_ttf, w, h);
+    SetFont(drawProps.font_ttf, BLACK);
+    if (tl == NULL) {
+        /* out of memory, the first page is still shown */
+        DrawTextRect(x, y, w, h, comment_str, ALIGN_LEFT | VALIGN_TOP);
+        return 1;
+    }
+
+    textlayout_drawPage(tl, page, x, y);
+    return tl->num_pages;
+}/*}}}*/
+
+/* area of the full screen comment including the info line below */
+void fullComment_rect(int *x, int *y, int *w, int *h)
+{/*{{{*/
+    *x = drawProps.border_sep;
+    *y = drawProps.border_sep;
+    *w = ScreenWidth() - 2 * drawProps.border_sep;
+    *h = ScreenHeight() - 2 * drawProps.border_sep;
+}/*}}}*/
+
+void draw_fullComment()
+{/*{{{*/
+    char msg[128];
+    int num;
+
+    num = draw_comment(drawProps.border_sep, drawProps.border_sep,
+                       ScreenWidth() - 2 * drawProps.border_sep,
+                       ScreenHeight() - 3 * drawProps.border_sep,
+                       fullComment_page);
+
+    if (num > 1)
+        snprintf(msg, sizeof(msg), "Page %d/%d - Left / Right: turn the pages, OK: back to the game.",
+                 fullComment_page + 1, num);
+    else
+        snprintf(msg, sizeof(msg), "Info: Press the OK button to switch back to the game.");
+    DrawString(drawProps.border_sep,
+               ScreenHeight() - 2 * drawProps.border_sep,
+               msg);
 }/*}}}*/
 
 void updateCommentStr()
@@ -502,17 +956,14 @@ void updateCommentStr()
     assert(gameTree != NULL);
     assert(curNode != NULL);
 
-    if (!sgfGetCharProperty(curNode, "C ", &msg))
-        msg = NULL;
+    msg = curNode->comment ? curNode->comment->value : NULL;
 
     if (msg == NULL) {
         if (comment_str != NULL) {
             comment_str = msg;
             comment_update = 1;
-            return;
         } else {
             comment_update = 0;
-            return;
         }
     } else {
         comment_str = msg;
@@ -528,6 +979,135 @@ void updateCommentStr()
         // }
     }
 
+    updateTransNote();
+}/*}}}*/
+
+/* Note where else the current position occurs: in another variation of
+ * the game, found by the hash of the board, and in other files of the
+ * position index. The comment window is redrawn if it changes.
+ */
+void updateTransNote()
+{/*{{{*/
+    char note[sizeof(transNote)];
+    char var[64] = "", file[64] = "";
+    const char *first, *name;
+    const NodeHash *nh;
+    SGFNode *other = NULL, *nd;
+    BoardHash hash;
+    int lo, hi, mid, num = 0;
+
+    if (!transpos.valid)
+        transpos_build();
+
+    /* other nodes with the same position */
+    hash = board_hash();
+    lo = 0;
+    hi = transpos.num;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (transpos.nodes[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (nh = &transpos.nodes[lo]; hash != 0 && lo < transpos.num && nh->hash == hash; lo++, nh++) {
+        if (nh->node == curNode)
+            continue;
+        if (other == NULL)
+            other = nh->node;
+        num += 1;
+    }
+
+    if (other != NULL) {
+        /* the main line follows the first children */
+        for (nd = other; nd->parent && nd->parent->child == nd; nd = nd->parent) {}
+        if (num > 1)
+            snprintf(var, sizeof(var), " at move %d of %s (+%d)", other->move_num,
+                     nd->parent ? "a variation" : "the main line", num - 1);
+        else
+            snprintf(var, sizeof(var), " at move %d of %s", other->move_num,
+                     nd->parent ? "a variation" : "the main line");
+    }
+
+    /* files of the position index as of its last update */
+    num = posindex_count(posindex_region_hash(POSINDEX_BOARD), gameFile, &first);
+    if (num == 1) {
+        name = strrchr(first, '/');
+        snprintf(file, sizeof(file), " in %s", name ? name + 1 : first);
+    } else if (num > 1)
+        snprintf(file, sizeof(file), " in %d other files", num);
+
+    note[0] = '\0';
+    if (var[0] || file[0])
+        snprintf(note, sizeof(note), "Position also%s%s%s", var, var[0] && file[0] ? "," : "", file);
+
+    if (strcmp(note, transNote) != 0) {
+        snprintf(transNote, sizeof(transNote), "%s", note);
+        comment_update = 1;
+    }
+}/*}}}*/
+
+/* hash the positions of all parsed nodes on bitboards, the Go board is
+ * not touched */
+void transpos_build()
+{/*{{{*/
+    transpos.num = 0;
+    transpos.valid = 1;
+    batch_replay_tree(gameTree->root, transpos_visit, &transpos);
+
+    if (transpos.num > 1)
+        qsort(transpos.nodes, transpos.num, sizeof(NodeHash), nodehash_cmp);
+}/*}}}*/
+
+void transpos_visit(void *ctx, const BitBoard *bb, SGFNode *nd)
+{/*{{{*/
+    Transpositions *tp = (Transpositions *) ctx;
+    BitRow diff;
+    int r, c;
+
+    if (nd->parent == NULL) {
+        bitboard_init(&tp->known, bb->size);
+        tp->hash = 0;
+    }
+
+    /* the hash of the fields which differ from the last node, it equals
+     * board_hash() of the node */
+    for (r=0; r<bb->size; r++) {
+        for (diff = tp->known.black[r] ^ bb->black[r], c = 0; diff; diff >>= 1, c++) {
+            if (diff & 1)
+                tp->hash ^= board_hash_stone(r, c, BOARD_BLACK);
+        }
+        for (diff = tp->known.white[r] ^ bb->white[r], c = 0; diff; diff >>= 1, c++) {
+            if (diff & 1)
+                tp->hash ^= board_hash_stone(r, c, BOARD_WHITE);
+        }
+        tp->known.black[r] = bb->black[r];
+        tp->known.white[r] = bb->white[r];
+    }
+
+    /* nodes without stones repeat the position of their parent */
+    if (tp->hash == 0 || sgfIsLazy(nd) || !sgfHasProps(nd, SGF_PROP_MOVE | SGF_PROP_SETUP))
+        return;
+
+    if (tp->num == tp->max) {
+        tp->max = tp->max ? 2 * tp->max : 256;
+        tp->nodes = (NodeHash *) realloc(tp->nodes, sizeof(NodeHash) * tp->max);
+        assert(tp->nodes != NULL);
+    }
+    tp->nodes[tp->num].hash = tp->hash;
+    tp->nodes[tp->num].node = nd;
+    tp->num += 1;
+}/*}}}*/
+
+int nodehash_cmp(const void *a, const void *b)
+{/*{{{*/
+    const NodeHash *na = (const NodeHash *) a;
+    const NodeHash *nb = (const NodeHash *) b;
+
+    /* earlier moves first */
+    if (na->hash != nb->hash)
+        return na->hash < nb->hash ? -1 : 1;
+    return na->node->move_num - nb->node->move_num;
 }/*}}}*/
 
 void gogame_printGameInfo()
@@ -578,7 +1158,8 @@ void gogame_move_forward_update(int bUpdate)
         return;
     curNode = curNode->child;
 
-    apply_sgf_cmds_to_board();
+    PERF_TIME(PERF_APPLY_NODE, apply_sgf_cmds_to_board());
+    store_snapshot();
 
     if (bUpdate)
         updateCommentStr();
@@ -592,40 +1173,99 @@ void apply_sgf_cmds_to_board()
 {/*{{{*/
     SGFProperty *prop = NULL;
     int sz = 0;
+    int k, r, c, num;
 
     assert(gameTree != NULL);
 
     sz = gameInfo.boardSize;
 
-    /* for all properties in this move */
+    /* each node is one history step, the root uses the initial one */
+    if (curNode->parent)
+        board_beginNode();
+
+    /* setup stones (AB, AW, AE) are placed together before the move */
+    if (sgfHasProps(curNode, SGF_PROP_SETUP)) {
+        num = collect_setup(curNode, sz);
+        if (num > 0)
+            board_setupStones(setupStones, num);
+    }
+
+    /* for all properties in this move, point lists are packed */
     for (prop = curNode->props; prop; prop = prop->next) {
-        switch (prop->name) {
+        for (k=0; k<sgfNumPoints(prop); k++) {
+            r = get_pointX(prop, k, sz);
+            c = get_pointY(prop, k, sz);
+            /* skip passes and invalid coordinates */
+            if (r < 0 || c < 0)
+                continue;
 
-            case ENC_SGFPROP('A', 'B'):     /* added black stone */
-                board_placeStone(get_moveX(prop, sz), get_moveY(prop, sz), BOARD_BLACK, 0);
-                break;
-            case ENC_SGFPROP('A', 'W'):     /* added white stone */
-                board_placeStone(get_moveX(prop, sz), get_moveY(prop, sz), BOARD_WHITE, 0);
-                break;
+            switch (prop->name) {
 
-            case ENC_SGFPROP('B', ' '):     /* move: black stone */
-                board_placeStone(get_moveX(prop, sz), get_moveY(prop, sz), BOARD_BLACK, 1);
-                break;
-            case ENC_SGFPROP('W', ' '):     /* move: white stone */
-                board_placeStone(get_moveX(prop, sz), get_moveY(prop, sz), BOARD_WHITE, 1);
-                break;
+                case ENC_SGFPROP('B', ' '):     /* move: black stone */
+                    board_placeStone(r, c, BOARD_BLACK, 1);
+                    break;
+                case ENC_SGFPROP('W', ' '):     /* move: white stone */
+                    board_placeStone(r, c, BOARD_WHITE, 1);
+                    break;
 
-            case ENC_SGFPROP('S', 'Q'):     /* marker: square */
-                board_placeMarker(get_moveX(prop, sz), get_moveY(prop, sz), MARK_SQUARE);
-                break;
-            case ENC_SGFPROP('C', 'R'):     /* marker: circle */
-                board_placeMarker(get_moveX(prop, sz), get_moveY(prop, sz), MARK_CIRC);
-                break;
-            case ENC_SGFPROP('T', 'R'):     /* marker: triangle */
-                board_placeMarker(get_moveX(prop, sz), get_moveY(prop, sz), MARK_TRIANGLE);
-                break;
+                case ENC_SGFPROP('S', 'Q'):     /* marker: square */
+                    board_placeMarker(r, c, MARK_SQUARE);
+                    break;
+                case ENC_SGFPROP('C', 'R'):     /* marker: circle */
+                    board_placeMarker(r, c, MARK_CIRC);
+                    break;
+                case ENC_SGFPROP('T', 'R'):     /* marker: triangle */
+                    board_placeMarker(r, c, MARK_TRIANGLE);
+                    break;
+            }
+        }
+    }
+}/*}}}*/
+
+int collect_setup(SGFNode *nd, int size)
+{/*{{{*/
+    SGFProperty *prop;
+    BoardSetupStone *stones;
+    BoardSetupType type;
+    int k, r, c, num;
+
+    /* make room for all setup points of the node */
+    num = 0;
+    for (prop = nd->props; prop; prop = prop->next) {
+        if (prop->name == ENC_SGFPROP('A', 'B') || prop->name == ENC_SGFPROP('A', 'W')
+            || prop->name == ENC_SGFPROP('A', 'E'))
+            num += sgfNumPoints(prop);
+    }
+    if (num > setupStones_max) {
+        stones = (BoardSetupStone *) realloc(setupStones, sizeof(BoardSetupStone) * num);
+        if (stones == NULL)
+            return 0;
+        setupStones = stones;
+        setupStones_max = num;
+    }
+
+    /* in the order of the properties, later ones win */
+    num = 0;
+    for (prop = nd->props; prop; prop = prop->next) {
+        switch (prop->name) {
+            case ENC_SGFPROP('A', 'B'): type = SETUP_BLACK; break;
+            case ENC_SGFPROP('A', 'W'): type = SETUP_WHITE; break;
+            case ENC_SGFPROP('A', 'E'): type = SETUP_EMPTY; break;
+            default: continue;
+        }
+        for (k=0; k<sgfNumPoints(prop); k++) {
+            r = get_pointX(prop, k, size);
+            c = get_pointY(prop, k, size);
+            if (r < 0 || c < 0)
+                continue;
+            setupStones[num].r = r;
+            setupStones[num].c = c;
+            setupStones[num].type = type;
+            num += 1;
         }
     }
+
+    return num;
 }/*}}}*/
 
 void gogame_move_back_update(int bUpdate)
@@ -637,6 +1277,8 @@ void gogame_move_back_update(int bUpdate)
 
     if (board_undo())
         curNode = curNode->parent;
+    else if (curNode->parent) /* history ends at a restored snapshot */
+        goto_node(curNode->parent);
 
     if (bUpdate)
         updateCommentStr();
@@ -646,51 +1288,77 @@ void gogame_move_back()
     gogame_move_back_update(1);
 }/*}}}*/
 
-void undo_variation(SGFNode *srcNode, SGFNode *targetNode)
+void store_snapshot()
 {/*{{{*/
-    SGFNode *srcNode_i, *targetNode_i;
-    SGFNode *pathToTarget = NULL;
+    SGFNode *nd;
+    int i;
 
-    assert(srcNode);
-    assert(targetNode);
+    assert(gameTree != NULL);
 
-    srcNode_i = srcNode;
-    targetNode_i = targetNode;
+    if (curNode->snapshot)
+        return;
 
-    /* Find same parent, undo path to srcNode, and record path to targetNode */
-    while (srcNode_i && targetNode_i && srcNode_i != targetNode_i) {
-        if (board_undo())
-            curNode = curNode->parent;
+    /* store snapshots at forks and every SNAPSHOT_INTERVAL nodes */
+    if (!curNode->child || !curNode->child->next) {
+        for (nd = curNode->parent, i = 1; nd && i < SNAPSHOT_INTERVAL; nd = nd->parent, i++) {
+            if (nd->snapshot)
+                return;
+        }
+    }
 
-        srcNode_i = srcNode_i->parent;
+    curNode->snapshot = sgfArenaAlloc(&gameTree->arena, board_snapshot_size());
+    board_snapshot_save(curNode->snapshot);
+}/*}}}*/
 
-        if (pathToTarget == NULL) {
-            pathToTarget = sgfNewNode();
-            /* HACK: use "next" pointer as data pointer */
-            pathToTarget->next = targetNode_i;  
-        } else {
-            assert( pathToTarget->parent == NULL );
-            pathToTarget->parent = sgfNewNode();
-            pathToTarget->parent->child = pathToTarget;
-            /* HACK: use "next" pointer as data pointer */
-            pathToTarget->parent->next = targetNode_i;  
-            pathToTarget = pathToTarget->parent;
-        }
-        targetNode_i = targetNode_i->parent;
+void push_nodePath(int n, SGFNode *nd)
+{/*{{{*/
+    if (n >= nodePath_size) {
+        nodePath_size = nodePath_size ? 2 * nodePath_size : 64;
+        nodePath = (SGFNode **) realloc(nodePath, nodePath_size * sizeof(SGFNode *));
+        assert(nodePath != NULL);
     }
-    assert(srcNode_i != NULL);      /* this should never happen */
-    assert(targetNode_i != NULL);
+    nodePath[n] = nd;
+}/*}}}*/
+
+void goto_node(SGFNode *target)
+{/*{{{*/
+    SGFNode *nd, *anc;
+    int i, n, bFound;
 
-    /* reverse path to target */
-    for (targetNode_i=pathToTarget; targetNode_i; targetNode_i=targetNode_i->child) {
-        curNode = targetNode_i->next;
-        targetNode_i->next = NULL; /* this prevents being freed at the end */
-        apply_sgf_cmds_to_board();
+    assert(gameTree != NULL);
+    assert(target != NULL);
+
+    /* common ancestor close to both nodes: undo and replay its path */
+    bFound = 0;
+    for (nd = target, n = 0; nd && n < SNAPSHOT_INTERVAL && !bFound; nd = nd->parent) {
+        for (anc = curNode, i = 0; anc && i < SNAPSHOT_INTERVAL; anc = anc->parent, i++) {
+            if (anc == nd) {
+                bFound = 1;
+                break;
+            }
+        }
+        if (!bFound)
+            push_nodePath(n++, nd);
+    }
+    if (bFound) {
+        while (curNode != anc && board_undo())
+            curNode = curNode->parent;
     }
 
-    /* free path */
-    sgfFreeNode(pathToTarget);
+    /* otherwise replay from the nearest snapshot (the root has always one) */
+    if (!bFound || curNode != anc) {
+        for (nd = target, n = 0; nd != curNode && !nd->snapshot; nd = nd->parent)
+            push_nodePath(n++, nd);
+        if (nd != curNode)
+            board_snapshot_restore(nd->snapshot);
+        curNode = nd;
+    }
 
+    for (i = n - 1; i >= 0; i--) {
+        curNode = nodePath[i];
+        PERF_TIME(PERF_APPLY_NODE, apply_sgf_cmds_to_board());
+        store_snapshot();
+    }
 }/*}}}*/
 
 void gogame_moveVar_down()
@@ -721,7 +1389,8 @@ void gogame_moveVar_down()
     if (ndNextVar == NULL)
         return;
 
-    undo_variation(curNode, ndNextVar);
+    materialize_node(ndNextVar);
+    goto_node(ndNextVar);
 
     updateCommentStr();
 }/*}}}*/
@@ -754,27 +1423,23 @@ void gogame_moveVar_up()
     if (ndPrevVar == NULL)
         return;
 
-    undo_variation(curNode, ndPrevVar);
+    materialize_node(ndPrevVar);
+    goto_node(ndPrevVar);
 
     updateCommentStr();
 }/*}}}*/
 
 void gogame_move_to_nextEvt()
 {/*{{{*/
-    char *msg;
-
     if (gameTree == NULL)
         return;
     if (bShowFullScreenComment) /* disable motion while fullscreen comment */
         return;
 
-    /* inital step forward */
-    gogame_move_forward_update(0);
-
-    /* move forward until end, variation, or comment is reached */
-    while (curNode->child && curNode->next == NULL && !sgfGetCharProperty(curNode, "C ", &msg)) {
-        gogame_move_forward_update(0);
-    }
+    /* the next end, variation, or comment is linked by the reader, jump
+     * there from the current node or the nearest snapshot */
+    if (curNode->nextEvt != NULL && curNode->nextEvt != curNode)
+        goto_node(curNode->nextEvt);
 
     /* update comment */
     updateCommentStr();
@@ -782,20 +1447,15 @@ void gogame_move_to_nextEvt()
 
 void gogame_move_to_prevEvt()
 {/*{{{*/
-    char *msg;
-
     if (gameTree == NULL)
         return;
     if (bShowFullScreenComment) /* disable motion while fullscreen comment */
         return;
 
-    /* inital step backward */
-    gogame_move_back_update(0);
-
-    /* move backward until beginning, variation, or comment is reached */
-    while (curNode->parent && curNode->next == NULL && curNode->parent->child->next == NULL && !sgfGetCharProperty(curNode, "C ", &msg)) {
-        gogame_move_back_update(0);
-    }
+    /* same for the previous beginning, variation, or comment: undo
+     * nearby, otherwise restore the snapshot next to it */
+    if (curNode->prevEvt != NULL && curNode->prevEvt != curNode)
+        goto_node(curNode->prevEvt);
 
     /* update comment */
     updateCommentStr();
@@ -803,6 +1463,8 @@ void gogame_move_to_prevEvt()
 
 int gogame_move_to_page(int page)
 {/*{{{*/
+    SGFNode *target;
+
     if (gameTree == NULL)
         return 0;
     if (bShowFullScreenComment) /* disable motion while fullscreen comment */
@@ -814,17 +1476,20 @@ int gogame_move_to_page(int page)
     if (page == curNode->move_num)
         return 0;
 
-    /* check if you have to move forward or backward */
+    /* find the target node in the current variation */
+    target = curNode;
     if (page < curNode->move_num) {
         /* move backward until beginning or page is reached */
-        while (curNode->parent && page < curNode->move_num)
-            gogame_move_back_update(0);
+        while (target->parent && page < target->move_num)
+            target = target->parent;
     } else if (page > curNode->move_num) {
         /* move forward until end or page is reached */
-        while (curNode->child && page > curNode->move_num)
-            gogame_move_forward_update(0);
+        while (target->child && page > target->move_num)
+            target = target->child;
     }
 
+    goto_node(target);
+
     /* update comment */
     updateCommentStr();
 
@@ -840,9 +1505,42 @@ int gogame_switch_fullComment()
         return 0;
 
     bShowFullScreenComment = !bShowFullScreenComment;
+    fullComment_page = 0;
+    return 1;
+}/*}}}*/
+
+int gogame_turn_commentPage(int delta)
+{/*{{{*/
+    const TextLayout *tl;
+    int page;
+
+    if (gameTree == NULL || !bShowFullScreenComment)
+        return 0;
+
+    tl = textlayout_get(comment_str, drawProps.font_ttf,
+                        ScreenWidth() - 2 * drawProps.border_sep,
+                        ScreenHeight() - 3 * drawProps.border_sep);
+    if (tl == NULL)
+        return 0;
+
+    page = fullComment_page + delta;
+    if (page < 0)
+        page = 0;
+    if (page >= tl->num_pages)
+        page = tl->num_pages - 1;
+    if (page == fullComment_page)
+        return 0;
+
+    fullComment_page = page;
+    comment_update = 1;
     return 1;
 }/*}}}*/
 
+int gogame_isFullCommentShown()
+{/*{{{*/
+    return bShowFullScreenComment;
+}/*}}}*/
+
 int gogame_isGameOpened()
 {/*{{{*/
     if (gameTree == NULL)
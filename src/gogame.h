@@ -6,12 +6,26 @@
 #ifndef GOGAME_H
 #define GOGAME_H
 
+#include "session.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 int gogame_new_from_file(const char *filename);
+/* open game number game (from 0) of a collection, see collection_scan() */
+int gogame_new_from_game(const char *filename, int game);
+/* Open the game of session s at its node, the board and the undo log are
+ * restored without replaying the moves. If the node is not found, the
+ * game starts at the root. Returns 0 if the game has been opened.
+ */
+int gogame_new_from_session(const Session *s);
+
+/* Save the game and the current node as session, see session_store().
+ * Returns 1 on success.
+ */
+int gogame_save_session();
 
 void gogame_cleanup();
 
@@ -19,6 +33,11 @@ void gogame_printGameInfo();
 
 void gogame_draw_fullrepaint();
 void gogame_draw_update();
+/* Draw only the board with a fast refresh while scrolling through the
+ * game. The next gogame_draw_update() draws the rest and refreshes the
+ * board cleanly.
+ */
+void gogame_draw_scrub();
 
 void gogame_move_forward();
 void gogame_move_back();
@@ -39,6 +58,16 @@ int gogame_move_to_page(int page);
  */
 int gogame_switch_fullComment();
 
+/* turn the pages of the full screen comment by delta, the text is redrawn
+ * by gogame_draw_update().
+ * Returns 1 if another page is shown, 0 without full screen comment or at
+ * its first / last page
+ */
+int gogame_turn_commentPage(int delta);
+
+/* Returns 1 while a comment is shown on the full screen */
+int gogame_isFullCommentShown();
+
 /* Set the intro plot to be shown or not. 
  * Returns the old status:
  *  1: help screen is already shown
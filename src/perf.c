@@ -0,0 +1,121 @@
+/* droceRoG - timers and counters of the hot paths
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "perf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <sgftree.h>
+
+/******************************************************************************/
+
+typedef struct {
+    long calls;
+    double total;           /* ms */
+    double max;             /* ms of the slowest call */
+    long pixels;            /* refreshed area */
+} PerfStat;
+
+/******************************************************************************/
+
+static PerfStat stats[PERF_NUM_COUNTERS];
+
+#ifdef DROCEROG_PERF
+static const char *stat_names[PERF_NUM_COUNTERS] = {
+    "Parse", "Apply node", "Captures", "Board draw", "Variations",
+    "Partial upd.", "Full upd."
+};
+#endif
+
+/******************************************************************************/
+
+void report_line(char *buf, int size, const char *name, long calls,
+                 double total, double max, long pixels);
+
+/******************************************************************************/
+
+double perf_now()
+{/*{{{*/
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}/*}}}*/
+
+void perf_add(PerfCounter c, double ms, long pixels)
+{/*{{{*/
+    stats[c].calls += 1;
+    stats[c].total += ms;
+    if (ms > stats[c].max)
+        stats[c].max = ms;
+    stats[c].pixels += pixels;
+}/*}}}*/
+
+void perf_report(char *buf, int size)
+{/*{{{*/
+#ifdef DROCEROG_PERF
+    int i, len;
+
+    buf[0] = '\0';
+    len = 0;
+    for (i=0; i<PERF_NUM_COUNTERS && len < size; i++) {
+        report_line(buf + len, size - len, stat_names[i], stats[i].calls,
+                    stats[i].total, stats[i].max, stats[i].pixels);
+        len += strlen(buf + len);
+
+        /* the post-processing is part of parsing, the counters are those
+         * of the calling thread */
+        if (i == PERF_READFILE && len < size) {
+            report_line(buf + len, size - len, "  Postproc.", sgf_perf_varinfo_calls,
+                        sgf_perf_varinfo_ms, sgf_perf_varinfo_max, 0);
+            len += strlen(buf + len);
+        }
+    }
+#else
+    snprintf(buf, size, "Built without DROCEROG_PERF.\n");
+#endif
+}/*}}}*/
+
+int perf_log(const char *filename)
+{/*{{{*/
+    char buf[2048];
+    FILE *file;
+    time_t now;
+    int ok;
+
+    file = fopen(filename, "a");
+    if (file == NULL)
+        return 0;
+
+    now = time(NULL);
+    perf_report(buf, sizeof(buf));
+    ok = fprintf(file, "--- %s%s", ctime(&now), buf) > 0;
+
+    return fclose(file) == 0 && ok;
+}/*}}}*/
+
+void perf_reset()
+{/*{{{*/
+    memset(stats, 0, sizeof(stats));
+#ifdef DROCEROG_PERF
+    sgf_perf_varinfo_calls = 0;
+    sgf_perf_varinfo_ms = 0;
+    sgf_perf_varinfo_max = 0;
+#endif
+}/*}}}*/
+
+void report_line(char *buf, int size, const char *name, long calls,
+                 double total, double max, long pixels)
+{/*{{{*/
+    /* e.g. "Board draw: 12x, 30.1 ms, max 4.2 ms, 250 kpx" */
+    if (pixels > 0)
+        snprintf(buf, size, "%s: %ldx, %.1f ms, max %.1f ms, %ld kpx\n",
+                 name, calls, total, max, pixels / 1000);
+    else
+        snprintf(buf, size, "%s: %ldx, %.1f ms, max %.1f ms\n",
+                 name, calls, total, max);
+}/*}}}*/
@@ -0,0 +1,66 @@
+/* droceRoG - timers and counters of the hot paths
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* measured code, see the PERF_TIME() and PERF_REFRESH() call sites */
+typedef enum {
+    PERF_READFILE,          /* parsing an SGF file, incl. post-processing */
+    PERF_APPLY_NODE,        /* apply_sgf_cmds_to_board() */
+    PERF_CAPTURE,           /* clearDeadGroups() */
+    PERF_BOARD_DRAW,        /* board_draw_update() */
+    PERF_VARIATION_DRAW,    /* draw_variation() */
+    PERF_PARTIAL_UPDATE,    /* PartialUpdate(), PartialUpdateBW() and DynamicUpdate() */
+    PERF_FULL_UPDATE,       /* FullUpdate() */
+    PERF_NUM_COUNTERS
+} PerfCounter;
+
+/* The timers are compiled in with DROCEROG_PERF only, otherwise the macros
+ * just execute the statement. PERF_REFRESH() also counts the refreshed
+ * area of w_ x h_ pixels. The post-processing of the SGF reader is timed
+ * by the sgf library itself.
+ */
+#ifdef DROCEROG_PERF
+#define PERF_TIME(c_, stmt_) do { \
+        double perf_t0_ = perf_now(); \
+        stmt_; \
+        perf_add((c_), perf_now() - perf_t0_, 0); \
+    } while (0)
+#define PERF_REFRESH(c_, w_, h_, stmt_) do { \
+        double perf_t0_ = perf_now(); \
+        stmt_; \
+        perf_add((c_), perf_now() - perf_t0_, (long) (w_) * (h_)); \
+    } while (0)
+#else
+#define PERF_TIME(c_, stmt_) do { stmt_; } while (0)
+#define PERF_REFRESH(c_, w_, h_, stmt_) do { stmt_; } while (0)
+#endif
+
+/* time in ms of a monotonic clock */
+double perf_now();
+
+/* add a measurement of ms milliseconds and pixels refreshed pixels */
+void perf_add(PerfCounter c, double ms, long pixels);
+
+/* Write a summary of all counters to buf, one line per counter. */
+void perf_report(char *buf, int size);
+
+/* Append the summary with a time stamp to filename. Returns 1 on success. */
+int perf_log(const char *filename);
+
+/* set all counters to zero */
+void perf_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_H */
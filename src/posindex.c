@@ -0,0 +1,724 @@
+/* droceRoG - position index of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "posindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <inkview.h>
+#include <sgftree.h>
+
+#include "fileindex.h"
+#include "batchreplay.h"
+
+/******************************************************************************/
+
+#define POSINDEX_PATH CONFIGPATH "/drocerog_positions.bin"
+#define POSINDEX_MAGIC "DRPOS003"
+
+typedef struct {
+    char *path;
+    long mtime;
+    BoardHash games;        /* sum of the whole board hashes of all positions, 0: none */
+    int bDup;               /* same games as another file, its positions are not kept */
+} PosIndexFile;
+
+typedef struct {
+    BoardHash hash;
+    int file;
+} PosIndexRec;
+
+typedef struct {
+    PosIndexFile *files;    /* sorted by path */
+    int num_files;
+    int max_files;
+    PosIndexRec *recs;      /* sorted by hash and file, unique */
+    int num_recs;
+    int max_recs;
+} PosIndex;
+
+/* file with the signature of its games, see posidx_gameRecs() */
+typedef struct {
+    BoardHash games;
+    int bDup;
+    int file;
+} PosGameRec;
+
+/* hashes of the searchable regions, updated stone by stone */
+typedef struct {
+    int size;
+    int corner;             /* fields of a corner region */
+    BoardHash board[8];     /* whole board in all orientations */
+    BoardHash corners[4][2];/* corners moved to the top left, plain and transposed */
+} RegionHashes;
+
+/* region hashes of one replayed file, made by a worker */
+typedef struct {
+    BoardHash *hashes;
+    int num;
+    int max;
+    BoardHash games;        /* see PosIndexFile */
+} PosFileHashes;
+
+/* replay of one file */
+typedef struct {
+    RegionHashes rh;
+    BitBoard known;         /* stones known to rh */
+    PosFileHashes *fh;
+} PosReplay;
+
+/* the replayed files of an update are merged into idx */
+typedef struct {
+    PosIndex *idx;
+    const int *replay;      /* number of each replayed file in idx */
+} PosMerge;
+
+/* On disk, the header is followed by the files (mtime, games, duplicate
+ * flag, length and name) and by the hashes and file numbers of all records as two arrays. */
+typedef struct {
+    char magic[8];
+    int num_files;
+    int num_recs;
+} PosIndexHeader;
+
+/******************************************************************************/
+
+static PosIndex curIndex = { NULL, 0, 0, NULL, 0, 0 };
+static int bLoaded = 0;
+
+/* file names of the last search */
+static const char **results = NULL;
+
+/******************************************************************************/
+
+void posidx_load();
+void posidx_save();
+void posidx_free(PosIndex *idx);
+PosIndexFile *posidx_addFile(PosIndex *idx);
+void posidx_addRec(PosIndex *idx, BoardHash hash, int file);
+int posidx_findFile(const PosIndex *idx, const char *path);
+int posidx_firstRec(const PosIndex *idx, BoardHash hash);
+int file_cmp(const void *a, const void *b);
+int rec_cmp(const void *a, const void *b);
+int hash_cmp(const void *a, const void *b);
+int games_cmp(const void *a, const void *b);
+PosGameRec *posidx_gameRecs(const PosIndex *idx, int *num);
+void posidx_dedup(PosIndex *idx);
+void *posidx_replayFile(void *data, const char *filename);
+void posidx_visit(void *ctx, const BitBoard *bb, SGFNode *nd);
+void posidx_mergeFile(void *data, int i, void *result);
+void hashes_init(RegionHashes *rh, int size);
+void hashes_toggle(RegionHashes *rh, int r, int c, BoardPlayer player);
+void hashes_sync(RegionHashes *rh, BitBoard *known, const BitBoard *bb);
+BoardHash hashes_get(const RegionHashes *rh, PosIndexRegion region);
+
+/******************************************************************************/
+
+int posindex_update(const char *dirname)
+{/*{{{*/
+    PosIndex idx = { NULL, 0, 0, NULL, 0, 0 };
+    const FileIndexEntry *entries;
+    PosIndexFile *f;
+    PosMerge merge;
+    const char **paths;
+    PosGameRec *games;
+    int *fileMap, *replay;
+    int i, j, k, num, numReplay, numGames, owner, bKept, bChanged;
+
+    assert(dirname);
+
+    if (!bLoaded)
+        posidx_load();
+
+    /* all SGF files of the library, sorted by path */
+    num = fileindex_update(dirname);
+    fileindex_entries(&entries);
+    for (i=0; i<num; i++) {
+        if (entries[i].isDir)
+            continue;
+        f = posidx_addFile(&idx);
+        f->path = strdup(entries[i].path);
+        f->mtime = entries[i].mtime;
+    }
+    if (idx.num_files > 0)
+        qsort(idx.files, idx.num_files, sizeof(PosIndexFile), file_cmp);
+
+    /* map unchanged files of the old index to the new one */
+    fileMap = (int *) malloc(sizeof(int) * (curIndex.num_files + 1));
+    replay = (int *) malloc(sizeof(int) * (idx.num_files + 1));
+    assert(fileMap != NULL && replay != NULL);
+    for (i=0; i<curIndex.num_files; i++)
+        fileMap[i] = -1;
+    numReplay = 0;
+    for (i=0; i<idx.num_files; i++) {
+        j = posidx_findFile(&curIndex, idx.files[i].path);
+        if (j >= 0 && curIndex.files[j].mtime == idx.files[i].mtime) {
+            fileMap[j] = i;
+            idx.files[i].games = curIndex.files[j].games;
+            idx.files[i].bDup = curIndex.files[j].bDup;
+        } else
+            replay[numReplay++] = i;
+    }
+
+    /* the positions of a duplicate are those of the first file with the
+     * same games, it is replayed if that file changes or disappears */
+    games = posidx_gameRecs(&curIndex, &numGames);
+    for (i=0; i<numGames; i=j) {
+        owner = games[i].file;
+        bKept = !games[i].bDup && fileMap[owner] >= 0;
+        for (j=i+1; j<numGames && games[j].games == games[i].games; j++) {
+            if (!bKept && fileMap[games[j].file] >= 0) {
+                k = fileMap[games[j].file];
+                idx.files[k].bDup = 0;
+                replay[numReplay++] = k;
+                fileMap[games[j].file] = -1;
+            }
+        }
+    }
+    free(games);
+
+    /* keep the positions of unchanged files, replay the others */
+    bChanged = numReplay > 0 || idx.num_files != curIndex.num_files;
+    for (i=0; i<curIndex.num_recs; i++) {
+        if (fileMap[curIndex.recs[i].file] >= 0)
+            posidx_addRec(&idx, curIndex.recs[i].hash, fileMap[curIndex.recs[i].file]);
+    }
+    if (numReplay > 0) {
+        /* replay on bitboards of the workers, the Go board is not touched */
+        paths = (const char **) malloc(sizeof(const char *) * numReplay);
+        assert(paths != NULL);
+        for (i=0; i<numReplay; i++)
+            paths[i] = idx.files[replay[i]].path;
+
+        merge.idx = &idx;
+        merge.replay = replay;
+        batch_replay_files(paths, numReplay, posidx_replayFile, posidx_mergeFile, &merge);
+        free(paths);
+    }
+
+    free(fileMap);
+    free(replay);
+
+    posidx_dedup(&idx);
+    if (idx.num_recs > 0)
+        qsort(idx.recs, idx.num_recs, sizeof(PosIndexRec), rec_cmp);
+
+    posidx_free(&curIndex);
+    curIndex = idx;
+
+    if (bChanged)
+        posidx_save();
+
+    return numReplay;
+}/*}}}*/
+
+BoardHash posindex_region_hash(PosIndexRegion region)
+{/*{{{*/
+    RegionHashes rh;
+    BoardPlayer player;
+    int r, c, size;
+
+    size = board_get_size();
+    if (size <= 0 || size > BITBOARD_MAX_SIZE)
+        return 0;
+
+    hashes_init(&rh, size);
+    for (r=0; r<size; r++) {
+        for (c=0; c<size; c++) {
+            if (board_get_stone(r, c, &player))
+                hashes_toggle(&rh, r, c, player);
+        }
+    }
+
+    return hashes_get(&rh, region);
+}/*}}}*/
+
+int posindex_search(BoardHash hash, const char ***files)
+{/*{{{*/
+    int lo, i, n;
+
+    if (!bLoaded)
+        posidx_load();
+
+    *files = NULL;
+    if (hash == 0)
+        return 0;
+
+    /* records are unique, each one is a different file */
+    lo = posidx_firstRec(&curIndex, hash);
+    for (n=0; lo+n < curIndex.num_recs && curIndex.recs[lo+n].hash == hash; n++) {}
+    if (n == 0)
+        return 0;
+
+    free(results);
+    results = (const char **) malloc(sizeof(const char *) * n);
+    assert(results != NULL);
+    for (i=0; i<n; i++)
+        results[i] = curIndex.files[curIndex.recs[lo+i].file].path;
+
+    *files = results;
+    return n;
+}/*}}}*/
+
+int posindex_count(BoardHash hash, const char *exclude, const char **first)
+{/*{{{*/
+    const char *path;
+    int i, n = 0;
+
+    if (!bLoaded)
+        posidx_load();
+
+    if (first)
+        *first = NULL;
+    if (hash == 0)
+        return 0;
+
+    for (i=posidx_firstRec(&curIndex, hash); i<curIndex.num_recs && curIndex.recs[i].hash == hash; i++) {
+        path = curIndex.files[curIndex.recs[i].file].path;
+        if (exclude != NULL && strcmp(path, exclude) == 0)
+            continue;
+        if (first && n == 0)
+            *first = path;
+        n += 1;
+    }
+
+    return n;
+}/*}}}*/
+
+void posindex_cleanup()
+{/*{{{*/
+    posidx_free(&curIndex);
+    free(results);
+    results = NULL;
+    bLoaded = 0;
+}/*}}}*/
+
+void *posidx_replayFile(void *data, const char *filename)
+{/*{{{*/
+    SGFTree tree;
+    PosReplay rp;
+    PosFileHashes *fh;
+    int i, n;
+
+    (void) data;
+
+    fh = (PosFileHashes *) calloc(1, sizeof(PosFileHashes));
+    assert(fh != NULL);
+
+    sgftree_clear(&tree);
+    if (!sgftree_readfile(&tree, filename)) {
+        sgftree_free(&tree);
+        return fh;
+    }
+
+    rp.fh = fh;
+    batch_replay_tree(tree.root, posidx_visit, &rp);
+    sgftree_free(&tree);
+
+    /* a region usually stays the same for many moves, keep each hash once */
+    if (fh->num > 1) {
+        qsort(fh->hashes, fh->num, sizeof(BoardHash), hash_cmp);
+        n = 1;
+        for (i=1; i<fh->num; i++) {
+            if (fh->hashes[i] != fh->hashes[n-1])
+                fh->hashes[n++] = fh->hashes[i];
+        }
+        fh->num = n;
+    }
+
+    return fh;
+}/*}}}*/
+
+void posidx_visit(void *ctx, const BitBoard *bb, SGFNode *nd)
+{/*{{{*/
+    PosReplay *rp = (PosReplay *) ctx;
+    PosFileHashes *fh = rp->fh;
+    int region;
+    BoardHash h;
+
+    /* each game starts on an empty board */
+    if (nd->parent == NULL) {
+        hashes_init(&rp->rh, bb->size);
+        bitboard_init(&rp->known, bb->size);
+    }
+
+    hashes_sync(&rp->rh, &rp->known, bb);
+    for (region=POSINDEX_BOARD; region<=POSINDEX_BOTTOMRIGHT; region++) {
+        h = hashes_get(&rp->rh, region);
+        if (h == 0)
+            continue;
+        if (region == POSINDEX_BOARD)
+            fh->games += h;
+
+        if (fh->num == fh->max) {
+            fh->max = fh->max ? 2 * fh->max : 1024;
+            fh->hashes = (BoardHash *) realloc(fh->hashes, sizeof(BoardHash) * fh->max);
+            assert(fh->hashes != NULL);
+        }
+        fh->hashes[fh->num++] = h;
+    }
+}/*}}}*/
+
+void posidx_mergeFile(void *data, int i, void *result)
+{/*{{{*/
+    PosMerge *merge = (PosMerge *) data;
+    PosFileHashes *fh = (PosFileHashes *) result;
+    int k;
+
+    for (k=0; k<fh->num; k++)
+        posidx_addRec(merge->idx, fh->hashes[k], merge->replay[i]);
+    merge->idx->files[merge->replay[i]].games = fh->games;
+
+    free(fh->hashes);
+    free(fh);
+}/*}}}*/
+
+/* Files with equal positions are indexed once: all files of a group with
+ * the same games but the first one are marked as duplicates and their
+ * records are removed. The first file of a group always has records, see
+ * posindex_update().
+ */
+void posidx_dedup(PosIndex *idx)
+{/*{{{*/
+    PosGameRec *games;
+    int i, j, n, numGames, bDropped = 0;
+
+    games = posidx_gameRecs(idx, &numGames);
+    for (i=0; i<numGames; i=j) {
+        idx->files[games[i].file].bDup = 0;
+        for (j=i+1; j<numGames && games[j].games == games[i].games; j++) {
+            if (!idx->files[games[j].file].bDup)
+                bDropped = 1;
+            idx->files[games[j].file].bDup = 1;
+        }
+    }
+    free(games);
+
+    if (!bDropped)
+        return;
+
+    n = 0;
+    for (i=0; i<idx->num_recs; i++) {
+        if (!idx->files[idx->recs[i].file].bDup)
+            idx->recs[n++] = idx->recs[i];
+    }
+    idx->num_recs = n;
+}/*}}}*/
+
+/* Files of idx with a signature of their games, sorted by signature, then
+ * the files with records first, then by path. The array has to be freed.
+ */
+PosGameRec *posidx_gameRecs(const PosIndex *idx, int *num)
+{/*{{{*/
+    PosGameRec *games;
+    int i, n = 0;
+
+    games = (PosGameRec *) malloc(sizeof(PosGameRec) * (idx->num_files + 1));
+    assert(games != NULL);
+    for (i=0; i<idx->num_files; i++) {
+        if (idx->files[i].games == 0)
+            continue;
+        games[n].games = idx->files[i].games;
+        games[n].bDup = idx->files[i].bDup;
+        games[n].file = i;
+        n += 1;
+    }
+    if (n > 1)
+        qsort(games, n, sizeof(PosGameRec), games_cmp);
+
+    *num = n;
+    return games;
+}/*}}}*/
+
+void hashes_init(RegionHashes *rh, int size)
+{/*{{{*/
+    memset(rh, 0, sizeof(RegionHashes));
+    rh->size = size;
+    rh->corner = size >= 2 * POSINDEX_CORNER_SIZE ? POSINDEX_CORNER_SIZE : size / 2;
+}/*}}}*/
+
+void hashes_toggle(RegionHashes *rh, int r, int c, BoardPlayer player)
+{/*{{{*/
+    int n = rh->size - 1;
+    int s, k, rr, cc, tmp;
+
+    /* whole board: bit 0 mirrors rows, bit 1 columns, bit 2 transposes */
+    for (s=0; s<8; s++) {
+        rr = (s & 1) ? n - r : r;
+        cc = (s & 2) ? n - c : c;
+        if (s & 4) {
+            tmp = rr; rr = cc; cc = tmp;
+        }
+        rh->board[s] ^= board_hash_stone(rr, cc, player);
+    }
+
+    /* corners in PosIndexRegion order, mirrored to the top left */
+    for (k=0; k<4; k++) {
+        rr = (k & 2) ? n - r : r;
+        cc = (k & 1) ? n - c : c;
+        if (rr < rh->corner && cc < rh->corner) {
+            rh->corners[k][0] ^= board_hash_stone(rr, cc, player);
+            rh->corners[k][1] ^= board_hash_stone(cc, rr, player);
+        }
+    }
+}/*}}}*/
+
+void hashes_sync(RegionHashes *rh, BitBoard *known, const BitBoard *bb)
+{/*{{{*/
+    BitRow diff;
+    int r, c;
+
+    /* toggle the fields which differ from the stones known to rh */
+    for (r=0; r<rh->size; r++) {
+        for (diff = known->black[r] ^ bb->black[r], c = 0; diff; diff >>= 1, c++) {
+            if (diff & 1)
+                hashes_toggle(rh, r, c, BOARD_BLACK);
+        }
+        for (diff = known->white[r] ^ bb->white[r], c = 0; diff; diff >>= 1, c++) {
+            if (diff & 1)
+                hashes_toggle(rh, r, c, BOARD_WHITE);
+        }
+        known->black[r] = bb->black[r];
+        known->white[r] = bb->white[r];
+    }
+}/*}}}*/
+
+BoardHash hashes_get(const RegionHashes *rh, PosIndexRegion region)
+{/*{{{*/
+    BoardHash h;
+    int s;
+
+    /* the smallest hash of all orientations represents the region */
+    if (region == POSINDEX_BOARD) {
+        if (rh->board[0] == 0)
+            return 0;
+        h = rh->board[0];
+        for (s=1; s<8; s++) {
+            if (rh->board[s] < h)
+                h = rh->board[s];
+        }
+        /* positions of different board sizes are different */
+        return h ^ (BoardHash) rh->size * 0x9E3779B97F4A7C15ULL;
+    }
+
+    h = rh->corners[region - POSINDEX_TOPLEFT][0];
+    if (rh->corners[region - POSINDEX_TOPLEFT][1] < h)
+        h = rh->corners[region - POSINDEX_TOPLEFT][1];
+    return h;
+}/*}}}*/
+
+void posidx_load()
+{/*{{{*/
+    FILE *file;
+    PosIndexHeader header;
+    PosIndexFile *f;
+    BoardHash *hashes = NULL;
+    int *files = NULL;
+    BoardHash games;
+    unsigned short len;
+    unsigned char dup;
+    int i, mtime, bOk;
+
+    bLoaded = 1;
+    posidx_free(&curIndex);
+
+    file = fopen(POSINDEX_PATH, "rb");
+    if (!file)
+        return;
+
+    /* ignore index files of other versions */
+    bOk = fread(&header, sizeof(header), 1, file) == 1
+          && memcmp(header.magic, POSINDEX_MAGIC, 8) == 0
+          && header.num_files >= 0 && header.num_recs >= 0;
+
+    for (i=0; bOk && i<header.num_files; i++) {
+        bOk = fread(&mtime, sizeof(int), 1, file) == 1
+              && fread(&games, sizeof(BoardHash), 1, file) == 1
+              && fread(&dup, 1, 1, file) == 1 && dup <= 1
+              && fread(&len, sizeof(len), 1, file) == 1;
+        if (!bOk)
+            break;
+        f = posidx_addFile(&curIndex);
+        f->mtime = mtime;
+        f->games = games;
+        f->bDup = dup;
+        f->path = (char *) malloc(len + 1);
+        assert(f->path != NULL);
+        bOk = fread(f->path, 1, len, file) == len;
+        f->path[len] = '\0';
+    }
+
+    if (bOk && header.num_recs > 0) {
+        hashes = (BoardHash *) malloc(sizeof(BoardHash) * header.num_recs);
+        files = (int *) malloc(sizeof(int) * header.num_recs);
+        bOk = hashes != NULL && files != NULL
+              && fread(hashes, sizeof(BoardHash), header.num_recs, file) == (size_t) header.num_recs
+              && fread(files, sizeof(int), header.num_recs, file) == (size_t) header.num_recs;
+        for (i=0; bOk && i<header.num_recs; i++) {
+            bOk = files[i] >= 0 && files[i] < header.num_files;
+            if (bOk)
+                posidx_addRec(&curIndex, hashes[i], files[i]);
+        }
+    }
+    free(hashes);
+    free(files);
+    fclose(file);
+
+    if (!bOk) {
+        fprintf(stderr, "[ERROR] Could not read %s\n", POSINDEX_PATH);
+        posidx_free(&curIndex);
+    }
+}/*}}}*/
+
+void posidx_save()
+{/*{{{*/
+    FILE *file;
+    PosIndexHeader header;
+    unsigned short len;
+    unsigned char dup;
+    int i, mtime, bOk;
+
+    /* write a temporary file first, an interrupted write keeps the old index */
+    file = fopen(POSINDEX_PATH ".tmp", "wb");
+    if (!file) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", POSINDEX_PATH ".tmp");
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POSINDEX_MAGIC, 8);
+    header.num_files = curIndex.num_files;
+    header.num_recs = curIndex.num_recs;
+    bOk = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (i=0; bOk && i<curIndex.num_files; i++) {
+        mtime = (int) curIndex.files[i].mtime;
+        len = (unsigned short) strlen(curIndex.files[i].path);
+        dup = (unsigned char) curIndex.files[i].bDup;
+        bOk = fwrite(&mtime, sizeof(int), 1, file) == 1
+              && fwrite(&curIndex.files[i].games, sizeof(BoardHash), 1, file) == 1
+              && fwrite(&dup, 1, 1, file) == 1
+              && fwrite(&len, sizeof(len), 1, file) == 1
+              && fwrite(curIndex.files[i].path, 1, len, file) == len;
+    }
+    for (i=0; bOk && i<curIndex.num_recs; i++)
+        bOk = fwrite(&curIndex.recs[i].hash, sizeof(BoardHash), 1, file) == 1;
+    for (i=0; bOk && i<curIndex.num_recs; i++)
+        bOk = fwrite(&curIndex.recs[i].file, sizeof(int), 1, file) == 1;
+
+    if (fclose(file) != 0 || !bOk || rename(POSINDEX_PATH ".tmp", POSINDEX_PATH) != 0)
+        fprintf(stderr, "[ERROR] Could not write %s\n", POSINDEX_PATH);
+}/*}}}*/
+
+void posidx_free(PosIndex *idx)
+{/*{{{*/
+    int i;
+
+    for (i=0; i<idx->num_files; i++)
+        free(idx->files[i].path);
+    free(idx->files);
+    free(idx->recs);
+
+    memset(idx, 0, sizeof(PosIndex));
+}/*}}}*/
+
+PosIndexFile *posidx_addFile(PosIndex *idx)
+{/*{{{*/
+    PosIndexFile *f;
+
+    if (idx->num_files == idx->max_files) {
+        idx->max_files = idx->max_files ? 2 * idx->max_files : 256;
+        idx->files = (PosIndexFile *) realloc(idx->files, sizeof(PosIndexFile) * idx->max_files);
+        assert(idx->files != NULL);
+    }
+
+    f = &idx->files[idx->num_files++];
+    memset(f, 0, sizeof(PosIndexFile));
+
+    return f;
+}/*}}}*/
+
+void posidx_addRec(PosIndex *idx, BoardHash hash, int file)
+{/*{{{*/
+    if (idx->num_recs == idx->max_recs) {
+        idx->max_recs = idx->max_recs ? 2 * idx->max_recs : 4096;
+        idx->recs = (PosIndexRec *) realloc(idx->recs, sizeof(PosIndexRec) * idx->max_recs);
+        assert(idx->recs != NULL);
+    }
+
+    idx->recs[idx->num_recs].hash = hash;
+    idx->recs[idx->num_recs].file = file;
+    idx->num_recs += 1;
+}/*}}}*/
+
+int posidx_findFile(const PosIndex *idx, const char *path)
+{/*{{{*/
+    PosIndexFile key;
+    PosIndexFile *found;
+
+    if (idx->num_files == 0)
+        return -1;
+
+    key.path = (char *) path;
+    found = (PosIndexFile *) bsearch(&key, idx->files, idx->num_files, sizeof(PosIndexFile), file_cmp);
+
+    return found ? (int) (found - idx->files) : -1;
+}/*}}}*/
+
+/* first record of the hash or where it would be */
+int posidx_firstRec(const PosIndex *idx, BoardHash hash)
+{/*{{{*/
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = idx->num_recs;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (idx->recs[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}/*}}}*/
+
+int file_cmp(const void *a, const void *b)
+{/*{{{*/
+    return strcmp(((const PosIndexFile *) a)->path, ((const PosIndexFile *) b)->path);
+}/*}}}*/
+
+int rec_cmp(const void *a, const void *b)
+{/*{{{*/
+    const PosIndexRec *ra = (const PosIndexRec *) a;
+    const PosIndexRec *rb = (const PosIndexRec *) b;
+
+    if (ra->hash != rb->hash)
+        return ra->hash < rb->hash ? -1 : 1;
+    return ra->file - rb->file;
+}/*}}}*/
+
+int games_cmp(const void *a, const void *b)
+{/*{{{*/
+    const PosGameRec *ga = (const PosGameRec *) a;
+    const PosGameRec *gb = (const PosGameRec *) b;
+
+    if (ga->games != gb->games)
+        return ga->games < gb->games ? -1 : 1;
+    if (ga->bDup != gb->bDup)
+        return ga->bDup - gb->bDup;
+    return ga->file - gb->file;
+}/*}}}*/
+
+int hash_cmp(const void *a, const void *b)
+{/*{{{*/
+    BoardHash ha = *(const BoardHash *) a;
+    BoardHash hb = *(const BoardHash *) b;
+
+    return ha < hb ? -1 : ha > hb;
+}/*}}}*/
@@ -0,0 +1,66 @@
+/* droceRoG - position index of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+#include "goboard.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* searchable parts of the board */
+typedef enum {
+    POSINDEX_BOARD,         /* whole board */
+    POSINDEX_TOPLEFT,       /* corners, see POSINDEX_CORNER_SIZE */
+    POSINDEX_TOPRIGHT,
+    POSINDEX_BOTTOMLEFT,
+    POSINDEX_BOTTOMRIGHT
+} PosIndexRegion;
+
+/* fields of a corner region on a 19x19 board, smaller boards use half of
+ * their size */
+#define POSINDEX_CORNER_SIZE 7
+
+/* Update the index of all SGF files below dirname: files which are new or
+ * have been modified are replayed and every position of every variation
+ * is added, the result is saved on disk. The files are replayed on
+ * bitboards by a pool of threads, the current board stays as it is.
+ * Files whose positions have the same whole board hashes as those of
+ * another file are duplicates, only the first one by path is indexed.
+ * Returns the number of replayed files.
+ */
+int posindex_update(const char *dirname);
+
+/* Hash of a region of the current board which does not depend on the
+ * orientation of the board (rotations and mirroring). Returns 0 if the
+ * region is empty.
+ */
+BoardHash posindex_region_hash(PosIndexRegion region);
+
+/* Find the files which contain a position with the given region hash,
+ * duplicates are left out. The index is loaded from disk if necessary.
+ * Returns the number of files, the names stay valid until the next update
+ * or cleanup.
+ */
+int posindex_search(BoardHash hash, const char ***files);
+
+/* Number of files besides exclude (may be NULL) which contain a position
+ * with the given region hash, like posindex_search() but without a list.
+ * The name of the first one is returned in first if it is not NULL, it
+ * stays valid until the next update or cleanup.
+ */
+int posindex_count(BoardHash hash, const char *exclude, const char **first);
+
+/* release the index in memory */
+void posindex_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSINDEX_H */
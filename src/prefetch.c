@@ -0,0 +1,243 @@
+/* droceRoG - background parsing of SGF files
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "prefetch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "treecache.h"
+
+/******************************************************************************/
+
+typedef enum {
+    SLOT_EMPTY,             /* unused */
+    SLOT_PENDING,           /* waiting for the worker */
+    SLOT_BUSY,              /* parsed by the worker in the moment */
+    SLOT_READY              /* tree is available, NULL if parsing failed */
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    char filename[256];
+    SGFTree *tree;
+} PrefetchSlot;
+
+/******************************************************************************/
+
+static PrefetchSlot slots[PREFETCH_MAX_FILES];
+
+/* the lock protects the slots and bQuit */
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t worker;
+static int bRunning = 0;
+static int bQuit = 0;
+
+/******************************************************************************/
+
+void *worker_main(void *arg);
+SGFTree *read_tree(const char *filename);
+void slot_clear(PrefetchSlot *slot);
+
+/******************************************************************************/
+
+void prefetch_init()
+{/*{{{*/
+    int i;
+
+    if (bRunning)
+        return;
+
+    for (i=0; i<PREFETCH_MAX_FILES; i++) {
+        slots[i].state = SLOT_EMPTY;
+        slots[i].filename[0] = '\0';
+        slots[i].tree = NULL;
+    }
+
+    bQuit = 0;
+    if (pthread_create(&worker, NULL, worker_main, NULL) != 0) {
+        fprintf(stderr, "[ERROR] Could not start prefetch thread\n");
+        return;
+    }
+    bRunning = 1;
+}/*}}}*/
+
+void prefetch_cleanup()
+{/*{{{*/
+    int i;
+
+    if (!bRunning)
+        return;
+
+    pthread_mutex_lock(&slot_lock);
+    bQuit = 1;
+    pthread_cond_broadcast(&slot_cond);
+    pthread_mutex_unlock(&slot_lock);
+
+    pthread_join(worker, NULL);
+    bRunning = 0;
+
+    for (i=0; i<PREFETCH_MAX_FILES; i++)
+        slot_clear(&slots[i]);
+}/*}}}*/
+
+void prefetch_files(const char **filenames, int num)
+{/*{{{*/
+    int i, j;
+
+    if (!bRunning)
+        return;
+    if (num > PREFETCH_MAX_FILES)
+        num = PREFETCH_MAX_FILES;
+
+    pthread_mutex_lock(&slot_lock);
+
+    /* drop files which are not requested anymore, a busy slot is
+     * recognised by the worker after parsing */
+    for (i=0; i<PREFETCH_MAX_FILES; i++) {
+        if (slots[i].state == SLOT_EMPTY)
+            continue;
+        for (j=0; j<num; j++) {
+            if (filenames[j] && strcmp(slots[i].filename, filenames[j]) == 0)
+                break;
+        }
+        if (j == num)
+            slot_clear(&slots[i]);
+    }
+
+    /* add new requests */
+    for (j=0; j<num; j++) {
+        if (filenames[j] == NULL)
+            continue;
+        for (i=0; i<PREFETCH_MAX_FILES; i++) {
+            if (slots[i].state != SLOT_EMPTY && strcmp(slots[i].filename, filenames[j]) == 0)
+                break;
+        }
+        if (i < PREFETCH_MAX_FILES)
+            continue;
+
+        for (i=0; i<PREFETCH_MAX_FILES && slots[i].state != SLOT_EMPTY; i++) {}
+        assert(i < PREFETCH_MAX_FILES);
+        snprintf(slots[i].filename, sizeof(slots[i].filename), "%s", filenames[j]);
+        slots[i].state = SLOT_PENDING;
+    }
+
+    pthread_cond_broadcast(&slot_cond);
+    pthread_mutex_unlock(&slot_lock);
+}/*}}}*/
+
+SGFTree *prefetch_take(const char *filename)
+{/*{{{*/
+    SGFTree *tree = NULL;
+    int i;
+
+    if (!bRunning || filename == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&slot_lock);
+
+    for (i=0; i<PREFETCH_MAX_FILES; i++) {
+        if (slots[i].state != SLOT_EMPTY && strcmp(slots[i].filename, filename) == 0)
+            break;
+    }
+
+    if (i < PREFETCH_MAX_FILES) {
+        /* parsing has started already, wait for the result */
+        while (slots[i].state == SLOT_BUSY)
+            pthread_cond_wait(&slot_cond, &slot_lock);
+
+        /* a pending request is dropped, the caller reads the file itself */
+        if (slots[i].state == SLOT_READY) {
+            tree = slots[i].tree;
+            slots[i].tree = NULL;
+        }
+        slots[i].state = SLOT_EMPTY;
+    }
+
+    pthread_mutex_unlock(&slot_lock);
+
+    /* the tree waited in its compact form */
+    if (tree != NULL)
+        sgftree_expand(tree);
+
+    return tree;
+}/*}}}*/
+
+void *worker_main(void *arg)
+{/*{{{*/
+    char filename[256];
+    SGFTree *tree;
+    int i;
+
+    (void) arg;
+
+    pthread_mutex_lock(&slot_lock);
+    while (!bQuit) {
+        /* wait for the next request */
+        for (i=0; i<PREFETCH_MAX_FILES && slots[i].state != SLOT_PENDING; i++) {}
+        if (i == PREFETCH_MAX_FILES) {
+            pthread_cond_wait(&slot_cond, &slot_lock);
+            continue;
+        }
+
+        slots[i].state = SLOT_BUSY;
+        snprintf(filename, sizeof(filename), "%s", slots[i].filename);
+        pthread_mutex_unlock(&slot_lock);
+
+        tree = read_tree(filename);
+
+        pthread_mutex_lock(&slot_lock);
+        if (slots[i].state == SLOT_BUSY && strcmp(slots[i].filename, filename) == 0) {
+            slots[i].tree = tree;
+            slots[i].state = SLOT_READY;
+        } else if (tree != NULL) {
+            /* request has been dropped meanwhile */
+            sgftree_free(tree);
+            free(tree);
+        }
+        pthread_cond_broadcast(&slot_cond);
+    }
+    pthread_mutex_unlock(&slot_lock);
+
+    return NULL;
+}/*}}}*/
+
+SGFTree *read_tree(const char *filename)
+{/*{{{*/
+    SGFTree *tree;
+
+    tree = treecache_load(filename);
+    if (tree == NULL) {
+        tree = (SGFTree *) malloc(sizeof(SGFTree));
+        if (tree == NULL)
+            return NULL;
+        sgftree_clear(tree);
+
+        if (!sgftree_readfile_flags(tree, filename, SGF_READ_LAZY)) {
+            free(tree);
+            return NULL;
+        }
+    }
+
+    /* keep it small until it is taken, the nodes stay if it does not fit */
+    sgftree_compact(tree);
+
+    return tree;
+}/*}}}*/
+
+void slot_clear(PrefetchSlot *slot)
+{/*{{{*/
+    if (slot->tree != NULL) {
+        sgftree_free(slot->tree);
+        free(slot->tree);
+        slot->tree = NULL;
+    }
+    slot->state = SLOT_EMPTY;
+}/*}}}*/
@@ -0,0 +1,42 @@
+/* droceRoG - background parsing of SGF files
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <sgftree.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* maximal number of files parsed in advance */
+#define PREFETCH_MAX_FILES 2
+
+/* start and stop the worker thread, prefetch_cleanup() releases all
+ * trees which have not been taken */
+void prefetch_init();
+void prefetch_cleanup();
+
+/* Parse the given files in the background. Requests and parsed trees of
+ * files not listed are dropped. At most PREFETCH_MAX_FILES names are used,
+ * NULL entries are ignored. Parsed trees wait as compact copies, see
+ * sgftree_compact().
+ */
+void prefetch_files(const char **filenames, int num);
+
+/* Take the parsed tree of filename, waits if it is being parsed in the
+ * moment. Returns NULL if the file has not been requested or cannot be
+ * read. The tree is owned by the caller afterwards (sgftree_free() and
+ * free()).
+ */
+SGFTree *prefetch_take(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PREFETCH_H */
@@ -0,0 +1,151 @@
+/* droceRoG - game and position shown when the viewer was left
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <inkview.h>
+
+/******************************************************************************/
+
+#define SESSION_PATH CONFIGPATH "/drocerog_session.bin"
+#define SESSION_MAGIC "DRSES001"
+
+/* followed by the path, the snapshot and the history */
+typedef struct {
+    char magic[8];
+    char filename[256];
+    int game;
+    long mtime;
+    long size;
+    int path_len;
+    int snapshot_len;
+    int history_len;
+} SessionHeader;
+
+/******************************************************************************/
+
+int file_stamp(const char *filename, long *mtime, long *size);
+
+/******************************************************************************/
+
+int session_store(Session *s)
+{/*{{{*/
+    FILE *file;
+    SessionHeader header;
+    int bOk;
+
+    if (!file_stamp(s->filename, &s->mtime, &s->size))
+        return 0;
+
+    /* write a temporary file first, an interrupted write keeps the old session */
+    file = fopen(SESSION_PATH ".tmp", "wb");
+    if (!file) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", SESSION_PATH ".tmp");
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SESSION_MAGIC, 8);
+    snprintf(header.filename, sizeof(header.filename), "%s", s->filename);
+    header.game = s->game;
+    header.mtime = s->mtime;
+    header.size = s->size;
+    header.path_len = s->path_len;
+    header.snapshot_len = s->snapshot_len;
+    header.history_len = s->history_len;
+
+    bOk = fwrite(&header, sizeof(header), 1, file) == 1
+          && fwrite(s->path, sizeof(int), s->path_len, file) == (size_t) s->path_len
+          && fwrite(s->snapshot, 1, s->snapshot_len, file) == (size_t) s->snapshot_len
+          && fwrite(s->history, 1, s->history_len, file) == (size_t) s->history_len;
+
+    if (fclose(file) != 0 || !bOk || rename(SESSION_PATH ".tmp", SESSION_PATH) != 0) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", SESSION_PATH);
+        return 0;
+    }
+
+    return 1;
+}/*}}}*/
+
+int session_load(Session *s)
+{/*{{{*/
+    FILE *file;
+    SessionHeader header;
+    struct stat st;
+    long mtime, size, rest;
+    int bOk;
+
+    memset(s, 0, sizeof(Session));
+
+    file = fopen(SESSION_PATH, "rb");
+    if (!file)
+        return 0;
+
+    /* ignore sessions of other versions and of modified files; the arrays
+     * have to fill the rest of the file, a broken header allocates nothing */
+    bOk = fstat(fileno(file), &st) == 0
+          && fread(&header, sizeof(header), 1, file) == 1
+          && memcmp(header.magic, SESSION_MAGIC, 8) == 0;
+    if (bOk) {
+        rest = (long) st.st_size - (long) sizeof(header);
+        bOk = header.path_len >= 0 && header.path_len <= rest / (long) sizeof(int)
+              && header.snapshot_len >= 0 && header.snapshot_len <= rest
+              && header.history_len >= 0 && header.history_len <= rest
+              && (long) sizeof(int) * header.path_len + header.snapshot_len + header.history_len == rest;
+    }
+    if (bOk) {
+        header.filename[sizeof(header.filename) - 1] = '\0';
+        bOk = file_stamp(header.filename, &mtime, &size)
+              && mtime == header.mtime && size == header.size;
+    }
+
+    if (bOk) {
+        snprintf(s->filename, sizeof(s->filename), "%s", header.filename);
+        s->game = header.game;
+        s->mtime = header.mtime;
+        s->size = header.size;
+        s->path_len = header.path_len;
+        s->snapshot_len = header.snapshot_len;
+        s->history_len = header.history_len;
+
+        /* one byte more each, malloc(0) may return NULL */
+        s->path = (int *) malloc(sizeof(int) * s->path_len + 1);
+        s->snapshot = malloc(s->snapshot_len + 1);
+        s->history = malloc(s->history_len + 1);
+        bOk = s->path != NULL && s->snapshot != NULL && s->history != NULL
+              && fread(s->path, sizeof(int), s->path_len, file) == (size_t) s->path_len
+              && fread(s->snapshot, 1, s->snapshot_len, file) == (size_t) s->snapshot_len
+              && fread(s->history, 1, s->history_len, file) == (size_t) s->history_len;
+    }
+    fclose(file);
+
+    if (!bOk)
+        session_free(s);
+    return bOk;
+}/*}}}*/
+
+void session_free(Session *s)
+{/*{{{*/
+    free(s->path);
+    free(s->snapshot);
+    free(s->history);
+    memset(s, 0, sizeof(Session));
+}/*}}}*/
+
+int file_stamp(const char *filename, long *mtime, long *size)
+{/*{{{*/
+    struct stat st;
+
+    if (filename == NULL || filename[0] == '\0' || stat(filename, &st) != 0)
+        return 0;
+    *mtime = (long) st.st_mtime;
+    *size = (long) st.st_size;
+    return 1;
+}/*}}}*/
@@ -0,0 +1,44 @@
+/* droceRoG - game and position shown when the viewer was left
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct {
+    char filename[256];     /* SGF file */
+    int game;               /* game in a collection */
+    long mtime;             /* stamp of the SGF file */
+    long size;
+    int *path;              /* child index of each node below the root */
+    int path_len;
+    void *snapshot;         /* board_snapshot_save() of the node */
+    int snapshot_len;
+    void *history;          /* board_history_save() of the node */
+    int history_len;
+} Session;
+
+/* Write session s, the stamp of its SGF file is taken now. Returns 1 on
+ * success.
+ */
+int session_store(Session *s);
+
+/* Read the last session to s. Returns 0 if there is none or its SGF file
+ * has been modified since, 1 otherwise. Release s by session_free().
+ */
+int session_load(Session *s);
+
+/* release the arrays of s */
+void session_free(Session *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SESSION_H */
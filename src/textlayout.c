@@ -0,0 +1,234 @@
+/* droceRoG - line breaks and pages of the comments
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "textlayout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+
+typedef struct {
+    const char *key;        /* text of the layout, NULL: unused */
+    ifont *font;
+    int width, height;
+    TextLayout layout;
+} LayoutEntry;
+
+/******************************************************************************/
+
+/* number of cached layouts, a slot is chosen by the address of the text,
+ * i.e. the comments of a game, in the window and on the full screen */
+#define TEXTLAYOUT_CACHE_SIZE 64
+
+static LayoutEntry layouts[TEXTLAYOUT_CACHE_SIZE];
+
+/******************************************************************************/
+
+int textlayout_wrap(TextLayout *tl, const char *s, int width);
+int textlayout_pushLine(TextLayout *tl, int *max, int offset);
+unsigned short textlayout_decode(const unsigned char *s, int *len);
+void textlayout_free(LayoutEntry *e);
+
+/******************************************************************************/
+
+const TextLayout *textlayout_get(const char *text, ifont *font, int width, int height)
+{/*{{{*/
+    LayoutEntry *e;
+    TextLayout *tl;
+    unsigned long slot;
+
+    if (text == NULL || width <= 0)
+        return NULL;
+
+    slot = ((unsigned long) text >> 3) ^ (unsigned long) width;
+    e = &layouts[slot % TEXTLAYOUT_CACHE_SIZE];
+    if (e->key == text && e->font == font && e->width == width && e->height == height)
+        return &e->layout;
+
+    textlayout_free(e);
+
+    /* the widths are those of the current font */
+    SetFont(font, BLACK);
+    tl = &e->layout;
+    if (!textlayout_wrap(tl, text, width)) {
+        textlayout_free(e);
+        return NULL;
+    }
+
+    tl->line_height = TextRectHeight(width, "Ag", ALIGN_LEFT | VALIGN_TOP);
+    if (tl->line_height <= 0)
+        tl->line_height = 1;
+    tl->lines_per_page = height / tl->line_height;
+    if (tl->lines_per_page < 1)
+        tl->lines_per_page = 1;
+    tl->num_pages = (tl->num_lines + tl->lines_per_page - 1) / tl->lines_per_page;
+    if (tl->num_pages < 1)
+        tl->num_pages = 1;
+
+    e->key = text;
+    e->font = font;
+    e->width = width;
+    e->height = height;
+    return tl;
+}/*}}}*/
+
+void textlayout_drawPage(const TextLayout *tl, int page, int x, int y)
+{/*{{{*/
+    int i, end;
+
+    if (page < 0 || page >= tl->num_pages)
+        return;
+
+    i = page * tl->lines_per_page;
+    end = i + tl->lines_per_page;
+    if (end > tl->num_lines)
+        end = tl->num_lines;
+    for (; i<end; i++, y += tl->line_height) {
+        if (tl->text[tl->lines[i]] != '\0')
+            DrawString(x, y, tl->text + tl->lines[i]);
+    }
+}/*}}}*/
+
+void textlayout_clear()
+{/*{{{*/
+    int i;
+
+    for (i=0; i<TEXTLAYOUT_CACHE_SIZE; i++)
+        textlayout_free(&layouts[i]);
+}/*}}}*/
+
+/* Copy s to tl->text with a '\0' at the end of each line. A line ends at
+ * '\n', or at the last space before it gets wider than width. Words
+ * wider than a line are broken anywhere. Returns 0 if out of memory.
+ */
+int textlayout_wrap(TextLayout *tl, const char *s, int width)
+{/*{{{*/
+    const unsigned char *p = (const unsigned char *) s;
+    char *out;
+    unsigned short c;
+    int o = 0, begin = 0, w = 0, brk = -1, brk_w = 0;
+    int len, cw, max = 0;
+
+    /* a break needs at most one more byte per character */
+    out = (char *) malloc(2 * strlen(s) + 1);
+    tl->text = out;
+    tl->lines = NULL;
+    tl->num_lines = 0;
+    if (out == NULL || !textlayout_pushLine(tl, &max, 0))
+        return 0;
+
+    while (*p) {
+        c = textlayout_decode(p, &len);
+
+        if (c == '\r') {
+            p += len;
+            continue;
+        }
+        if (c == '\n') {
+            p += len;
+            out[o++] = '\0';
+            begin = o; w = 0; brk = -1;
+            if (!textlayout_pushLine(tl, &max, begin))
+                return 0;
+            continue;
+        }
+        if (c == '\t')
+            c = ' ';
+
+        cw = CharWidth(c);
+        if (w + cw > width && o > begin) {
+            if (c == ' ') {
+                /* the space at the break is dropped */
+                p += len;
+                out[o++] = '\0';
+                begin = o; w = 0; brk = -1;
+                if (!textlayout_pushLine(tl, &max, begin))
+                    return 0;
+                continue;
+            }
+            if (brk >= 0) {
+                /* the character is checked again on the new line */
+                out[brk] = '\0';
+                begin = brk + 1;
+                w -= brk_w;
+                brk = -1;
+                if (!textlayout_pushLine(tl, &max, begin))
+                    return 0;
+                continue;
+            }
+            out[o++] = '\0';
+            begin = o; w = 0;
+            if (!textlayout_pushLine(tl, &max, begin))
+                return 0;
+        }
+
+        if (c == ' ') {
+            out[o] = ' ';
+            brk = o;
+            brk_w = w + cw;
+        } else {
+            memcpy(out + o, p, len);
+        }
+        o += c == ' ' ? 1 : len;
+        p += len;
+        w += cw;
+    }
+    out[o] = '\0';
+
+    /* no empty lines at the end */
+    while (tl->num_lines > 1 && out[tl->lines[tl->num_lines - 1]] == '\0')
+        tl->num_lines -= 1;
+
+    return 1;
+}/*}}}*/
+
+int textlayout_pushLine(TextLayout *tl, int *max, int offset)
+{/*{{{*/
+    int *lines;
+
+    if (tl->num_lines == *max) {
+        *max = *max ? 2 * *max : 32;
+        lines = (int *) realloc(tl->lines, sizeof(int) * *max);
+        if (lines == NULL)
+            return 0;
+        tl->lines = lines;
+    }
+    tl->lines[tl->num_lines++] = offset;
+    return 1;
+}/*}}}*/
+
+/* character of the UTF-8 sequence at s, len is set to its number of bytes;
+ * invalid bytes are taken as single characters */
+unsigned short textlayout_decode(const unsigned char *s, int *len)
+{/*{{{*/
+    if (s[0] < 0x80) {
+        *len = 1;
+        return s[0];
+    }
+    if ((s[0] & 0xe0) == 0xc0 && (s[1] & 0xc0) == 0x80) {
+        *len = 2;
+        return (unsigned short) ((s[0] & 0x1f) << 6 | (s[1] & 0x3f));
+    }
+    if ((s[0] & 0xf0) == 0xe0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80) {
+        *len = 3;
+        return (unsigned short) ((s[0] & 0x0f) << 12 | (s[1] & 0x3f) << 6 | (s[2] & 0x3f));
+    }
+    if ((s[0] & 0xf8) == 0xf0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80
+            && (s[3] & 0xc0) == 0x80) {
+        /* outside of the fonts */
+        *len = 4;
+        return '?';
+    }
+    *len = 1;
+    return s[0];
+}/*}}}*/
+
+void textlayout_free(LayoutEntry *e)
+{/*{{{*/
+    free(e->layout.text);
+    free(e->layout.lines);
+    memset(e, 0, sizeof(LayoutEntry));
+}/*}}}*/
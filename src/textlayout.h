@@ -0,0 +1,46 @@
+/* droceRoG - line breaks and pages of the comments
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <inkview.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* a text wrapped at the spaces to the width of a rectangle, the lines are
+ * split into pages of its height */
+typedef struct {
+    char *text;             /* the lines one after another, each terminated by '\0' */
+    int *lines;             /* offset of each line in text */
+    int num_lines;
+    int line_height;
+    int lines_per_page;
+    int num_pages;          /* at least 1, also for an empty text */
+} TextLayout;
+
+/* Layout of text in font for a rectangle of width x height. It is built
+ * with the first request and cached for the same text, so a comment is
+ * wrapped again only if its node is not revisited for a while. The text
+ * is identified by its address: it must not change while the layout is
+ * in use, see textlayout_clear(). The layout is owned by the cache.
+ */
+const TextLayout *textlayout_get(const char *text, ifont *font, int width, int height);
+
+/* Draw page of the layout with its upper left corner at x, y. The font
+ * of the layout has to be set. */
+void textlayout_drawPage(const TextLayout *tl, int page, int x, int y);
+
+/* release all layouts, before the texts are freed */
+void textlayout_clear();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXTLAYOUT_H */
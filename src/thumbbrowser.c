@@ -0,0 +1,387 @@
+/* droceRoG - pages of board thumbnails of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "thumbbrowser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <inkview.h>
+
+#include "fileindex.h"
+#include "fileselector.h"
+#include "thumbcache.h"
+#include "fontcache.h"
+
+/******************************************************************************/
+
+/* columns of a page, the rows fill the screen */
+#define THUMBBROWSER_COLS 3
+#define THUMBBROWSER_MAX_CELLS 64
+
+/* check for new thumbnails while some are missing (ms) */
+#define THUMBBROWSER_POLL_DELAY 500
+
+typedef struct {
+    ifont *font;
+    int line_h;             /* height of a text line */
+    int border;             /* distance to the screen border */
+    int header_h;           /* page line above the cells */
+    int pad;                /* space around the thumbnail in a cell */
+    int cols, rows;
+    int cell_w, cell_h;
+    int side;               /* width and height of a thumbnail */
+} BrowserLayout;
+
+/******************************************************************************/
+
+static int bShown = 0;
+static void (*browser_cb)(char *filename, int game) = NULL;
+
+/* SGF files of the file index, position in its entries */
+static int *files = NULL;
+static int num_files = 0;
+static int cur = 0;         /* selected file */
+
+static BrowserLayout layout;
+
+/* cells of the page drawn with their thumbnail */
+static char cell_done[THUMBBROWSER_MAX_CELLS];
+
+/******************************************************************************/
+
+void browser_layout();
+int browser_page();
+void browser_cellPos(int k, int *x, int *y);
+void browser_drawPage(int bPartial);
+int browser_drawCell(const FileIndexEntry *e, int k);
+void browser_drawThumb(const Thumbnail *t, int x, int y);
+void browser_drawFrame(int k, int color);
+void browser_select(int i);
+void browser_poll();
+
+/******************************************************************************/
+
+int thumbbrowser_open(const char *filename, void (*cb_update)(char *filename, int game))
+{/*{{{*/
+    const FileIndexEntry *entries;
+    int i, num;
+
+    /* only changed directories are read */
+    fileindex_update(FLASHDIR);
+    num = fileindex_entries(&entries);
+
+    free(files);
+    files = (int *) malloc(sizeof(int) * (num + 1));
+    assert(files != NULL);
+    num_files = 0;
+    cur = 0;
+    for (i=0; i<num; i++) {
+        if (entries[i].isDir)
+            continue;
+        if (filename && strcmp(entries[i].path, filename) == 0)
+            cur = num_files;
+        files[num_files++] = i;
+    }
+
+    if (num_files == 0) {
+        thumbbrowser_close();
+        return 0;
+    }
+
+    browser_cb = cb_update;
+    browser_layout();
+    bShown = 1;
+    thumbbrowser_draw();
+
+    return 1;
+}/*}}}*/
+
+void thumbbrowser_close()
+{/*{{{*/
+    ClearTimer(browser_poll);
+    bShown = 0;
+
+    free(files);
+    files = NULL;
+    num_files = 0;
+
+    /* keep what has been made so far */
+    thumbcache_cancel();
+    thumbcache_save();
+}/*}}}*/
+
+int thumbbrowser_isShown()
+{/*{{{*/
+    return bShown;
+}/*}}}*/
+
+void thumbbrowser_draw()
+{/*{{{*/
+    if (!bShown)
+        return;
+
+    ClearScreen();
+    browser_drawPage(0);
+    FullUpdate();
+}/*}}}*/
+
+int thumbbrowser_key(int key)
+{/*{{{*/
+    const FileIndexEntry *entries;
+    char filename[256];
+    int perPage = layout.cols * layout.rows;
+
+    if (!bShown)
+        return 0;
+
+    switch (key) {
+        case KEY_LEFT:  browser_select(cur - 1); break;
+        case KEY_RIGHT: browser_select(cur + 1); break;
+        case KEY_UP:    browser_select(cur - layout.cols); break;
+        case KEY_DOWN:  browser_select(cur + layout.cols); break;
+        case KEY_PREV:  browser_select(cur - perPage); break;
+        case KEY_NEXT:  browser_select(cur + perPage); break;
+
+        case KEY_OK:
+            /* the index may change while the file is opened */
+            fileindex_entries(&entries);
+            snprintf(filename, sizeof(filename), "%s", entries[files[cur]].path);
+            thumbbrowser_close();
+            fileselector_openFile(filename, browser_cb);
+            break;
+
+        case KEY_BACK:
+        case KEY_MENU:
+            thumbbrowser_close();
+            return 0;
+    }
+
+    return 1;
+}/*}}}*/
+
+void browser_layout()
+{/*{{{*/
+    int fontSize;
+
+    fontSize = (int) ((double)ScreenWidth() / 600.0 * 12.0);
+    layout.font = fontcache_get("DejaVuSerif", fontSize);
+    layout.line_h = fontSize + fontSize / 3;
+    layout.border = fontSize;
+    layout.header_h = 2 * layout.line_h;
+    layout.pad = fontSize / 2;
+
+    layout.cols = THUMBBROWSER_COLS;
+    layout.cell_w = (ScreenWidth() - 2 * layout.border) / layout.cols;
+    layout.side = layout.cell_w - 2 * layout.pad;
+    layout.cell_h = layout.side + 3 * layout.pad + 3 * layout.line_h;
+    layout.rows = (ScreenHeight() - layout.header_h - layout.border) / layout.cell_h;
+    if (layout.rows < 1)
+        layout.rows = 1;
+    if (layout.rows * layout.cols > THUMBBROWSER_MAX_CELLS)
+        layout.rows = THUMBBROWSER_MAX_CELLS / layout.cols;
+}/*}}}*/
+
+int browser_page()
+{/*{{{*/
+    return cur / (layout.cols * layout.rows);
+}/*}}}*/
+
+void browser_cellPos(int k, int *x, int *y)
+{/*{{{*/
+    *x = layout.border + (k % layout.cols) * layout.cell_w;
+    *y = layout.header_h + (k / layout.cols) * layout.cell_h;
+}/*}}}*/
+
+/* Draw the page line and all cells of the page of cur. Only the files
+ * shown are requested from the cache, the others are dropped. */
+void browser_drawPage(int bPartial)
+{/*{{{*/
+    const FileIndexEntry *entries;
+    char msg[128];
+    int k, first, perPage, bMissing = 0;
+
+    fileindex_entries(&entries);
+    perPage = layout.cols * layout.rows;
+    first = browser_page() * perPage;
+
+    thumbcache_cancel();
+
+    if (bPartial)
+        FillArea(0, 0, ScreenWidth(), ScreenHeight(), WHITE);
+
+    SetFont(layout.font, BLACK);
+    snprintf(msg, sizeof(msg), "Library - page %d/%d - OK: open, Menu / Back: close",
+             browser_page() + 1, (num_files + perPage - 1) / perPage);
+    DrawString(layout.border, layout.line_h / 2, msg);
+
+    /* the last request is made first */
+    for (k=perPage-1; k>=0; k--) {
+        cell_done[k] = 0;
+        if (first + k >= num_files)
+            continue;
+        cell_done[k] = browser_drawCell(&entries[files[first + k]], k);
+        bMissing |= !cell_done[k];
+    }
+    browser_drawFrame(cur - first, BLACK);
+
+    if (bPartial)
+        PartialUpdate(0, 0, ScreenWidth(), ScreenHeight());
+
+    ClearTimer(browser_poll);
+    if (bMissing)
+        SetHardTimer("ThumbPoll", browser_poll, THUMBBROWSER_POLL_DELAY);
+}/*}}}*/
+
+/* Draw cell k with the thumbnail of e, or an empty board if it is not
+ * ready. Returns 1 if the thumbnail has been drawn. */
+int browser_drawCell(const FileIndexEntry *e, int k)
+{/*{{{*/
+    const Thumbnail *t;
+    const char *name;
+    char text[256];
+    int x, y, ty, w, bDone = 1;
+
+    /* inside the frame of the selection */
+    browser_cellPos(k, &x, &y);
+    FillArea(x + 2, y + 2, layout.cell_w - 4, layout.cell_h - 4, WHITE);
+    x += layout.pad;
+    y += layout.pad;
+    w = layout.cell_w - 2 * layout.pad;
+
+    t = thumbcache_get(e->path, e->mtime);
+    if (t == NULL) {
+        DrawRect(x, y, layout.side, layout.side, LGRAY);
+        bDone = 0;
+    } else if (t->size == 0) {
+        DrawRect(x, y, layout.side, layout.side, DGRAY);
+    } else {
+        browser_drawThumb(t, x, y);
+    }
+
+    /* file name, players and result below */
+    name = strrchr(e->path, '/');
+    name = name ? name + 1 : e->path;
+    ty = y + layout.side + layout.pad;
+    SetFont(layout.font, BLACK);
+    DrawTextRect(x, ty, w, layout.line_h, (char *) name, ALIGN_LEFT | VALIGN_TOP);
+    if (e->pb[0] || e->pw[0]) {
+        snprintf(text, sizeof(text), "%s - %s", e->pb, e->pw);
+        DrawTextRect(x, ty + layout.line_h, w, layout.line_h, text, ALIGN_LEFT | VALIGN_TOP);
+    }
+    if (e->re[0])
+        DrawTextRect(x, ty + 2 * layout.line_h, w, layout.line_h, e->re, ALIGN_LEFT | VALIGN_TOP);
+
+    return bDone;
+}/*}}}*/
+
+void browser_drawThumb(const Thumbnail *t, int x, int y)
+{/*{{{*/
+    BoardPlayer player;
+    int f, r, c, x0, y0, fx, fy, last;
+
+    /* fields are squares, the board is centered in the thumbnail */
+    f = layout.side / t->size;
+    if (f < 2)
+        f = 2;
+    x0 = x + (layout.side - f * t->size) / 2;
+    y0 = y + (layout.side - f * t->size) / 2;
+
+    last = f * (t->size - 1) + f / 2;
+    for (r=0; r<t->size; r++) {
+        DrawLine(x0 + f / 2, y0 + r * f + f / 2, x0 + last, y0 + r * f + f / 2, LGRAY);
+        DrawLine(x0 + r * f + f / 2, y0 + f / 2, x0 + r * f + f / 2, y0 + last, LGRAY);
+    }
+
+    for (c=0; c<t->size; c++) {
+        for (r=0; r<t->size; r++) {
+            if (!thumbcache_stone(t, r, c, &player))
+                continue;
+            fx = x0 + c * f;
+            fy = y0 + r * f;
+            if (player == BOARD_BLACK) {
+                FillArea(fx, fy, f - 1, f - 1, BLACK);
+            } else {
+                FillArea(fx, fy, f - 1, f - 1, WHITE);
+                DrawRect(fx, fy, f - 1, f - 1, BLACK);
+            }
+        }
+    }
+}/*}}}*/
+
+/* mark or unmark cell k of the page as selected */
+void browser_drawFrame(int k, int color)
+{/*{{{*/
+    int x, y;
+
+    browser_cellPos(k, &x, &y);
+    DrawRect(x, y, layout.cell_w, layout.cell_h, color);
+    DrawRect(x + 1, y + 1, layout.cell_w - 2, layout.cell_h - 2, color);
+}/*}}}*/
+
+/* select file i, only the frames are redrawn on the same page */
+void browser_select(int i)
+{/*{{{*/
+    int x, y, first, page;
+
+    if (i < 0)
+        i = 0;
+    if (i >= num_files)
+        i = num_files - 1;
+    if (i == cur)
+        return;
+
+    page = browser_page();
+    first = page * layout.cols * layout.rows;
+    if (i / (layout.cols * layout.rows) != page) {
+        cur = i;
+        browser_drawPage(1);
+        return;
+    }
+
+    browser_drawFrame(cur - first, WHITE);
+    browser_cellPos(cur - first, &x, &y);
+    PartialUpdate(x, y, layout.cell_w, layout.cell_h);
+
+    cur = i;
+    browser_drawFrame(cur - first, BLACK);
+    browser_cellPos(cur - first, &x, &y);
+    PartialUpdate(x, y, layout.cell_w, layout.cell_h);
+}/*}}}*/
+
+/* draw the thumbnails made meanwhile, in the event loop */
+void browser_poll()
+{/*{{{*/
+    const FileIndexEntry *entries;
+    int k, x, y, first, perPage, bNew, pending, bMissing = 0;
+
+    if (!bShown)
+        return;
+
+    fileindex_entries(&entries);
+    perPage = layout.cols * layout.rows;
+    first = browser_page() * perPage;
+    bNew = thumbcache_poll(&pending) > 0;
+
+    for (k=0; k<perPage && first + k < num_files; k++) {
+        if (cell_done[k])
+            continue;
+        if (bNew)
+            cell_done[k] = browser_drawCell(&entries[files[first + k]], k);
+        if (cell_done[k]) {
+            browser_cellPos(k, &x, &y);
+            PartialUpdate(x, y, layout.cell_w, layout.cell_h);
+        } else {
+            bMissing = 1;
+        }
+    }
+
+    /* nothing comes for a request which could not be queued, e.g. without
+     * a thread; the cells are requested again with the next page */
+    if (bMissing && pending > 0)
+        SetHardTimer("ThumbPoll", browser_poll, THUMBBROWSER_POLL_DELAY);
+}/*}}}*/
@@ -0,0 +1,41 @@
+/* droceRoG - pages of board thumbnails of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef THUMBBROWSER_H
+#define THUMBBROWSER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Show the SGF files of the library on the whole screen as pages of board
+ * thumbnails with the players and the result, starting at the page of
+ * filename. Missing thumbnails are made in the background and drawn as
+ * soon as they are ready. A chosen file is passed to cb_update like by
+ * fileselector_chooseFile(). Returns 0 if there are no files.
+ */
+int thumbbrowser_open(const char *filename, void (*cb_update)(char *filename, int game));
+
+/* leave the browser, the caller repaints the screen */
+void thumbbrowser_close();
+
+/* Returns 1 while the browser is shown */
+int thumbbrowser_isShown();
+
+/* repaint the current page */
+void thumbbrowser_draw();
+
+/* Handle a released key while the browser is shown. Returns 0 if the
+ * browser has been closed without choosing a file, i.e. the caller has to
+ * repaint the screen.
+ */
+int thumbbrowser_key(int key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THUMBBROWSER_H */
@@ -0,0 +1,441 @@
+/* droceRoG - board thumbnails of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "thumbcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <inkview.h>
+#include <sgftree.h>
+
+#include "bitboard.h"
+#include "batchreplay.h"
+
+/******************************************************************************/
+
+#define THUMBCACHE_PATH CONFIGPATH "/drocerog_thumbs.bin"
+#define THUMBCACHE_MAGIC "DRTHM001"
+
+/* hash buckets of the paths, a power of 2 */
+#define THUMBCACHE_BUCKETS 1024
+
+typedef enum {
+    THUMB_NONE,             /* to be made with the next request */
+    THUMB_QUEUED,           /* waiting for the worker */
+    THUMB_BUSY,             /* made by the worker in the moment */
+    THUMB_DONE              /* thumb is valid for mtime */
+} ThumbState;
+
+typedef struct {
+    char *path;
+    long mtime;
+    ThumbState state;
+    int next;               /* next entry in the bucket, -1: none */
+    Thumbnail thumb;
+} ThumbEntry;
+
+typedef struct {
+    char magic[8];
+    int num_thumbs;
+} ThumbCacheHeader;
+
+/******************************************************************************/
+
+static ThumbEntry *entries = NULL;
+static int num_entries = 0;
+static int max_entries = 0;
+static int buckets[THUMBCACHE_BUCKETS];
+static int bLoaded = 0;
+static int bChanged = 0;
+
+/* requests, the last one is made first: it belongs to the files shown
+ * last */
+static int *queue = NULL;
+static int num_queue = 0;
+static int max_queue = 0;
+static int num_done = 0;    /* made since the last thumbcache_poll() */
+static int bBusy = 0;       /* the worker makes a thumbnail */
+
+/* the lock protects all of the above once the worker runs */
+static pthread_mutex_t thumb_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t thumb_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t thumb_thread;
+static int bThreadRunning = 0;
+static int bThreadQuit = 0;
+
+/******************************************************************************/
+
+void thumb_load();
+ThumbEntry *thumb_find(const char *path);
+ThumbEntry *thumb_add(const char *path, long mtime);
+unsigned int thumb_hash(const char *path);
+void thumb_request(ThumbEntry *e);
+void thumb_queue(int i);
+void *thumb_worker(void *arg);
+void thumb_make(const char *filename, Thumbnail *t);
+
+/******************************************************************************/
+
+const Thumbnail *thumbcache_get(const char *filename, long mtime)
+{/*{{{*/
+    const Thumbnail *t = NULL;
+    ThumbEntry *e;
+
+    assert(filename);
+
+    pthread_mutex_lock(&thumb_lock);
+
+    if (!bLoaded)
+        thumb_load();
+
+    e = thumb_find(filename);
+    if (e == NULL)
+        e = thumb_add(filename, mtime);
+
+    /* a modified file is made again, also if it is in the works */
+    if (e->mtime != mtime) {
+        e->mtime = mtime;
+        if (e->state == THUMB_DONE)
+            e->state = THUMB_NONE;
+    }
+
+    if (e->state == THUMB_DONE)
+        t = &e->thumb;
+    else if (e->state == THUMB_NONE)
+        thumb_request(e);
+
+    pthread_mutex_unlock(&thumb_lock);
+
+    return t;
+}/*}}}*/
+
+int thumbcache_stone(const Thumbnail *t, int r, int c, BoardPlayer *player)
+{/*{{{*/
+    int i, v;
+
+    i = c * t->size + r;
+    v = (t->points[i / 4] >> (2 * (i % 4))) & 3;
+    if (v == 0)
+        return 0;
+
+    *player = v == 1 ? BOARD_BLACK : BOARD_WHITE;
+    return 1;
+}/*}}}*/
+
+int thumbcache_poll(int *pending)
+{/*{{{*/
+    int n;
+
+    pthread_mutex_lock(&thumb_lock);
+    n = num_done;
+    num_done = 0;
+    *pending = num_queue + bBusy;
+    pthread_mutex_unlock(&thumb_lock);
+
+    return n;
+}/*}}}*/
+
+void thumbcache_cancel()
+{/*{{{*/
+    int i;
+
+    pthread_mutex_lock(&thumb_lock);
+    for (i=0; i<num_queue; i++) {
+        if (entries[queue[i]].state == THUMB_QUEUED)
+            entries[queue[i]].state = THUMB_NONE;
+    }
+    num_queue = 0;
+    pthread_mutex_unlock(&thumb_lock);
+}/*}}}*/
+
+void thumbcache_save()
+{/*{{{*/
+    FILE *file;
+    ThumbCacheHeader header;
+    ThumbEntry *e;
+    unsigned short len;
+    unsigned char size;
+    int i, mtime, bOk;
+
+    pthread_mutex_lock(&thumb_lock);
+
+    if (!bChanged) {
+        pthread_mutex_unlock(&thumb_lock);
+        return;
+    }
+
+    /* write a temporary file first, an interrupted write keeps the old cache */
+    file = fopen(THUMBCACHE_PATH ".tmp", "wb");
+    if (!file) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", THUMBCACHE_PATH ".tmp");
+        pthread_mutex_unlock(&thumb_lock);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, THUMBCACHE_MAGIC, 8);
+    for (i=0; i<num_entries; i++)
+        header.num_thumbs += entries[i].state == THUMB_DONE;
+    bOk = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (i=0; bOk && i<num_entries; i++) {
+        e = &entries[i];
+        if (e->state != THUMB_DONE)
+            continue;
+        mtime = (int) e->mtime;
+        len = (unsigned short) strlen(e->path);
+        size = (unsigned char) e->thumb.size;
+        bOk = fwrite(&mtime, sizeof(int), 1, file) == 1
+              && fwrite(&len, sizeof(len), 1, file) == 1
+              && fwrite(e->path, 1, len, file) == len
+              && fwrite(&size, 1, 1, file) == 1
+              && fwrite(&e->thumb.moves, sizeof(int), 1, file) == 1
+              && fwrite(e->thumb.points, 1, (size * size + 3) / 4, file) == (size_t) (size * size + 3) / 4;
+    }
+
+    if (fclose(file) != 0 || !bOk || rename(THUMBCACHE_PATH ".tmp", THUMBCACHE_PATH) != 0)
+        fprintf(stderr, "[ERROR] Could not write %s\n", THUMBCACHE_PATH);
+    else
+        bChanged = 0;
+
+    pthread_mutex_unlock(&thumb_lock);
+}/*}}}*/
+
+void thumbcache_cleanup()
+{/*{{{*/
+    int i;
+
+    if (bThreadRunning) {
+        pthread_mutex_lock(&thumb_lock);
+        bThreadQuit = 1;
+        pthread_cond_broadcast(&thumb_cond);
+        pthread_mutex_unlock(&thumb_lock);
+
+        pthread_join(thumb_thread, NULL);
+        bThreadRunning = 0;
+    }
+
+    thumbcache_save();
+
+    for (i=0; i<num_entries; i++)
+        free(entries[i].path);
+    free(entries);
+    entries = NULL;
+    num_entries = max_entries = 0;
+    free(queue);
+    queue = NULL;
+    num_queue = max_queue = 0;
+    num_done = 0;
+    bBusy = 0;
+    bLoaded = 0;
+}/*}}}*/
+
+void thumb_load()
+{/*{{{*/
+    FILE *file;
+    ThumbCacheHeader header;
+    ThumbEntry *e;
+    char path[256];
+    unsigned short len;
+    unsigned char size;
+    int i, mtime, moves, bOk;
+
+    bLoaded = 1;
+    for (i=0; i<THUMBCACHE_BUCKETS; i++)
+        buckets[i] = -1;
+
+    file = fopen(THUMBCACHE_PATH, "rb");
+    if (!file)
+        return;
+
+    /* ignore caches of other versions */
+    bOk = fread(&header, sizeof(header), 1, file) == 1
+          && memcmp(header.magic, THUMBCACHE_MAGIC, 8) == 0
+          && header.num_thumbs >= 0;
+
+    for (i=0; bOk && i<header.num_thumbs; i++) {
+        bOk = fread(&mtime, sizeof(int), 1, file) == 1
+              && fread(&len, sizeof(len), 1, file) == 1
+              && len < sizeof(path)
+              && fread(path, 1, len, file) == len
+              && fread(&size, 1, 1, file) == 1
+              && fread(&moves, sizeof(int), 1, file) == 1
+              && size <= THUMB_MAX_SIZE;
+        if (!bOk)
+            break;
+        path[len] = '\0';
+
+        e = thumb_add(path, mtime);
+        e->state = THUMB_DONE;
+        e->thumb.size = size;
+        e->thumb.moves = moves;
+        bOk = fread(e->thumb.points, 1, (size * size + 3) / 4, file) == (size_t) (size * size + 3) / 4;
+    }
+    fclose(file);
+
+    if (!bOk)
+        fprintf(stderr, "[ERROR] Could not read %s\n", THUMBCACHE_PATH);
+}/*}}}*/
+
+ThumbEntry *thumb_find(const char *path)
+{/*{{{*/
+    int i;
+
+    for (i = buckets[thumb_hash(path)]; i >= 0; i = entries[i].next) {
+        if (strcmp(entries[i].path, path) == 0)
+            return &entries[i];
+    }
+
+    return NULL;
+}/*}}}*/
+
+ThumbEntry *thumb_add(const char *path, long mtime)
+{/*{{{*/
+    ThumbEntry *e;
+    unsigned int h;
+
+    if (num_entries == max_entries) {
+        max_entries = max_entries ? 2 * max_entries : 256;
+        entries = (ThumbEntry *) realloc(entries, sizeof(ThumbEntry) * max_entries);
+        assert(entries != NULL);
+    }
+
+    e = &entries[num_entries];
+    memset(e, 0, sizeof(ThumbEntry));
+    e->path = strdup(path);
+    assert(e->path != NULL);
+    e->mtime = mtime;
+    e->state = THUMB_NONE;
+
+    h = thumb_hash(path);
+    e->next = buckets[h];
+    buckets[h] = num_entries++;
+
+    return e;
+}/*}}}*/
+
+unsigned int thumb_hash(const char *path)
+{/*{{{*/
+    unsigned int h = 5381;
+
+    while (*path)
+        h = h * 33 + (unsigned char) *path++;
+
+    return h & (THUMBCACHE_BUCKETS - 1);
+}/*}}}*/
+
+/* queue e for the worker, which is started with the first request; called
+ * with the lock */
+void thumb_request(ThumbEntry *e)
+{/*{{{*/
+    if (!bThreadRunning) {
+        bThreadQuit = 0;
+        if (pthread_create(&thumb_thread, NULL, thumb_worker, NULL) != 0) {
+            fprintf(stderr, "[ERROR] Could not start thumbnail thread\n");
+            return;
+        }
+        bThreadRunning = 1;
+    }
+
+    thumb_queue(e - entries);
+    pthread_cond_broadcast(&thumb_cond);
+}/*}}}*/
+
+/* add entry i to the queue, called with the lock */
+void thumb_queue(int i)
+{/*{{{*/
+    if (num_queue == max_queue) {
+        max_queue = max_queue ? 2 * max_queue : 32;
+        queue = (int *) realloc(queue, sizeof(int) * max_queue);
+        assert(queue != NULL);
+    }
+
+    queue[num_queue++] = i;
+    entries[i].state = THUMB_QUEUED;
+}/*}}}*/
+
+void *thumb_worker(void *arg)
+{/*{{{*/
+    Thumbnail thumb;
+    char path[256];
+    long mtime;
+    int i;
+
+    (void) arg;
+
+    pthread_mutex_lock(&thumb_lock);
+    while (!bThreadQuit) {
+        if (num_queue == 0) {
+            pthread_cond_wait(&thumb_cond, &thumb_lock);
+            continue;
+        }
+
+        i = queue[--num_queue];
+        if (entries[i].state != THUMB_QUEUED)
+            continue;
+        entries[i].state = THUMB_BUSY;
+        bBusy = 1;
+        snprintf(path, sizeof(path), "%s", entries[i].path);
+        mtime = entries[i].mtime;
+        pthread_mutex_unlock(&thumb_lock);
+
+        /* the entries may be moved meanwhile, only i stays */
+        thumb_make(path, &thumb);
+
+        pthread_mutex_lock(&thumb_lock);
+        bBusy = 0;
+        if (entries[i].state == THUMB_BUSY && entries[i].mtime == mtime) {
+            entries[i].thumb = thumb;
+            entries[i].state = THUMB_DONE;
+            num_done += 1;
+            bChanged = 1;
+        } else if (entries[i].state == THUMB_BUSY) {
+            /* modified meanwhile, it is made again next, nobody else would
+             * ask for it */
+            thumb_queue(i);
+        }
+    }
+    pthread_mutex_unlock(&thumb_lock);
+
+    return NULL;
+}/*}}}*/
+
+/* replay the main line of the first game on a bitboard */
+void thumb_make(const char *filename, Thumbnail *t)
+{/*{{{*/
+    SGFTree tree;
+    BitBoard bb;
+    BoardPlayer player;
+    int r, c, i, n;
+
+    memset(t, 0, sizeof(Thumbnail));
+
+    sgftree_clear(&tree);
+    if (!sgftree_readfile(&tree, filename)) {
+        sgftree_free(&tree);
+        return;
+    }
+
+    n = batch_replay_mainline(tree.root, THUMBCACHE_MOVES, &bb);
+    if (n >= 0 && bb.size <= THUMB_MAX_SIZE) {
+        t->size = bb.size;
+        t->moves = n;
+        for (c=0; c<bb.size; c++) {
+            for (r=0; r<bb.size; r++) {
+                if (!bitboard_get_stone(&bb, r, c, &player))
+                    continue;
+                i = c * bb.size + r;
+                t->points[i / 4] |= (player == BOARD_BLACK ? 1 : 2) << (2 * (i % 4));
+            }
+        }
+    }
+
+    sgftree_free(&tree);
+}/*}}}*/
@@ -0,0 +1,60 @@
+/* droceRoG - board thumbnails of the SGF library
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef THUMBCACHE_H
+#define THUMBCACHE_H
+
+#include "goboard.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* larger boards get no thumbnail */
+#define THUMB_MAX_SIZE 19
+
+/* moves of the main line shown by a thumbnail, 0: the final position */
+#define THUMBCACHE_MOVES 0
+
+/* position of the first game of a file, 2 bits per field column by
+ * column: 0 empty, 1 black, 2 white */
+typedef struct {
+    int size;               /* board size, 0: no board, e.g. unreadable file */
+    int moves;              /* moves played to the position */
+    unsigned char points[(THUMB_MAX_SIZE * THUMB_MAX_SIZE + 3) / 4];
+} Thumbnail;
+
+/* Get the thumbnail of filename with the modification time mtime. If
+ * there is none for this mtime, it is made by a background thread and
+ * NULL is returned, see thumbcache_poll(). The caller never waits for a
+ * thumbnail. The cache is loaded from disk with the first call. The
+ * thumbnail stays valid until the next call.
+ */
+const Thumbnail *thumbcache_get(const char *filename, long mtime);
+
+/* Returns 1 if there is a stone at row r and column c and sets player,
+ * like bitboard_get_stone() */
+int thumbcache_stone(const Thumbnail *t, int r, int c, BoardPlayer *player);
+
+/* Returns the number of thumbnails made since the last call, *pending is
+ * set to the number of thumbnails still queued or in the works. */
+int thumbcache_poll(int *pending);
+
+/* drop the requests which have not been started, e.g. files not shown
+ * anymore */
+void thumbcache_cancel();
+
+/* write the cache to disk if new thumbnails have been made */
+void thumbcache_save();
+
+/* stop the thread, save and release the cache, at exit */
+void thumbcache_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THUMBCACHE_H */
@@ -0,0 +1,85 @@
+/* droceRoG - binary cache of parsed SGF files
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#include "treecache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <inkview.h>
+
+/******************************************************************************/
+
+/* one file per game, named by a hash of the SGF path */
+#define TREECACHE_DIR CONFIGPATH "/drocerog_trees"
+
+/******************************************************************************/
+
+int cache_path(const char *filename, char *path, int size, long *mtime, long *fsize);
+
+/******************************************************************************/
+
+SGFTree *treecache_load(const char *filename)
+{/*{{{*/
+    SGFTree *tree;
+    char path[256];
+    long mtime, fsize;
+
+    if (!cache_path(filename, path, sizeof(path), &mtime, &fsize))
+        return NULL;
+
+    tree = (SGFTree *) malloc(sizeof(SGFTree));
+    if (tree == NULL)
+        return NULL;
+    sgftree_clear(tree);
+
+    if (!sgftree_readbin(tree, path, filename, mtime, fsize)) {
+        free(tree);
+        return NULL;
+    }
+
+    return tree;
+}/*}}}*/
+
+int treecache_store(SGFTree *tree, const char *filename)
+{/*{{{*/
+    char path[256];
+    long mtime, fsize;
+
+    if (!cache_path(filename, path, sizeof(path), &mtime, &fsize))
+        return 0;
+
+    mkdir(TREECACHE_DIR, 0755);
+
+    /* write a temporary file first, an interrupted write keeps the old cache */
+    if (!sgftree_writebin(tree, TREECACHE_DIR "/tree.tmp", filename, mtime, fsize)
+        || rename(TREECACHE_DIR "/tree.tmp", path) != 0) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", path);
+        return 0;
+    }
+
+    return 1;
+}/*}}}*/
+
+/* cache file of filename and the stamp of the SGF file */
+int cache_path(const char *filename, char *path, int size, long *mtime, long *fsize)
+{/*{{{*/
+    struct stat st;
+    unsigned int hash = 2166136261u;
+    const char *c;
+
+    if (filename == NULL || stat(filename, &st) != 0)
+        return 0;
+    *mtime = (long) st.st_mtime;
+    *fsize = (long) st.st_size;
+
+    /* FNV-1a, collisions are recognised by the file name in the cache */
+    for (c=filename; *c; c++)
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+    snprintf(path, size, "%s/%08x.bin", TREECACHE_DIR, hash);
+
+    return 1;
+}/*}}}*/
@@ -0,0 +1,30 @@
+/* droceRoG - binary cache of parsed SGF files
+ *
+ * Author: Christoph Hermes (hermes<AT>hausmilbe<DOT>net)
+ */
+
+#ifndef TREECACHE_H
+#define TREECACHE_H
+
+#include <sgftree.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Load the cached tree of the SGF file filename. Returns NULL if there is
+ * none or the file has been modified since. The tree is owned by the
+ * caller (sgftree_free() and free()). Safe to call from the prefetch
+ * thread.
+ */
+SGFTree *treecache_load(const char *filename);
+
+/* Store tree, read from filename, in the cache. Returns 1 on success. */
+int treecache_store(SGFTree *tree, const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TREECACHE_H */